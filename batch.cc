@@ -0,0 +1,353 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+#include <mutex>
+#include <atomic>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "parser.h"
+#include "mps.h"
+#include "snapshot.h"
+#include "simplex.h"
+#include "revised.h"
+#include "dual.h"
+#include "mixed.h"
+#include "presolve.h"
+#include "scaling.h"
+#include "threads.h"
+#include "trace.h"
+
+extern char *pname;
+
+/* Solve a tableau with the given method */
+/* Check if a variable of the tableau has an upper bound */
+static int bounded (Tableau *tab)
+{
+  for (int j = 0; j < tab->n() - 1; j++)
+    if (tab->upper_at(j) != HUGE_VAL) return 1;
+
+  return 0;
+}
+
+static double solve_method (int method, Tableau *tab, int revised)
+{
+  switch (method) { // solve with the specified method
+  case SIMPLEX:
+    if (revised) return RevisedSimplex::simplex(tab);
+    else if (Mixed::enabled) return Mixed::simplex(tab);
+    else return PrimalSimplex::simplex(tab);
+  case TWO_PHASE:
+    if (revised) return RevisedSimplex::two_phase(tab);
+    else if (Presolve::enabled) return Presolve::two_phase(tab, NULL);
+    else return PrimalSimplex::two_phase(tab);
+  case DUAL:
+    return DualSimplex::simplex(tab);
+  default:
+    return PrimalSimplex::two_phase(tab);
+  }
+}
+
+double Batch::solve (int method, Tableau *tab, int revised)
+{
+  if (revised && bounded(tab)) { // the revised methods have no bounds
+    TRACE_MESSAGE(Trace::SUMMARY, "batch", "upper bounds: solved with the full-tableau method");
+    revised = 0;
+  }
+
+  /* the revised methods keep the tableau as given, and the presolve
+     scales the reduced problem */
+  if (!Scaling::enabled || revised || (method == TWO_PHASE && Presolve::enabled))
+    return solve_method(method, tab, revised);
+
+  struct Scaling::factors *f = Scaling::scale(tab);
+  double cost;
+
+  try {
+    cost = solve_method(method, tab, revised);
+  } catch (TableauException *ex) {
+    Scaling::unscale(tab, f);
+    Scaling::delete_factors(f);
+    throw;
+  }
+
+  Scaling::unscale(tab, f);
+  Scaling::delete_factors(f);
+
+  return cost;
+}
+
+/* the state of a batch */
+struct batch {
+  char **files;
+  int count;
+  int revised;
+
+  char **results;         // formatted results, NULL until ready
+  std::mutex lock;        // protects the results and the output
+  int next;               // next result to print
+  FILE *out;
+
+  std::atomic<int> errors;
+};
+
+static int is_mps (const char *file)
+{
+  size_t len = strlen(file);
+  return len >= 4 && strcasecmp(file + len - 4, ".mps") == 0;
+}
+
+/* Solve a problem, return the result (to be freed) */
+static char *solve_problem (struct batch *b, const char *file)
+{
+  size_t size = strlen(file) + 64;
+  char *text = (char *) malloc(size);
+
+  if (is_mps(file)) {
+    struct Mps::model *md = Mps::read(file);
+
+    if (!md) {
+      snprintf(text, size, "%s: invalid file\n", file);
+      b->errors++;
+      return text;
+    }
+
+    try {
+      snprintf(text, size, "%s: Solution value: %lf\n", file, Mps::solve(md, NULL));
+    } catch (TableauException *ex) {
+      snprintf(text, size, "%s: No solution found.\n", file);
+    }
+
+    Mps::delete_model(md);
+    return text;
+  }
+
+  struct parsed_file *parsed = Parser::parse_file(file);
+
+  if (!parsed) {
+    snprintf(text, size, "%s: invalid file\n", file);
+    b->errors++;
+    return text;
+  }
+
+  try {
+    snprintf(text, size, "%s: Solution value: %lf\n", file,
+	     Batch::solve(parsed->method, parsed->tableau, b->revised));
+  } catch (TableauException *ex) {
+    snprintf(text, size, "%s: No solution found.\n", file);
+  }
+
+  Parser::delete_parsed(parsed);
+  return text;
+}
+
+/* a task: solve a problem, and print the results ready in input order */
+static void solve_task (int task, void *arg)
+{
+  struct batch *b = (struct batch *) arg;
+  char *text = solve_problem(b, b->files[task]);
+
+  std::lock_guard<std::mutex> lock(b->lock);
+
+  b->results[task] = text;
+
+  for (; b->next < b->count && b->results[b->next]; b->next++) {
+    fputs(b->results[b->next], b->out);
+    free(b->results[b->next]);
+  }
+}
+
+/* Solve the given files */
+int Batch::solve_files (int count, char **files, int revised, FILE *out)
+{
+  struct batch b;
+
+  b.files = files;
+  b.count = count;
+  b.revised = revised;
+  b.results = (char **) calloc(count > 0 ? count : 1, sizeof(char *));
+  b.next = 0;
+  b.out = out;
+  b.errors = 0;
+
+  const char *saved_checkpoint = Snapshot::checkpoint_file;
+  Snapshot::checkpoint_file = NULL; // a single file for all the problems
+
+  Threads::parallel_tasks(count, solve_task, &b);
+
+  Snapshot::checkpoint_file = saved_checkpoint;
+
+  fflush(out);
+  free(b.results);
+
+  return b.errors;
+}
+
+/* a growing list of file names */
+struct file_list {
+  char **files;
+  int count, size;
+};
+
+static void push_file (struct file_list *list, char *file)
+{
+  if (list->count == list->size) {
+    list->size = list->size ? 2 * list->size : 64;
+    list->files = (char **) realloc(list->files, list->size * sizeof(char *));
+  }
+
+  list->files[list->count++] = file;
+}
+
+static int solve_list_and_free (struct file_list *list, int revised, FILE *out)
+{
+  int errors = Batch::solve_files(list->count, list->files, revised, out);
+
+  for (int k = 0; k < list->count; k++)
+    free(list->files[k]);
+
+  free(list->files);
+  return errors;
+}
+
+static int compare_names (const void *a, const void *b)
+{
+  return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+/* Solve every file of a directory, in name order */
+int Batch::solve_directory (const char *path, int revised, FILE *out)
+{
+  DIR *dir = opendir(path);
+
+  if (!dir) {
+    fprintf(stderr, "%s: can't open the directory: %s\n", pname, path);
+    return -1;
+  }
+
+  struct file_list list = { NULL, 0, 0 };
+  struct dirent *entry;
+
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') continue; // hidden files, . and ..
+
+    char *file = (char *) malloc(strlen(path) + strlen(entry->d_name) + 2);
+    sprintf(file, "%s/%s", path, entry->d_name);
+
+    struct stat st;
+
+    if (stat(file, &st) == 0 && S_ISREG(st.st_mode)) push_file(&list, file);
+    else free(file);
+  }
+
+  closedir(dir);
+
+  qsort(list.files, list.count, sizeof(char *), compare_names);
+
+  return solve_list_and_free(&list, revised, out);
+}
+
+/* Solve every file listed in a file */
+int Batch::solve_list (const char *path, int revised, FILE *out)
+{
+  FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+
+  if (!in) {
+    fprintf(stderr, "%s: can't open the file list: %s\n", pname, path);
+    return -1;
+  }
+
+  struct file_list list = { NULL, 0, 0 };
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t len;
+
+  while ((len = getline(&line, &size, in)) != -1) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+      line[--len] = '\0';
+
+    if (len > 0 && line[0] != '#') push_file(&list, strdup(line));
+  }
+
+  free(line);
+  if (in != stdin) fclose(in);
+
+  return solve_list_and_free(&list, revised, out);
+}
+
+/* Unit tests */
+
+static void write_file (const char *dir, const char *name, const char *content)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+  FILE *f = fopen(path, "w");
+  if (!f) return;
+
+  fputs(content, f);
+  fclose(f);
+}
+
+static void remove_file (const char *dir, const char *name)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  unlink(path);
+}
+
+void Batch::test ()
+{
+  char dir[] = "/tmp/simplex_batch_XXXXXX";
+
+  if (!mkdtemp(dir)) return;
+
+  write_file(dir, "a_simplex.txt",
+	     "SIMPLEX\n"
+	     "6 4 1 0 24\n"
+	     "3 -2 0 1 6\n"
+	     "-1 -1 0 0 0\n"
+	     "\n"
+	     "2 3\n");
+
+  write_file(dir, "b_dual.txt",
+	     "DUAL\n"
+	     "-1 -2 1 0 -3\n"
+	     "-4 -1 0 1 -4\n"
+	     "3 2 0 0 0\n");
+
+  write_file(dir, "c_invalid.txt", "SIMPLEX\n1 2 3\n1 2\n"); // the error is printed
+
+  write_file(dir, "d_two_phase.txt",
+	     "TWO_PHASE\n"
+	     "1 1 1 0 4\n"
+	     "1 -1 0 -1 1\n"
+	     "-1 -2 0 0 0\n");
+
+  int saved = Threads::count;
+
+  for (Threads::count = 1; Threads::count <= 4; Threads::count *= 4) {
+    printf("\nBatch: directory of problems, %d threads:\n", Threads::count);
+    fflush(stdout);
+
+    int errors = solve_directory(dir, 0, stdout);
+    printf("%d invalid files\n", errors);
+  }
+
+  Threads::count = saved;
+
+  remove_file(dir, "a_simplex.txt");
+  remove_file(dir, "b_dual.txt");
+  remove_file(dir, "c_invalid.txt");
+  remove_file(dir, "d_two_phase.txt");
+  rmdir(dir);
+}
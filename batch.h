@@ -0,0 +1,62 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Batch solve of many independent problems.
+
+  Every problem is a task of the thread pool (see Threads::parallel_tasks):
+  it is parsed, solved and its result formatted by the same thread,
+  so the stages of different problems overlap, and the work stealing
+  balances problems of very different sizes. The results are printed
+  in input order, each one tagged with its file name, as soon as all
+  the previous ones are ready:
+
+    problems/dual_tableau1.txt: Solution value: 11.000000
+    problems/dual_tableau2.txt: No solution found.
+
+  Files ending in .mps are read as MPS problems. The operations
+  nested in a task (pivots, parsing) are serial, and no checkpoint
+  is written.
+*/
+
+namespace Batch {
+
+  //public:
+
+  /* Solve a tableau with the given method (see solver_method), with
+     the revised implementation if requested and the variables have no
+     upper bounds (the two-phase method after the presolve, if enabled:
+     see Presolve). Throws a TableauException
+     if there is no solution */
+  double solve (int method, Tableau *tab, int revised);
+
+  /* Solve the given files, return the number of files that couldn't be read */
+  int solve_files (int count, char **files, int revised, FILE *out);
+
+  /* Solve every file of a directory, in name order */
+  int solve_directory (const char *path, int revised, FILE *out);
+
+  /* Solve every file listed in a file (one per line, "-" for the standard input) */
+  int solve_list (const char *path, int revised, FILE *out);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
@@ -0,0 +1,526 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+/*
+  Microbenchmarks of the matrix and tableau kernels (make bench).
+
+  Every kernel is run on a range of shapes, repeating it until the
+  measured time reaches a minimum, and the results are printed as
+  CSV on the standard output, one line per kernel and shape:
+
+    kernel,m,n,threads,repetitions,ns_per_call,ns_per_element,gflops
+
+  The elements are the ones read or written by a call, the flops
+  are the nominal ones (2 per multiply-add, none for the swaps and
+  the deletions; 2 n^3 for the inversion, as for Gauss-Jordan).
+  The setup of the destructive kernels (a fresh copy of the
+  tableau) is not measured.
+
+  usage: simplex-bench [-j threads] [-s seconds] [kernel ...]
+
+  With -e, the methods are timed end to end on random problems of
+  growing size instead (see Generator), every run in a child process,
+  to measure its peak memory and to stop it after a time limit:
+
+    family,method,m,n,seed,status,cost,iterations,seconds,us_per_iteration,peak_kb
+
+  The sizes double from 16 rows up to -M (default 256), with 2 m
+  variables (16 m for the wide family), and -r seeds for each size.
+  A family stops growing for a method after a run over the limit of
+  -T seconds (default 60). With -H the methods use the textbook
+  ratio test instead of Harris' test (see Tolerances), with -C the
+  two-phase method starts without the crash basis, with -D the stalled
+  methods use only Bland's rule, without perturbation (see Degeneracy),
+  and with -F the primal simplex iterates in float first (see Mixed).
+
+  usage: simplex-bench -e [-C] [-H] [-D] [-F] [-M rows] [-r seeds] [-T seconds] [family ...]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "matrix.h"
+#include "tableau.h"
+#include "threads.h"
+#include "trace.h"
+#include "parser.h"
+#include "simplex.h"
+#include "dual.h"
+#include "generator.h"
+#include "tolerances.h"
+#include "degeneracy.h"
+#include "mixed.h"
+
+char *pname;
+
+/* Settings */
+static double min_time = 0.1; // seconds measured for every kernel and shape
+static int max_rows = 256;     // largest problems of the end-to-end runs
+static int seeds = 1;          // problems of every size
+static int time_limit = 60;    // seconds of a run
+
+static double now ()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* a tableau of random elements, with the basis in the last m - 1 columns
+   before the variables column */
+static Tableau *random_tableau (int m, int n)
+{
+  Tableau *tab = new Tableau(m, n, NULL, NULL);
+
+  srand(1);
+
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < n; j++)
+      tab->at(i, j, 1.0 + (rand() % 1000) / 100.0);
+
+  for (int i = 0; i < m - 1 && n - m + i >= 0; i++)
+    tab->basis_at(i, n - m + i);
+
+  return tab;
+}
+
+/* the kernels: run reps calls, return the measured seconds, and
+   the elements and flops of a call */
+
+static double run_add_premultiplied_row (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double start = now();
+
+  for (long r = 0; r < reps; r++)
+    tab->add_premultiplied_row(r % m, 1e-9, (r + 1) % m);
+
+  *elements = 2.0 * n;
+  *flops = 2.0 * n;
+  return now() - start;
+}
+
+static double run_scale_row (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double start = now();
+
+  for (long r = 0; r < reps; r++)
+    tab->scale_row(r % m, (r & 1) ? 2.0 : 0.5);
+
+  *elements = n;
+  *flops = n;
+  return now() - start;
+}
+
+static double run_swap_rows (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double start = now();
+
+  for (long r = 0; r < reps; r++)
+    tab->swap_rows(r % m, (r + 1) % m);
+
+  *elements = 2.0 * n;
+  *flops = 0;
+  return now() - start;
+}
+
+static double run_swap_columns (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double start = now();
+
+  for (long r = 0; r < reps; r++)
+    tab->swap_columns(r % n, (r + 1) % n);
+
+  *elements = 2.0 * m;
+  *flops = 0;
+  return now() - start;
+}
+
+static double run_pivot (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    Tableau *copy = tab->clone();
+    double start = now();
+
+    copy->pivot(r % (m - 1), r % (n - 1));
+
+    elapsed += now() - start;
+    delete copy;
+  }
+
+  *elements = (double) m * n;
+  *flops = 2.0 * m * n;
+  return elapsed;
+}
+
+static double run_canonicalize (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    Tableau *copy = tab->clone();
+    double start = now();
+
+    copy->canonicalize();
+
+    elapsed += now() - start;
+    delete copy;
+  }
+
+  *elements = (double) (m - 1) * m * n;
+  *flops = 2.0 * (m - 1) * m * n;
+  return elapsed;
+}
+
+static double run_delete_row (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    Tableau *copy = tab->clone();
+    double start = now();
+
+    copy->delete_row(0); // the worst case: every row is moved
+
+    elapsed += now() - start;
+    delete copy;
+  }
+
+  *elements = (double) m * n;
+  *flops = 0;
+  return elapsed;
+}
+
+static double run_delete_column (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int m = tab->m(), n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    Tableau *copy = tab->clone();
+    double start = now();
+
+    copy->delete_column(0);
+
+    elapsed += now() - start;
+    delete copy;
+  }
+
+  *elements = (double) m * n;
+  *flops = 0;
+  return elapsed;
+}
+
+static double run_invert (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    Matrix *copy = ((Matrix *) tab)->clone();
+    double start = now();
+
+    copy->invert();
+
+    elapsed += now() - start;
+    delete copy;
+  }
+
+  *elements = (double) n * n;
+  *flops = 2.0 * n * n * n;
+  return elapsed;
+}
+
+static double run_multiply_by (Tableau *tab, long reps, double *elements, double *flops)
+{
+  int n = tab->n();
+  double elapsed = 0;
+
+  for (long r = 0; r < reps; r++) {
+    double start = now();
+    Matrix *product = tab->multiply_by(tab);
+    elapsed += now() - start;
+
+    delete product;
+  }
+
+  *elements = 3.0 * n * n;
+  *flops = 2.0 * n * n * n;
+  return elapsed;
+}
+
+typedef double (*kernel_fn) (Tableau *tab, long reps, double *elements, double *flops);
+
+struct kernel {
+  const char *name;
+  kernel_fn run;
+  int square; // only square shapes
+};
+
+static struct kernel kernels[] = {
+  { "add_premultiplied_row", run_add_premultiplied_row, 0 },
+  { "scale_row",             run_scale_row,             0 },
+  { "swap_rows",             run_swap_rows,             0 },
+  { "swap_columns",          run_swap_columns,          0 },
+  { "pivot",                 run_pivot,                 0 },
+  { "canonicalize",          run_canonicalize,          0 },
+  { "delete_row",            run_delete_row,            0 },
+  { "delete_column",         run_delete_column,         0 },
+  { "invert",                run_invert,                1 },
+  { "multiply_by",           run_multiply_by,           1 },
+};
+
+struct shape {
+  int m, n;
+};
+
+static struct shape shapes[] = { // rows include the reduced costs row
+  { 65, 257 }, { 257, 1025 }, { 1025, 4097 }, { 33, 16385 }, { 1025, 1025 },
+};
+
+static struct shape square_shapes[] = {
+  { 64, 64 }, { 128, 128 }, { 256, 256 }, { 512, 512 },
+};
+
+static void bench (struct kernel *k, int m, int n)
+{
+  Tableau *tab = random_tableau(m, n);
+  double elements, flops, elapsed;
+  long reps = 1;
+
+  // double the repetitions until the minimum time is reached
+
+  while ((elapsed = k->run(tab, reps, &elements, &flops)) < min_time && reps < (1L << 30))
+    reps = elapsed > 0 && elapsed * 8 < min_time ? reps * 8 : reps * 2;
+
+  double per_call = elapsed / reps;
+
+  printf("%s,%d,%d,%d,%ld,%.1f,%.4f,%.3f\n", k->name, m, n, Threads::count, reps,
+	 per_call * 1e9, per_call * 1e9 / elements, flops / per_call * 1e-9);
+  fflush(stdout);
+
+  delete tab;
+}
+
+static int selected (const char *name, int argc, char **argv);
+
+/* End-to-end runs */
+
+static const char *method_names[] = { "simplex", "two_phase", "dual" };
+
+struct run_result {
+  const char *status;
+  double cost;
+  long iterations;
+  double seconds;
+};
+
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  if (ev->type == Trace::ITERATION) (*(long *) arg)++;
+}
+
+/* generate and solve a problem (in the child process) */
+static void solve_generated (int family, int method, int m, int n, unsigned long seed,
+			     struct run_result *r)
+{
+  Tableau *tab = Generator::generate(family, m, n, seed, method);
+
+  r->status = "none";
+  r->cost = 0;
+  r->iterations = 0;
+  r->seconds = 0;
+
+  if (!tab) return;
+
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &r->iterations);
+
+  double start = now();
+
+  try {
+    if (method == SIMPLEX) r->cost = Mixed::enabled ? Mixed::simplex(tab) : PrimalSimplex::simplex(tab);
+    else if (method == DUAL) r->cost = DualSimplex::simplex(tab);
+    else r->cost = PrimalSimplex::two_phase(tab);
+
+    r->status = "optimal";
+  } catch (ImpossibleException *ex) {
+    r->status = "infeasible";
+  } catch (UnlimitedException *ex) { // for the dual simplex, the dual problem
+    r->status = method == DUAL ? "infeasible" : "unbounded";
+  } catch (TableauException *ex) {
+    r->status = "failed";
+  }
+
+  r->seconds = now() - start;
+
+  delete tab;
+}
+
+/* a run in a child process, 0 if over the time limit */
+static int run (int family, int method, int m, int n, unsigned long seed)
+{
+  struct run_result r = { "crashed", 0, 0, 0 };
+  int fds[2];
+
+  if (pipe(fds) == -1) {
+    perror(pname);
+    exit(1);
+  }
+
+  fflush(stdout);
+  pid_t pid = fork();
+
+  if (pid == -1) {
+    perror(pname);
+    exit(1);
+  }
+
+  if (pid == 0) { // the child: the statuses are literals, valid in the parent too
+    close(fds[0]);
+    alarm(time_limit);
+
+    solve_generated(family, method, m, n, seed, &r);
+
+    ssize_t written = write(fds[1], &r, sizeof(r));
+    _exit(written == sizeof(r) ? 0 : 1);
+  }
+
+  close(fds[1]);
+
+  if (read(fds[0], &r, sizeof(r)) != sizeof(r)) r.status = "crashed";
+  close(fds[0]);
+
+  int status;
+  struct rusage usage;
+
+  wait4(pid, &status, 0, &usage);
+
+  if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) r.status = "timeout";
+
+  if (family == Generator::TRANSPORTATION) n = (m / 2) * (m - m / 2);
+
+  printf("%s,%s,%d,%d,%lu,%s,%.10g,%ld,%.6f,%.3f,%ld\n", Generator::family_names[family],
+	 method_names[method], m, n, seed, r.status, r.cost, r.iterations, r.seconds,
+	 r.iterations ? r.seconds * 1e6 / r.iterations : 0.0, usage.ru_maxrss);
+  fflush(stdout);
+
+  return strcmp(r.status, "timeout") != 0;
+}
+
+static void scaling (int argc, char **argv)
+{
+  puts("family,method,m,n,seed,status,cost,iterations,seconds,us_per_iteration,peak_kb");
+
+  for (int f = 0; f < Generator::FAMILIES; f++) {
+    if (!selected(Generator::family_names[f], argc, argv)) continue;
+
+    for (int method = SIMPLEX; method <= DUAL; method++) {
+      int in_time = 1;
+
+      for (int m = 16; m <= max_rows && in_time; m *= 2) {
+	int n = f == Generator::WIDE ? 16 * m : 2 * m;
+
+	for (int seed = 1; seed <= seeds && in_time; seed++)
+	  in_time = run(f, method, m, n, seed);
+      }
+    }
+  }
+}
+
+static int selected (const char *name, int argc, char **argv)
+{
+  if (optind >= argc) return 1; // all the kernels
+
+  for (int a = optind; a < argc; a++)
+    if (strcmp(argv[a], name) == 0) return 1;
+
+  return 0;
+}
+
+int main (int argc, char *argv[])
+{
+  pname = argv[0];
+
+  int opt, end_to_end = 0;
+
+  while ((opt = getopt(argc, argv, "j:s:eCHDFM:r:T:")) != -1) {
+    switch (opt) {
+    case 'j':
+      Threads::count = atoi(optarg);
+      if (Threads::count < 1) Threads::count = 1;
+      break;
+    case 's':
+      min_time = atof(optarg);
+      break;
+    case 'e':
+      end_to_end = 1;
+      break;
+    case 'C':
+      PrimalSimplex::crash = 0;
+      break;
+    case 'H':
+      Tolerances::harris = 0;
+      break;
+    case 'D':
+      Degeneracy::perturb = 0;
+      break;
+    case 'F':
+      Mixed::enabled = 1;
+      break;
+    case 'M':
+      max_rows = atoi(optarg);
+      break;
+    case 'r':
+      seeds = atoi(optarg);
+      break;
+    case 'T':
+      time_limit = atoi(optarg);
+      if (time_limit < 1) time_limit = 1;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-j threads] [-s seconds] [kernel ...]\n"
+	      "       %s -e [-C] [-H] [-D] [-F] [-M rows] [-r seeds] [-T seconds] [family ...]\n", pname, pname);
+      return 1;
+    }
+  }
+
+  if (end_to_end) {
+    scaling(argc, argv);
+    return 0;
+  }
+
+  puts("kernel,m,n,threads,repetitions,ns_per_call,ns_per_element,gflops");
+
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!selected(kernels[k].name, argc, argv)) continue;
+
+    if (kernels[k].square)
+      for (size_t s = 0; s < sizeof(square_shapes) / sizeof(square_shapes[0]); s++)
+	bench(&kernels[k], square_shapes[s].m, square_shapes[s].n);
+    else
+      for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+	bench(&kernels[k], shapes[s].m, shapes[s].n);
+  }
+
+  return 0;
+}
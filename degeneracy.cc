@@ -0,0 +1,329 @@
+#include <math.h>
+
+#include "degeneracy.h"
+#include "simplex.h"
+#include "dual.h"
+#include "pricing.h"
+#include "tolerances.h"
+#include "trace.h"
+
+/* Settings */
+int Degeneracy::perturb = 1;
+double Degeneracy::magnitude = 1e-6;
+int Degeneracy::history = 32;
+
+/* xorshift64*: the same perturbation on every platform */
+static unsigned long next_random (unsigned long *state)
+{
+  unsigned long x = *state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+
+  return x * 2685821657736338717UL;
+}
+
+/* a number in [0.5, 1) */
+static double half_uniform (unsigned long *state)
+{
+  return 0.5 + 0.5 * (double) (next_random(state) >> 11) / 9007199254740992.0; // 2^53
+}
+
+/* Create the detector of a tableau, from its current basis */
+struct Degeneracy::detector *Degeneracy::create_detector (Tableau *tab)
+{
+  struct detector *d = (struct detector *) malloc(sizeof(*d));
+  unsigned long state = 0x9E3779B97F4A7C15UL + tab->n(); // never zero
+
+  d->n = tab->n();
+  d->keys = (unsigned long *) malloc((d->n > 1 ? d->n - 1 : 1) * sizeof(unsigned long));
+  d->size = history > 0 ? history : 1;
+  d->recent = (unsigned long *) malloc(d->size * sizeof(unsigned long));
+  d->next = 0;
+  d->count = 0;
+  d->degenerate = 0;
+  d->hash = 0;
+
+  for (int j = 0; j < d->n - 1; j++)
+    d->keys[j] = next_random(&state);
+
+  for (int i = 0; i < tab->m() - 1; i++) // m - 1 to skip the reduced costs row
+    if (tab->basis_set_at(i)) d->hash ^= d->keys[tab->basis_at(i)];
+
+  return d;
+}
+
+/* Free the detector */
+void Degeneracy::delete_detector (struct detector *d)
+{
+  free(d->keys);
+  free(d->recent);
+  free(d);
+}
+
+/* Forget the bases visited */
+void Degeneracy::reset (struct detector *d)
+{
+  d->count = 0;
+  d->degenerate = 0;
+}
+
+/* Record a pivot, return STALL, CYCLE or NONE
+
+   After a nondegenerate pivot the cost is strictly better than in
+   every basis visited before, so only the new basis is remembered.
+*/
+int Degeneracy::record (struct detector *d, int leaving, int entering, int degenerate)
+{
+  if (leaving >= 0 && leaving < d->n - 1) d->hash ^= d->keys[leaving];
+  d->hash ^= d->keys[entering];
+
+  int event = NONE;
+
+  if (!degenerate) reset(d);
+
+  else {
+    for (int k = 0; k < d->count && event == NONE; k++)
+      if (d->recent[k] == d->hash) event = CYCLE;
+
+    if (++d->degenerate >= Pricing::stall_limit && event == NONE) event = STALL;
+  }
+
+  d->recent[d->next] = d->hash;
+  d->next = (d->next + 1) % d->size;
+  if (d->count < d->size) d->count++;
+
+  return event;
+}
+
+/* Perturb the right-hand sides or the costs of a tableau in canonical form
+
+   The amounts are random, between 0.5 and 1 times magnitude * (1 + |v|),
+   with v the perturbed value: the basic variables only increase (at most
+   half of the distance from their upper bound), and the reduced costs of
+   the nonbasic columns only increase, so the basis stays feasible (primal)
+   or optimal (dual). NULL if a basis index is not set.
+*/
+struct Degeneracy::perturbation *Degeneracy::perturb_tableau (Tableau *tab, int type)
+{
+  int rows = tab->m() - 1, columns = tab->n() - 1; // skip the reduced costs row and the variables
+
+  for (int i = 0; i < rows; i++)
+    if (!tab->basis_set_at(i)) return NULL;
+
+  struct perturbation *p = (struct perturbation *) malloc(sizeof(*p));
+  unsigned long state = 0x9E3779B97F4A7C15UL + (unsigned long) rows * tab->n() + type;
+
+  p->type = type;
+  p->m = tab->m();
+  p->n = tab->n();
+  p->amounts = (double *) calloc(type == RHS ? (rows > 0 ? rows : 1) : (columns > 0 ? columns : 1),
+				 sizeof(double));
+  p->columns = (int *) malloc((rows > 0 ? rows : 1) * sizeof(int));
+  p->complemented = (int *) malloc((columns > 0 ? columns : 1) * sizeof(int));
+
+  for (int i = 0; i < rows; i++)
+    p->columns[i] = tab->basis_at(i);
+
+  for (int j = 0; j < columns; j++)
+    p->complemented[j] = tab->complemented_at(j);
+
+  if (type == RHS) {
+    for (int i = 0; i < rows; i++) {
+      double value = tab->at(i, columns);
+      double amount = magnitude * (1 + fabs(value)) * half_uniform(&state);
+      double upper = tab->upper_at(p->columns[i]);
+
+      if (upper != HUGE_VAL) amount = fmin(amount, fmax((upper - value) / 2, 0.0));
+
+      p->amounts[i] = amount;
+      tab->at(i, columns, value + amount);
+    }
+  }
+
+  else {
+    double *costs = tab->row(rows);
+    int *basic = (int *) calloc(columns > 0 ? columns : 1, sizeof(int));
+
+    for (int i = 0; i < rows; i++)
+      basic[p->columns[i]] = 1;
+
+    for (int j = 0; j < columns; j++) {
+      if (basic[j]) continue;
+
+      p->amounts[j] = magnitude * (1 + fabs(costs[j])) * half_uniform(&state);
+      costs[j] += p->amounts[j];
+    }
+
+    free(basic);
+  }
+
+  return p;
+}
+
+/* Remove the perturbation from the tableau, and free it
+
+   Right-hand sides: the amount of row i was added to the unit
+   column of its basic variable, so b -= sum amount[i] * s * A[:, k],
+   with k the column and s = -1 if it was complemented since.
+
+   Costs: the amounts are the function g x, that after complementing
+   (x = u - x') is g' x + constant, with g'[j] = s g[j]. The reduced
+   costs hold it as g' - sum g'[B(i)] * row i, on every column (the
+   variables column too, holding - constant).
+*/
+void Degeneracy::remove_perturbation (Tableau *tab, struct perturbation *p)
+{
+  assert( tab->m() == p->m && tab->n() == p->n );
+
+  int rows = tab->m() - 1, columns = tab->n() - 1;
+
+  if (p->type == RHS) {
+    double *column = (double *) malloc(tab->m() * sizeof(*column));
+
+    for (int i = 0; i < rows; i++) {
+      int k = p->columns[i];
+      double amount = tab->complemented_at(k) != p->complemented[k] ? - p->amounts[i] : p->amounts[i];
+
+      if (amount == 0) continue;
+
+      tab->column(k, column);
+
+      for (int r = 0; r < tab->m(); r++) // the reduced costs row too
+	if (column[r] != 0) tab->at(r, columns, tab->at(r, columns) - amount * column[r]);
+    }
+
+    free(column);
+  }
+
+  else {
+    double *g = (double *) calloc(tab->n(), sizeof(*g));
+
+    for (int j = 0; j < columns; j++) {
+      if (tab->complemented_at(j) == p->complemented[j]) g[j] = p->amounts[j];
+      else {
+	g[j] = - p->amounts[j];
+	g[columns] -= p->amounts[j] * tab->upper_at(j);
+      }
+    }
+
+    for (int i = 0; i < rows; i++) { // eliminate the basic columns
+      double factor = g[tab->basis_at(i)];
+      if (factor == 0) continue;
+
+      double *row = tab->row(i);
+      for (int j = 0; j <= columns; j++)
+	g[j] -= factor * row[j];
+    }
+
+    double *costs = tab->row(rows);
+
+    for (int j = 0; j <= columns; j++)
+      costs[j] -= g[j];
+
+    for (int i = 0; i < rows; i++) // exact zeros, in canonical form
+      costs[tab->basis_at(i)] = 0;
+
+    free(g);
+  }
+
+  free(p->amounts);
+  free(p->columns);
+  free(p->complemented);
+  free(p);
+}
+
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  if (ev->type == Trace::ITERATION) (*(int *) arg)++;
+}
+
+/* Unit tests */
+void Degeneracy::test ()
+{
+  /* Beale's example: with Dantzig's rule and the textbook ratio
+     test the primal simplex cycles among six degenerate bases */
+
+  double buffer[] = { 1, 0, 0, 0.25,  -8,   -1, 9, /**/ 0,
+		      0, 1, 0, 0.5,  -12, -0.5, 3, /**/ 0,
+		      0, 0, 1, 0,      0,    1, 0, /**/ 1,
+		     /*--------------------------------------*/
+		      0, 0, 0, -0.75, 20, -0.5, 6, /**/ 0 };
+
+  int indices[] = {0, 1, 2};
+
+  int saved_rule = Pricing::rule;
+  int saved_harris = Tolerances::harris;
+  int saved_perturb = perturb;
+  int saved_level = Trace::level;
+  int iterations;
+
+  Pricing::rule = Pricing::DANTZIG;
+  Tolerances::harris = 0;
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &iterations);
+
+  for (perturb = 1; perturb >= 0; perturb--) {
+    Tableau *tab = new Tableau(4, 8, buffer, indices);
+
+    iterations = 0;
+    double cost = PrimalSimplex::simplex(tab);
+
+    printf("\nDegeneracy: Beale's example, %s: cost %g, %d iterations\n",
+	   perturb ? "perturbed" : "Bland's rule only", cost, iterations);
+
+    if (perturb) {
+      puts("Degeneracy: final tableau, without the perturbation:");
+      tab->print();
+    }
+
+    delete tab;
+  }
+
+  Trace::set_callback(NULL, NULL);
+  Trace::level = saved_level;
+  Pricing::rule = saved_rule;
+  Tolerances::harris = saved_harris;
+
+  // the costs of a dual feasible tableau, perturbed and restored
+
+  double buffer2[] = { -2, -2, -1, 1, 0, /**/ -6,
+		       -1, -2, -3, 0, 1, /**/ -5,
+		      /*--------------------------*/
+		        3,  0,  5, 0, 0, /**/  0 };
+
+  int indices2[] = {3, 4};
+
+  Tableau *tab2 = new Tableau(3, 6, buffer2, indices2);
+  Tableau *tab3 = new Tableau(3, 6, buffer2, indices2);
+
+  tab2->upper_at(0, 2.0); // complemented after the perturbation
+  tab3->upper_at(0, 2.0);
+
+  struct perturbation *p = perturb_tableau(tab2, COSTS);
+
+  tab2->complement_column(0);
+  tab2->pivot(0, 1);
+  tab2->basis_at(0, 1);
+  remove_perturbation(tab2, p);
+
+  tab3->complement_column(0);
+  tab3->pivot(0, 1);
+  tab3->basis_at(0, 1);
+
+  double difference = 0;
+
+  for (int j = 0; j < tab2->n(); j++)
+    difference = fmax(difference, fabs(tab2->at(2, j) - tab3->at(2, j)));
+
+  puts("\nDegeneracy: pivot on a tableau with perturbed costs, perturbation removed:");
+  tab2->print();
+  printf("Degeneracy: largest difference from the unperturbed costs: %g\n", difference);
+
+  delete tab2;
+  delete tab3;
+
+  perturb = saved_perturb;
+}
@@ -0,0 +1,115 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef DEGENERACY_H
+#define DEGENERACY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Protection of the methods from degeneracy: stall and cycle
+  detection, and perturbation of the tableau.
+
+  The detector keeps a hash of the current basis set (the xor of a
+  random key for every basic column, updated by the pivots) and the
+  hashes of the bases visited since the last nondegenerate pivot. A
+  degenerate pivot back to one of them is a cycle, and
+  Pricing::stall_limit consecutive degenerate pivots are a stall.
+
+  On the first stall or cycle the method perturbs the tableau: the
+  primal simplex adds small random amounts to the right-hand sides
+  (the basic variables), the dual simplex to the reduced costs of
+  the nonbasic columns, so the ties among the ratios disappear. If
+  the method stalls again it falls back on Bland's rule, that can't
+  cycle, until the next nondegenerate pivot.
+
+  The perturbation is removed exactly at the end. A perturbation of
+  the right-hand sides is a combination of the columns that were in
+  basis when it was added (they were unit columns), and the pivots
+  transform those columns as they transform the right-hand sides:
+  the same combination of their current columns is subtracted. A
+  perturbation of the costs is a linear function of the variables,
+  that the pivots express in the current nonbasic variables: it is
+  subtracted after eliminating the basic ones with their rows. The
+  complemented columns change sign in both.
+
+  Without the perturbation the final basis can be slightly infeasible
+  (primal), or not optimal (dual): the other method cleans it up in a
+  few pivots, without perturbation.
+*/
+
+namespace Degeneracy {
+
+  enum {     // events of the detector
+    NONE,
+    STALL,   // too many consecutive degenerate pivots
+    CYCLE    // a degenerate pivot back to a basis already visited
+  };
+
+  enum {     // perturbations
+    RHS,     // of the right-hand sides (primal simplex)
+    COSTS    // of the reduced costs (dual simplex)
+  };
+
+  /* Settings */
+  extern int perturb;       // perturb the tableau on a stall (1, default), or only Bland's rule
+  extern double magnitude;  // of the perturbation, relative to the perturbed values
+  extern int history;       // bases remembered by the detector
+
+  struct detector {
+    int n;                  // columns of the tableau (variables column included)
+    unsigned long *keys;    // random key of every column (n - 1 entries)
+    unsigned long hash;     // of the current basis set
+
+    unsigned long *recent;  // hashes of the bases visited since the last nondegenerate pivot
+    int size;               // capacity of recent (history)
+    int next;               // next position of recent to write
+    int count;              // hashes in recent
+
+    int degenerate;         // consecutive degenerate pivots
+  };
+
+  struct perturbation {
+    int type;               // RHS or COSTS
+    int m, n;               // of the tableau, when it was perturbed
+    double *amounts;        // added to the rows (RHS) or to the columns (COSTS)
+    int *columns;           // the basic column of every row, when it was perturbed (RHS)
+    int *complemented;      // the complemented columns, when it was perturbed
+  };
+
+  /* Create the detector of a tableau, from its current basis */
+  struct detector *create_detector (Tableau *tab);
+
+  /* Free the detector */
+  void delete_detector (struct detector *d);
+
+  /* Record a pivot (the columns leaving and entering the basis),
+     return STALL, CYCLE or NONE */
+  int record (struct detector *d, int leaving, int entering, int degenerate);
+
+  /* Forget the bases visited (after a nondegenerate step) */
+  void reset (struct detector *d);
+
+  /* Perturb the right-hand sides or the costs of a tableau in
+     canonical form (with every basis index set) */
+  struct perturbation *perturb_tableau (Tableau *tab, int type);
+
+  /* Remove the perturbation from the tableau, and free it */
+  void remove_perturbation (Tableau *tab, struct perturbation *p);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
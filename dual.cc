@@ -1,47 +1,146 @@
+#include <math.h>
+
 #include "dual.h"
+#include "kernels.h"
+#include "trace.h"
+#include "snapshot.h"
+#include "pricing.h"
+#include "tolerances.h"
+#include "degeneracy.h"
+#include "simplex.h"
 
 /* Check if the tableau is in the correct form for the dual simplex method */
 int DualSimplex::check_correct_form (Tableau *tab)
 {
-  for (int j = 0; j < tab->n() - 1; j++) { // skip the current cost
-    if (tab->at(tab->m() - 1, j) < 0) { // found a negative reduced cost
-      return 0;
-    }
+  // skip the current cost
+  if (Kernels::first_below(tab->row(tab->m() - 1), - Tolerances::dual, tab->n() - 1) != -1) {
+    // found a negative reduced cost (below the dual tolerance)
+    return 0;
   }
 
   // if no reduced cost is negative, the tableau is in the correct for for the dual
   return 1;
 }
 
+/* Settings */
+int DualSimplex::steepest_edge = 1;
+int DualSimplex::bound_flipping = 1;
+
+static const double tie_tolerance = 1e-12;   // ratios closer than this are ties (textbook test)
+static const double weight_tolerance = 1e-12; // smallest weight
+
+/* Check if column j is the unit column of row i */
+static int is_unit_column (Tableau *tab, int j, int i)
+{
+  for (int k = 0; k < tab->m() - 1; k++) // m - 1 to skip the reduced costs row
+    if (tab->at(k, j) != (k == i ? 1.0 : 0.0)) return 0;
+
+  return 1;
+}
+
+/* Create the state for a tableau in canonical form */
+struct DualSimplex::dual_state *DualSimplex::create_state (Tableau *tab)
+{
+  struct dual_state *ds = (struct dual_state *) malloc(sizeof(*ds));
+
+  ds->m = tab->m();
+  ds->n = tab->n();
+
+  ds->reference = (int *) malloc((ds->m - 1) * sizeof(int));
+  ds->weights = (double *) malloc((ds->m - 1) * sizeof(double));
+  ds->products = (double *) malloc((ds->m - 1) * sizeof(double));
+  ds->flips = (int *) malloc((ds->n - 1) * sizeof(int));
+  ds->flip_count = 0;
+  ds->bland = 0;
+
+  for (int k = 0; k < ds->m - 1; k++) {
+    if (!tab->basis_set_at(k)) // not given: search the unit column of the row
+      for (int j = 0; j < ds->n - 1 && !tab->basis_set_at(k); j++)
+	if (is_unit_column(tab, j, k)) tab->basis_at(k, j);
+
+    ds->reference[k] = tab->basis_set_at(k) ? tab->basis_at(k) : -1;
+  }
+
+  for (int i = 0; i < ds->m - 1; i++) { // 1 in a canonical tableau, but computed anyway
+    ds->weights[i] = 0;
+
+    for (int k = 0; k < ds->m - 1; k++) {
+      if (ds->reference[k] == -1) continue;
+
+      double value = tab->at(i, ds->reference[k]);
+      ds->weights[i] += value * value;
+    }
+
+    if (ds->weights[i] == 0) ds->weights[i] = 1;
+  }
+
+  return ds;
+}
+
+/* Free the state */
+void DualSimplex::delete_state (struct dual_state *ds)
+{
+  free(ds->reference);
+  free(ds->weights);
+  free(ds->products);
+  free(ds->flips);
+  free(ds);
+}
+
+/* Primal infeasibility of the i-th basic variable (0 if feasible,
+   within the primal tolerance) */
+static double infeasibility (Tableau *tab, int i)
+{
+  double value = tab->at(i, tab->n() - 1);
+  double upper = tab->upper_at(tab->basis_at(i));
+
+  if (value < - Tolerances::primal) return - value;
+  if (value > upper + Tolerances::primal) return value - upper;
+
+  return 0;
+}
+
 /* Test the feasibility of the current solution */
 int DualSimplex::test_feasibility (Tableau *tab)
 {
   for (int i = 0; i < tab->m() - 1; i++) { /* m - 1 to exclude the reduced costs row */
-    if (tab->at(i, tab->n() - 1) < 0) return 0; // check if the i-th variable is positive
+    if (infeasibility(tab, i) > 0) return 0; // check if the i-th variable is within its bounds
   }
 
-  // if no variable is negative, the current solution is feasible
+  // if no variable is out of its bounds, the current solution is feasible
   return 1;
 }
 
 /* Select the entering row
 
-   Uses Bland's rule, i.e. select the negative variable
+   With dual steepest edge, select the variable having the largest
+   squared infeasibility, relative to the weight of its row.
+
+   Otherwise uses Bland's rule, i.e. select the infeasible variable
    having the smallest subscript
 */
-int DualSimplex::select_pivot_row (Tableau *tab)
+int DualSimplex::select_pivot_row (Tableau *tab, struct dual_state *ds)
 {
   int min_index = -1;
   int min_index_col = -1;
+  double max_score = 0;
 
   for (int i = 0; i < tab->m() - 1; i++) { /* m - 1 to exclude the reduced costs row */
-    if (tab->at(i, tab->n() - 1) < 0) {
+    double value = infeasibility(tab, i);
+    if (value == 0) continue;
+
+    if (steepest_edge && !ds->bland) {
+      double score = value * value / ds->weights[i];
 
-      if (tab->basis_at(i) < min_index_col || min_index == -1) {
+      if (score > max_score || min_index == -1) {
 	min_index = i;
-	min_index_col = tab->basis_at(i);
+	max_score = score;
       }
-      
+    }
+
+    else if (tab->basis_at(i) < min_index_col || min_index == -1) {
+      min_index = i;
+      min_index_col = tab->basis_at(i);
     }
   }
 
@@ -52,40 +151,159 @@ int DualSimplex::select_pivot_row (Tableau *tab)
 int DualSimplex::test_unlimited (Tableau *tab, int entering_row)
 {
   for (int j = 0; j < tab->n() - 1; j++) { // n - 1 to exclude the variable column
-    if (tab->at(entering_row, j) < 0) return 0; /* check if the j-th component of
-						   the entering row is negative */
+    if (tab->at(entering_row, j) < - Tolerances::pivot) return 0; /* check if the j-th component
+								   of the entering row is negative */
   }
 
   // if no element of the entering row is negative, the problem is unlimited
   return 1;
 }
 
+struct breakpoint {
+  double ratio;
+  double bound; // Harris bound of the breakpoints from this one on
+  double alpha; // element of the pivot row
+  int j;
+};
+
+static int compare_breakpoints (const void *a, const void *b)
+{
+  const struct breakpoint *x = (const struct breakpoint *) a;
+  const struct breakpoint *y = (const struct breakpoint *) b;
+
+  if (x->ratio != y->ratio) return x->ratio < y->ratio ? -1 : 1;
+  return x->j - y->j;
+}
+
 /* Select the entering column
 
-   Uses Bland's rule, i.e. select the smallest ratio, and,
-   when multiple variables in base give the same ratio,
-   select the one having the smallest subscript
-   (a.k.a. the one associated with the smallest column position)
+   The ratios between the reduced costs and the negative elements
+   of the pivot row are the breakpoints of the dual cost, along the
+   direction given by the row. The dual cost increases with slope
+   equal to the infeasibility of the row, and every breakpoint
+   decreases the slope by |a[i][j]| * u[j]: with the bound-flipping
+   test the breakpoints are passed while the slope stays positive,
+   and their variables are flipped to the opposite bound (the column
+   is complemented). Without it, or with no upper bounds, the first
+   breakpoint is taken.
+
+   Among tied breakpoints the element of the row having the largest
+   absolute value is chosen (and then the smallest subscript), for
+   a stable pivot. With the Harris ratio test (see Tolerances) the
+   ties are the breakpoints not beyond the bound
+
+     min (c[j] + tolerance) / |a[i][j]|
+
+   of the remaining ones, so the reduced costs can become negative
+   by at most the dual tolerance; otherwise they are the ratios
+   closer than a rounding error. With Bland's rule the smallest
+   subscript is chosen, that can't cycle.
+
+   Returns -1 if all the breakpoints can be passed: the row can't
+   become feasible, so the dual cost is plus infinity.
 */
-int DualSimplex::select_pivot_column (Tableau *tab, int i)
+int DualSimplex::select_pivot_column (Tableau *tab, int i, struct dual_state *ds)
 {
-  double min_ratio = 0;
-  int min_ratio_position = -1;
+  struct breakpoint *points = (struct breakpoint *) malloc((tab->n() - 1) * sizeof(*points));
+  int count = 0;
 
   for (int j = 0; j < tab->n() - 1; j++) { /* n - 1 to exclude the variable row */
-    if (tab->at(i, j) >= 0) continue;
+    if (tab->at(i, j) >= - Tolerances::pivot) continue; // a rounding error, not a pivot
 
-    double ratio = tab->at(tab->m() - 1, j) / (- tab->at(i, j));
+    // a reduced cost slightly negative (rounding errors) is a zero
+    double cost = fmax(tab->at(tab->m() - 1, j), 0.0);
 
-    if (min_ratio_position == -1 ||
-	ratio < min_ratio) {
+    points[count].ratio = cost / (- tab->at(i, j));
+    points[count].bound = (cost + Tolerances::dual) / (- tab->at(i, j));
+    points[count].alpha = tab->at(i, j);
+    points[count].j = j;
+    count++;
+  }
 
-      min_ratio = ratio;
-      min_ratio_position = j;
+  qsort(points, count, sizeof(*points), compare_breakpoints);
+
+  for (int k = count - 2; k >= 0; k--) // the bounds of the sorted suffixes
+    points[k].bound = fmin(points[k].bound, points[k + 1].bound);
+
+  double slope = - tab->at(i, tab->n() - 1); // the variable is negative
+  int selected = -1;
+
+  ds->flip_count = 0;
+
+  int harris = Tolerances::harris && !ds->bland;
+
+  for (int k = 0; k < count; ) {
+
+    // the group of tied breakpoints, and its most stable element
+
+    int best = k, end = k + 1;
+    double pass = fabs(points[k].alpha) * tab->upper_at(points[k].j);
+
+    for (; end < count && (harris ? points[end].ratio <= points[k].bound :
+			   points[end].ratio - points[k].ratio <= tie_tolerance); end++) {
+      pass += fabs(points[end].alpha) * tab->upper_at(points[end].j);
+      if ((harris || steepest_edge) && !ds->bland &&
+	  fabs(points[end].alpha) > fabs(points[best].alpha))
+	best = end;
+    }
+
+    if (!bound_flipping || pass == HUGE_VAL || slope - pass <= 0) {
+      selected = points[best].j;
+      break;
     }
+
+    // the slope is still positive after the group: flip it
+
+    slope -= pass;
+
+    for (; k < end; k++)
+      ds->flips[ds->flip_count++] = points[k].j;
   }
 
-  return min_ratio_position;
+  if (selected == -1) ds->flip_count = 0;
+
+  free(points);
+
+  return selected;
+}
+
+/* Update the weights before the pivot on (i, j)
+
+   With r the pivot row and a the pivot column, and p[k] the product
+   between the rows k and r of the inverse:
+
+     w[r] = w[r] / a[r]^2
+     w[k] = w[k] - 2 (a[k] / a[r]) p[k] + (a[k] / a[r])^2 w[r]
+*/
+void DualSimplex::update_weights (Tableau *tab, struct dual_state *ds, int i, int j)
+{
+  int rows = ds->m - 1;
+  double pivot = tab->at(i, j);
+  double weight = ds->weights[i];
+
+  memset(ds->products, 0, rows * sizeof(double));
+
+  for (int k = 0; k < rows; k++) {
+    if (ds->reference[k] == -1) continue;
+
+    double value = tab->at(i, ds->reference[k]);
+    if (value == 0) continue;
+
+    for (int l = 0; l < rows; l++)
+      ds->products[l] += tab->at(l, ds->reference[k]) * value;
+  }
+
+  for (int k = 0; k < rows; k++) {
+    double alpha = tab->at(k, j);
+    if (k == i || alpha == 0) continue;
+
+    double ratio = alpha / pivot;
+    double w = ds->weights[k] - 2 * ratio * ds->products[k] + ratio * ratio * weight;
+
+    ds->weights[k] = fmax(w, weight_tolerance);
+  }
+
+  ds->weights[i] = fmax(weight / (pivot * pivot), weight_tolerance);
 }
 
 /*
@@ -117,42 +335,112 @@ int DualSimplex::select_pivot_column (Tableau *tab, int i)
 double DualSimplex::simplex (Tableau *tab)
 {
   // step 1
-  int i, j;
+
+  // a variable with a negative reduced cost starts at its upper bound, if it has one
+  for (int k = 0; k < tab->n() - 1; k++)
+    if (tab->at(tab->m() - 1, k) < - Tolerances::dual && tab->upper_at(k) != HUGE_VAL)
+      tab->complement_column(k);
 
   if (!check_correct_form(tab)) {
-    printf("Error: invalid tableau for dual simplex method: a reduced cost is negative\n");
+    TRACE_MESSAGE(Trace::SUMMARY, "dual", "invalid tableau for dual simplex method: "
+		  "a reduced cost is negative");
     throw new InvalidFormException();
   }
 
+  return iterate(tab, 1, Degeneracy::perturb);
+}
+
+double DualSimplex::iterate (Tableau *tab, int checkpoints, int perturb)
+{
+  int i, j;
+  int iteration = 0;
+
+  struct dual_state *ds = create_state(tab);
+  struct Degeneracy::detector *dd = Degeneracy::create_detector(tab);
+  struct Degeneracy::perturbation *perturbation = NULL;
+
  step_2:
   if (test_feasibility(tab)) {
-    printf("Optimal solution found!\n");
+    delete_state(ds);
+    Degeneracy::delete_detector(dd);
+
+    if (perturbation) { // the basis can be slightly not optimal, without the perturbation
+      Degeneracy::remove_perturbation(tab, perturbation);
+
+      if (!PrimalSimplex::test_optimality(tab)) {
+	TRACE_MESSAGE(Trace::SUMMARY, "dual", "perturbation removed, primal simplex cleanup");
+	PrimalSimplex::iterate(tab, 0, 0);
+      }
+    }
 
     // extract cost from the tableau (the sign is inverted)
     double cost = - tab->at(tab->m() - 1, tab->n() - 1);
 
+    TRACE_MESSAGE(Trace::SUMMARY, "dual", "optimal solution found, %d iterations, cost %f",
+		  iteration, cost);
     return cost;
   }
 
   else {
-    i = select_pivot_row(tab);
-    printf("Selected pivot: i = %d, ", i);
+    i = select_pivot_row(tab, ds);
+
+    // a variable above its upper bound becomes negative, once complemented
+    if (tab->at(i, tab->n() - 1) > 0)
+      tab->complement_column(tab->basis_at(i));
   }
   
   // step 3
-  if (test_unlimited(tab, i)) {
-    printf("The problem is unlimited\n");
+  if (test_unlimited(tab, i) || (j = select_pivot_column(tab, i, ds)) == -1) {
+    TRACE_MESSAGE(Trace::SUMMARY, "dual", "the problem is unlimited (row %d)", i);
+    delete_state(ds);
+    Degeneracy::delete_detector(dd);
+    if (perturbation) Degeneracy::remove_perturbation(tab, perturbation);
     throw new UnlimitedException();
   }
   
   // step 4
-  j = select_pivot_column(tab, i);
-  printf("j = %d\n", j);
+  for (int k = 0; k < ds->flip_count; k++) { // bound flips
+    TRACE_MESSAGE(Trace::ITERATIONS, "dual", "bound flip of column %d", ds->flips[k]);
+    tab->complement_column(ds->flips[k]);
+  }
+
+  int leaving = tab->basis_at(i);
+  int degenerate = fabs(tab->at(tab->m() - 1, j)) <= Tolerances::dual; // the dual cost doesn't change
+
+  if (steepest_edge)
+    update_weights(tab, ds, i, j);
+
   tab->basis_at(i, j);
 
   // step 5
   tab->pivot(i, j);
 
+  iteration++;
+  TRACE_ITERATION("dual", iteration, i, j, - tab->at(tab->m() - 1, tab->n() - 1));
+  TRACE_TABLEAU("dual", "after the pivot", tab);
+
+  /* a stall or a cycle perturbs the costs the first time, then
+     uses Bland's rule until the next nondegenerate pivot */
+
+  switch (Degeneracy::record(dd, leaving, j, degenerate)) {
+  case Degeneracy::NONE:
+    if (!degenerate) ds->bland = 0;
+    break;
+
+  default:
+    if (perturb && !perturbation &&
+	(perturbation = Degeneracy::perturb_tableau(tab, Degeneracy::COSTS))) {
+      TRACE_MESSAGE(Trace::SUMMARY, "dual", "degenerate stall at iteration %d, "
+		    "costs perturbed", iteration);
+      Degeneracy::reset(dd);
+    }
+
+    else ds->bland = 1;
+  }
+
+  // the perturbed tableau isn't saved (the last checkpoint stays valid)
+  if (checkpoints && !perturbation) Snapshot::checkpoint(tab, DUAL, iteration);
+
   goto step_2;
 }
 
@@ -181,4 +469,25 @@ void DualSimplex::test()
   tab->print();
 
   delete tab;
+
+  // the same problem, with upper bounds on the first two variables
+
+  Tableau *tab2 = new Tableau(3, 6, buffer, indices);
+
+  tab2->upper_at(0, 1.0);
+  tab2->upper_at(1, 1.5);
+
+  puts("\nDual Simplex: original tableau, with upper bounds:");
+  tab2->print();
+
+  try {
+    simplex(tab2);
+  } catch (TableauException *ex) {
+    delete ex;
+  }
+
+  puts("\nDual Simplex: final tableau, after the bound flips and the dual simplex method:");
+  tab2->print();
+
+  delete tab2;
 }
@@ -20,14 +20,57 @@ namespace DualSimplex {
   
   // public:
 
-  /* Dual Simplex Method */
+  /* Dual Simplex Method (the variables having a negative reduced
+     cost and an upper bound start at the bound, complemented) */
   double simplex (Tableau *tab);
 
   /* Unit tests */
   void test ();
 
+  /* Settings */
+  extern int steepest_edge;  // 1: dual steepest-edge row selection, 0: Bland's rule
+  extern int bound_flipping; // 1: bound-flipping ratio test, 0: minimum ratio test
+
+  /* On a stall or a cycle of degenerate pivots (the dual cost doesn't
+     increase) the reduced costs are perturbed the first time, then the
+     method falls back on Bland's rule, that can't cycle, until the next
+     nondegenerate pivot (see Degeneracy) */
+
   // private:
 
+  /* Iterations of the dual simplex, on a tableau in the correct form,
+     writing the checkpoints of the tableau if requested (see Snapshot),
+     and perturbing the costs on a stall if requested (see Degeneracy) */
+  double iterate (Tableau *tab, int checkpoints, int perturb);
+
+  /*
+     State of the pricing of the dual method.
+
+     The columns of the initial basis, that is an identity in the
+     initial (canonical) tableau, hold the inverse of the current
+     basis matrix: the weight of a row is the squared norm of the
+     same row of the inverse, updated at every pivot.
+  */
+  struct dual_state {
+    int m, n;
+
+    int *reference;   // columns of the initial basis, -1 if unknown (m - 1 entries)
+    double *weights;  // squared norms of the rows of the inverse (m - 1 entries)
+    double *products; // work vector (m - 1 entries)
+
+    int *flips;       // columns to complement before the pivot (n - 1 entries)
+    int flip_count;
+
+    int bland;        // 1 while falling back on Bland's rule
+  };
+
+  /* Create the state for a tableau in canonical form (the basis
+     variables that are not set are searched among the unit columns) */
+  struct dual_state *create_state (Tableau *tab);
+
+  /* Free the state */
+  void delete_state (struct dual_state *ds);
+
   /* Check if the tableau is in the correct form for the dual simplex method */
   int check_correct_form (Tableau *tab);
 
@@ -35,13 +78,16 @@ namespace DualSimplex {
   int test_feasibility (Tableau *tab);
 
   /* Select the entering row */
-  int select_pivot_row (Tableau *tab);
+  int select_pivot_row (Tableau *tab, struct dual_state *ds);
 
   /* Test if the cost is plus infinity in the dual simplex */
   int test_unlimited (Tableau *tab, int entering_row);
 
-  /* Select the entering column */
-  int select_pivot_column (Tableau *tab, int i);
+  /* Select the entering column, and the columns whose bounds are flipped */
+  int select_pivot_column (Tableau *tab, int i, struct dual_state *ds);
+
+  /* Update the weights before the pivot on (i, j) */
+  void update_weights (Tableau *tab, struct dual_state *ds, int i, int j);
 
 }
 
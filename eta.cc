@@ -0,0 +1,148 @@
+#include "eta.h"
+
+EtaFile::EtaFile (int m)
+  : _m(m), etas(0), etas_size(m), _nnz(0), nnz_size(4 * m)
+{
+  eta_row   = (int *) malloc(etas_size * sizeof(*eta_row));
+  eta_start = (int *) malloc((etas_size + 1) * sizeof(*eta_start));
+  eta_start[0] = 0;
+
+  index = (int *) malloc(nnz_size * sizeof(*index));
+  value = (double *) malloc(nnz_size * sizeof(*value));
+}
+
+EtaFile::~EtaFile ()
+{
+  free(eta_row);
+  free(eta_start);
+  free(index);
+  free(value);
+}
+
+/* eta file operations */
+
+void EtaFile::clear ()
+{
+  etas = 0;
+  _nnz = 0;
+}
+
+void EtaFile::push (int row, double *column)
+{
+  /*
+    The pivot on element "row" of the transformed column a
+    is described by the eta vector:
+
+      eta[row] = 1 / a[row]
+      eta[i]   = - a[i] / a[row]   (i != row)
+   */
+
+  assert( row >= 0 && row < m() );
+  assert( column[row] != 0.0 );
+
+  if (etas == etas_size) { // make room for another eta
+    etas_size *= 2;
+    eta_row   = (int *) realloc(eta_row, etas_size * sizeof(*eta_row));
+    eta_start = (int *) realloc(eta_start, (etas_size + 1) * sizeof(*eta_start));
+  }
+
+  if (_nnz + m() > nnz_size) { // make room for a full column
+    while (_nnz + m() > nnz_size) nnz_size *= 2;
+    index = (int *) realloc(index, nnz_size * sizeof(*index));
+    value = (double *) realloc(value, nnz_size * sizeof(*value));
+  }
+
+  double pivot = column[row];
+
+  index[_nnz] = row; // the pivot entry is always the first one
+  value[_nnz] = 1.0 / pivot;
+  _nnz++;
+
+  for (int i = 0; i < m(); i++) {
+    if (i == row || column[i] == 0.0) continue;
+
+    index[_nnz] = i;
+    value[_nnz] = - column[i] / pivot;
+    _nnz++;
+  }
+
+  eta_row[etas] = row;
+  etas++;
+  eta_start[etas] = _nnz;
+}
+
+void EtaFile::ftran (double *x)
+{
+  /* apply E_1, E_2, ..., E_k in order */
+
+  for (int t = 0; t < etas; t++) {
+    int r = eta_row[t];
+    double xr = x[r];
+
+    if (xr == 0.0) continue; // the eta leaves the vector unchanged
+
+    int k = eta_start[t];
+    x[r] = xr * value[k];
+
+    for (k++; k < eta_start[t + 1]; k++)
+      x[index[k]] += xr * value[k];
+  }
+}
+
+void EtaFile::btran (double *y)
+{
+  /* apply E_k, ..., E_2, E_1 in order: every eta
+     only changes the component of its pivot row */
+
+  for (int t = etas - 1; t >= 0; t--) {
+    double sum = 0.0;
+
+    for (int k = eta_start[t]; k < eta_start[t + 1]; k++)
+      sum += y[index[k]] * value[k];
+
+    y[eta_row[t]] = sum;
+  }
+}
+
+/* unit tests */
+void EtaFile::test ()
+{
+  /* invert the matrix used in the Matrix unit tests:
+
+     0 0 3
+     0 3 0
+     3 0 0
+  */
+
+  double columns[3][3] = { { 0, 0, 3 },
+			   { 0, 3, 0 },
+			   { 3, 0, 0 } };
+
+  EtaFile *eta = new EtaFile(3);
+
+  for (int j = 0; j < 3; j++) {
+    double col[3];
+    memcpy(col, columns[j], sizeof(col));
+
+    eta->ftran(col);
+    eta->push(2 - j, col); // pivot on the anti-diagonal
+  }
+
+  puts("\nEta file: B^-1 * B (columns):");
+
+  for (int j = 0; j < 3; j++) {
+    double col[3];
+    memcpy(col, columns[j], sizeof(col));
+
+    eta->ftran(col);
+    printf("%.5f %.5f %.5f\n", col[0], col[1], col[2]);
+  }
+
+  double row[3] = { 1, 2, 3 };
+  eta->btran(row);
+
+  puts("\nEta file: (1 2 3) * B^-1:");
+  printf("%.5f %.5f %.5f\n", row[0], row[1], row[2]);
+
+  delete eta;
+}
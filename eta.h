@@ -0,0 +1,65 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef ETA_FILE_H
+#define ETA_FILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+  Product form of the inverse of a basis matrix.
+
+  The inverse is kept as a sequence of elementary matrices
+  (the "eta file"): B^-1 = E_k * ... * E_2 * E_1
+
+  Every E_t is an identity matrix with a single column
+  (the pivot row r of the t-th pivot) replaced by the eta vector.
+  Only the nonzero entries of the eta vectors are stored.
+*/
+
+class EtaFile {
+
+ public:
+  EtaFile (int m);
+  virtual ~EtaFile ();
+
+  /* getters */
+
+  inline int m ()     { return _m; };
+  inline int count () { return etas; };     // number of elementary matrices
+  inline int nnz ()   { return _nnz; };     // nonzeros stored in the file
+
+  /* eta file operations */
+
+  void clear ();                       // reset to the identity
+  void push (int row, double *column); /* append the pivot on the given row
+					  of an already transformed column */
+
+  void ftran (double *x); // x := B^-1 x       (forward transformation)
+  void btran (double *y); // y := y^T B^-1     (backward transformation)
+
+  /* unit tests */
+  static void test ();
+
+ protected:
+  int _m;
+
+  int etas, etas_size;  // number of etas and allocated slots
+  int *eta_row;         // pivot row of each eta
+  int *eta_start;       // first entry of each eta in the arrays below
+
+  int _nnz, nnz_size;   // stored entries and allocated entries
+  int *index;           // row index of each entry
+  double *value;        // value of each entry
+
+};
+
+#endif
@@ -0,0 +1,640 @@
+#include <math.h>
+
+#include "factor.h"
+
+/* elements smaller than this are never used as pivots */
+static const double zero_tolerance = 1e-11;
+
+BasisFactor::BasisFactor (int m)
+  : update_method(FOREST_TOMLIN), threshold(0.1), search_limit(4),
+    _m(m), _updates(0)
+{
+  u_index = (int **) calloc(m, sizeof(*u_index));
+  u_value = (double **) calloc(m, sizeof(*u_value));
+  u_len = (int *) calloc(m, sizeof(*u_len));
+  u_size = (int *) calloc(m, sizeof(*u_size));
+  diag = (double *) calloc(m, sizeof(*diag));
+
+  pos_row = (int *) malloc(m * sizeof(*pos_row));
+  pos_col = (int *) malloc(m * sizeof(*pos_col));
+  row_pos = (int *) malloc(m * sizeof(*row_pos));
+  col_pos = (int *) malloc(m * sizeof(*col_pos));
+
+  eta_init(&l_etas);
+  eta_init(&r_etas);
+
+  pf_etas = new EtaFile(m);
+
+  spike = (double *) calloc(m, sizeof(*spike));
+  work = (double *) calloc(m, sizeof(*work));
+}
+
+BasisFactor::~BasisFactor ()
+{
+  for (int i = 0; i < m(); i++) {
+    free(u_index[i]);
+    free(u_value[i]);
+  }
+
+  free(u_index);
+  free(u_value);
+  free(u_len);
+  free(u_size);
+  free(diag);
+
+  free(pos_row);
+  free(pos_col);
+  free(row_pos);
+  free(col_pos);
+
+  eta_free(&l_etas);
+  eta_free(&r_etas);
+
+  delete pf_etas;
+
+  free(spike);
+  free(work);
+}
+
+/* helpers */
+
+void BasisFactor::append (int row, int col, double value)
+{
+  if (u_len[row] == u_size[row]) {
+    u_size[row] = u_size[row] ? 2 * u_size[row] : 4;
+    u_index[row] = (int *) realloc(u_index[row], u_size[row] * sizeof(**u_index));
+    u_value[row] = (double *) realloc(u_value[row], u_size[row] * sizeof(**u_value));
+  }
+
+  u_index[row][u_len[row]] = col;
+  u_value[row][u_len[row]] = value;
+  u_len[row]++;
+}
+
+int BasisFactor::find (int row, int col)
+{
+  for (int k = 0; k < u_len[row]; k++)
+    if (u_index[row][k] == col) return k;
+
+  return -1;
+}
+
+void BasisFactor::eta_init (struct eta_list *list)
+{
+  list->count = 0;
+  list->size = 16;
+  list->pivot = (int *) malloc(list->size * sizeof(*list->pivot));
+  list->start = (int *) malloc((list->size + 1) * sizeof(*list->start));
+  list->start[0] = 0;
+
+  list->nnz = 0;
+  list->nnz_size = 64;
+  list->index = (int *) malloc(list->nnz_size * sizeof(*list->index));
+  list->value = (double *) malloc(list->nnz_size * sizeof(*list->value));
+}
+
+void BasisFactor::eta_free (struct eta_list *list)
+{
+  free(list->pivot);
+  free(list->start);
+  free(list->index);
+  free(list->value);
+}
+
+void BasisFactor::eta_begin (struct eta_list *list, int pivot)
+{
+  if (list->count == list->size) {
+    list->size *= 2;
+    list->pivot = (int *) realloc(list->pivot, list->size * sizeof(*list->pivot));
+    list->start = (int *) realloc(list->start, (list->size + 1) * sizeof(*list->start));
+  }
+
+  list->pivot[list->count] = pivot;
+}
+
+void BasisFactor::eta_add (struct eta_list *list, int index, double value)
+{
+  if (list->nnz == list->nnz_size) {
+    list->nnz_size *= 2;
+    list->index = (int *) realloc(list->index, list->nnz_size * sizeof(*list->index));
+    list->value = (double *) realloc(list->value, list->nnz_size * sizeof(*list->value));
+  }
+
+  list->index[list->nnz] = index;
+  list->value[list->nnz] = value;
+  list->nnz++;
+}
+
+void BasisFactor::eta_end (struct eta_list *list)
+{
+  if (list->nnz == list->start[list->count]) return; // empty eta, discard it
+
+  list->count++;
+  list->start[list->count] = list->nnz;
+}
+
+/* candidate lists, by number of elements, used by the Markowitz search */
+
+static void bucket_insert (int *head, int *next, int *prev, int item, int count)
+{
+  next[item] = head[count];
+  prev[item] = -1;
+  if (head[count] != -1) prev[head[count]] = item;
+  head[count] = item;
+}
+
+static void bucket_remove (int *head, int *next, int *prev, int item, int count)
+{
+  if (prev[item] != -1) next[prev[item]] = next[item];
+  else head[count] = next[item];
+
+  if (next[item] != -1) prev[next[item]] = prev[item];
+}
+
+/* factorization
+
+   Gaussian elimination on the active submatrix, keeping the rows
+   (with values) and the columns (only the row indices) of the
+   nonzero elements. At every step:
+
+   1) Search the pivot: rows and columns are examined by increasing
+      number of elements, and the search stops when no better
+      Markowitz cost can be found, or after search_limit candidates.
+
+   2) Eliminate the pivot column from the other rows, storing the
+      multipliers in a column eta. The pivot row becomes a row of U.
+*/
+int BasisFactor::factorize (int *col_start, int *row_index, double *value)
+{
+  /* reset the previous factorization */
+
+  for (int i = 0; i < m(); i++)
+    u_len[i] = 0;
+
+  l_etas.count = l_etas.nnz = 0;
+  r_etas.count = r_etas.nnz = 0;
+  pf_etas->clear();
+  _updates = 0;
+
+  /* load the active submatrix */
+
+  int **c_index = (int **) calloc(m(), sizeof(*c_index));
+  int *c_len = (int *) calloc(m(), sizeof(*c_len));
+  int *c_size = (int *) calloc(m(), sizeof(*c_size));
+
+  for (int j = 0; j < m(); j++) {
+    c_size[j] = col_start[j + 1] - col_start[j] + 4;
+    c_index[j] = (int *) malloc(c_size[j] * sizeof(**c_index));
+
+    for (int k = col_start[j]; k < col_start[j + 1]; k++) {
+      if (value[k] == 0.0) continue;
+
+      append(row_index[k], j, value[k]);
+      c_index[j][c_len[j]++] = row_index[k];
+    }
+  }
+
+  int *row_head = (int *) malloc((m() + 1) * sizeof(*row_head));
+  int *row_next = (int *) malloc(m() * sizeof(*row_next));
+  int *row_prev = (int *) malloc(m() * sizeof(*row_prev));
+  int *col_head = (int *) malloc((m() + 1) * sizeof(*col_head));
+  int *col_next = (int *) malloc(m() * sizeof(*col_next));
+  int *col_prev = (int *) malloc(m() * sizeof(*col_prev));
+
+  for (int k = 0; k <= m(); k++)
+    row_head[k] = col_head[k] = -1;
+
+  for (int i = 0; i < m(); i++) {
+    bucket_insert(row_head, row_next, row_prev, i, u_len[i]);
+    bucket_insert(col_head, col_next, col_prev, i, c_len[i]);
+  }
+
+  int *mark = (int *) malloc(m() * sizeof(*mark)); // position of a column in the scattered row
+  for (int j = 0; j < m(); j++)
+    mark[j] = -1;
+
+  int singular = 0;
+
+  for (int t = 0; t < m(); t++) {
+
+    // step 1: search the pivot
+
+    int pivot_row = -1, pivot_col = -1;
+    long best_cost = -1;
+    int candidates = 0;
+
+    for (int count = 1; count <= m(); count++) {
+
+      for (int j = col_head[count]; j != -1; j = col_next[j]) { // columns with count elements
+	for (int k = 0; k < c_len[j]; k++) {
+	  int i = c_index[j][k];
+	  int pos = find(i, j);
+
+	  double max_value = 0.0;
+	  for (int z = 0; z < u_len[i]; z++)
+	    if (fabs(u_value[i][z]) > max_value) max_value = fabs(u_value[i][z]);
+
+	  double v = fabs(u_value[i][pos]);
+	  if (v <= zero_tolerance || v < threshold * max_value) continue;
+
+	  long cost = (long) (u_len[i] - 1) * (count - 1);
+	  if (best_cost == -1 || cost < best_cost) {
+	    best_cost = cost;
+	    pivot_row = i;
+	    pivot_col = j;
+	  }
+	}
+
+	if (best_cost != -1 && ++candidates >= search_limit) break;
+      }
+
+      if (best_cost != -1 && (candidates >= search_limit || best_cost <= (long) (count - 1) * count))
+	break;
+
+      for (int i = row_head[count]; i != -1; i = row_next[i]) { // rows with count elements
+	double max_value = 0.0;
+	for (int z = 0; z < u_len[i]; z++)
+	  if (fabs(u_value[i][z]) > max_value) max_value = fabs(u_value[i][z]);
+
+	for (int z = 0; z < u_len[i]; z++) {
+	  double v = fabs(u_value[i][z]);
+	  if (v <= zero_tolerance || v < threshold * max_value) continue;
+
+	  long cost = (long) (count - 1) * (c_len[u_index[i][z]] - 1);
+	  if (best_cost == -1 || cost < best_cost) {
+	    best_cost = cost;
+	    pivot_row = i;
+	    pivot_col = u_index[i][z];
+	  }
+	}
+
+	if (best_cost != -1 && ++candidates >= search_limit) break;
+      }
+
+      /* the elements not examined yet have more than count
+	 elements both in their row and in their column */
+
+      if (best_cost != -1 && (candidates >= search_limit || best_cost <= (long) count * count))
+	break;
+    }
+
+    if (pivot_row == -1) { // no acceptable pivot: the matrix is singular
+      singular = 1;
+      break;
+    }
+
+    // step 2: eliminate
+
+    int pr = pivot_row, pc = pivot_col;
+
+    bucket_remove(row_head, row_next, row_prev, pr, u_len[pr]);
+    bucket_remove(col_head, col_next, col_prev, pc, c_len[pc]);
+
+    int pivot_pos = find(pr, pc);
+    double pivot = u_value[pr][pivot_pos];
+
+    // the pivot is moved out of the row, in the diagonal
+
+    u_len[pr]--;
+    u_index[pr][pivot_pos] = u_index[pr][u_len[pr]];
+    u_value[pr][pivot_pos] = u_value[pr][u_len[pr]];
+    diag[pr] = pivot;
+
+    // the pivot row leaves the active submatrix
+
+    for (int z = 0; z < u_len[pr]; z++) {
+      int j = u_index[pr][z];
+
+      bucket_remove(col_head, col_next, col_prev, j, c_len[j]);
+
+      for (int k = 0; k < c_len[j]; k++) {
+	if (c_index[j][k] == pr) {
+	  c_index[j][k] = c_index[j][--c_len[j]];
+	  break;
+	}
+      }
+    }
+
+    // eliminate the pivot column from the other rows of the active submatrix
+
+    eta_begin(&l_etas, pr);
+
+    for (int k = 0; k < c_len[pc]; k++) {
+      int i = c_index[pc][k];
+      if (i == pr) continue;
+
+      bucket_remove(row_head, row_next, row_prev, i, u_len[i]);
+
+      int pos = find(i, pc);
+      double multiplier = u_value[i][pos] / pivot;
+
+      u_len[i]--;
+      u_index[i][pos] = u_index[i][u_len[i]];
+      u_value[i][pos] = u_value[i][u_len[i]];
+
+      eta_add(&l_etas, i, multiplier);
+
+      // row i -= multiplier * pivot row
+
+      for (int z = 0; z < u_len[i]; z++)
+	mark[u_index[i][z]] = z;
+
+      for (int z = 0; z < u_len[pr]; z++) {
+	int j = u_index[pr][z];
+
+	if (mark[j] != -1) {
+	  u_value[i][mark[j]] -= multiplier * u_value[pr][z];
+	}
+
+	else { // fill-in
+	  append(i, j, - multiplier * u_value[pr][z]);
+
+	  if (c_len[j] == c_size[j]) {
+	    c_size[j] *= 2;
+	    c_index[j] = (int *) realloc(c_index[j], c_size[j] * sizeof(**c_index));
+	  }
+
+	  c_index[j][c_len[j]++] = i;
+	}
+      }
+
+      for (int z = 0; z < u_len[i]; z++)
+	mark[u_index[i][z]] = -1;
+
+      bucket_insert(row_head, row_next, row_prev, i, u_len[i]);
+    }
+
+    eta_end(&l_etas);
+
+    for (int z = 0; z < u_len[pr]; z++) { // the columns of the pivot row have a new count
+      int j = u_index[pr][z];
+      bucket_insert(col_head, col_next, col_prev, j, c_len[j]);
+    }
+
+    c_len[pc] = 0;
+
+    pos_row[t] = pr;
+    pos_col[t] = pc;
+    row_pos[pr] = t;
+    col_pos[pc] = t;
+  }
+
+  for (int j = 0; j < m(); j++)
+    free(c_index[j]);
+
+  free(c_index);
+  free(c_len);
+  free(c_size);
+  free(row_head);
+  free(row_next);
+  free(row_prev);
+  free(col_head);
+  free(col_next);
+  free(col_prev);
+  free(mark);
+
+  return !singular;
+}
+
+void BasisFactor::ftran (double *x)
+{
+  // apply F: the column etas of L, then the row etas of the updates
+
+  for (int t = 0; t < l_etas.count; t++) {
+    double xr = x[l_etas.pivot[t]];
+    if (xr == 0.0) continue;
+
+    for (int k = l_etas.start[t]; k < l_etas.start[t + 1]; k++)
+      x[l_etas.index[k]] -= l_etas.value[k] * xr;
+  }
+
+  for (int t = 0; t < r_etas.count; t++) {
+    double sum = 0.0;
+
+    for (int k = r_etas.start[t]; k < r_etas.start[t + 1]; k++)
+      sum += r_etas.value[k] * x[r_etas.index[k]];
+
+    x[r_etas.pivot[t]] -= sum;
+  }
+
+  memcpy(spike, x, m() * sizeof(*spike)); // keep F * a for the next update
+
+  // solve U, from the last pivot to the first
+
+  for (int t = m() - 1; t >= 0; t--) {
+    int r = pos_row[t];
+    double sum = x[r];
+
+    for (int k = 0; k < u_len[r]; k++)
+      sum -= u_value[r][k] * work[u_index[r][k]];
+
+    work[pos_col[t]] = sum / diag[r];
+  }
+
+  memcpy(x, work, m() * sizeof(*x));
+
+  // updates in product form, if any
+
+  pf_etas->ftran(x);
+}
+
+void BasisFactor::btran (double *y)
+{
+  pf_etas->btran(y);
+
+  // solve U transposed, from the first pivot to the last
+
+  for (int t = 0; t < m(); t++) {
+    int r = pos_row[t];
+    double z = y[pos_col[t]] / diag[r];
+
+    work[r] = z;
+    if (z == 0.0) continue;
+
+    for (int k = 0; k < u_len[r]; k++)
+      y[u_index[r][k]] -= u_value[r][k] * z;
+  }
+
+  memcpy(y, work, m() * sizeof(*y));
+
+  // apply F transposed: the row etas, then the column etas, in reverse order
+
+  for (int t = r_etas.count - 1; t >= 0; t--) {
+    double yp = y[r_etas.pivot[t]];
+    if (yp == 0.0) continue;
+
+    for (int k = r_etas.start[t]; k < r_etas.start[t + 1]; k++)
+      y[r_etas.index[k]] -= r_etas.value[k] * yp;
+  }
+
+  for (int t = l_etas.count - 1; t >= 0; t--) {
+    double sum = 0.0;
+
+    for (int k = l_etas.start[t]; k < l_etas.start[t + 1]; k++)
+      sum += l_etas.value[k] * y[l_etas.index[k]];
+
+    y[l_etas.pivot[t]] -= sum;
+  }
+}
+
+/* Replace the column of slot p
+
+   Forrest-Tomlin update: the column of U in slot p is replaced by
+   the spike F * a, and moved (with its pivot row) to the last
+   position. The old elements of the pivot row are now below
+   the diagonal, and are eliminated using the rows of the
+   following pivots: the multipliers form a new row eta of F.
+*/
+int BasisFactor::update (int p, double *column)
+{
+  assert( p >= 0 && p < m() );
+
+  _updates++;
+
+  if (update_method == PRODUCT_FORM) {
+    if (fabs(column[p]) <= zero_tolerance) return 0;
+
+    pf_etas->push(p, column);
+    return 1;
+  }
+
+  int tp = col_pos[p];
+  int rp = pos_row[tp];
+  double old_diag = diag[rp];
+
+  // remove the old column from the rows of the previous pivots
+
+  for (int t = 0; t < tp; t++) {
+    int r = pos_row[t];
+    int pos = find(r, p);
+    if (pos == -1) continue;
+
+    u_len[r]--;
+    u_index[r][pos] = u_index[r][u_len[r]];
+    u_value[r][pos] = u_value[r][u_len[r]];
+  }
+
+  // insert the spike
+
+  for (int i = 0; i < m(); i++)
+    if (i != rp && spike[i] != 0.0) append(i, p, spike[i]);
+
+  // eliminate the pivot row, using the rows of the following pivots
+
+  memset(work, 0, m() * sizeof(*work));
+
+  for (int k = 0; k < u_len[rp]; k++)
+    work[u_index[rp][k]] = u_value[rp][k];
+
+  u_len[rp] = 0;
+
+  double d = spike[rp];
+  double max_multiplier = 0.0;
+
+  eta_begin(&r_etas, rp);
+
+  for (int t = tp + 1; t < m(); t++) {
+    int c = pos_col[t];
+    if (work[c] == 0.0) continue;
+
+    int r = pos_row[t];
+    double multiplier = work[c] / diag[r];
+    work[c] = 0.0;
+
+    for (int k = 0; k < u_len[r]; k++) {
+      if (u_index[r][k] == p) d -= multiplier * u_value[r][k];
+      else work[u_index[r][k]] -= multiplier * u_value[r][k];
+    }
+
+    eta_add(&r_etas, r, multiplier);
+    if (fabs(multiplier) > max_multiplier) max_multiplier = fabs(multiplier);
+  }
+
+  eta_end(&r_etas);
+
+  diag[rp] = d;
+
+  // move the pivot to the last position
+
+  for (int t = tp; t < m() - 1; t++) {
+    pos_row[t] = pos_row[t + 1];
+    pos_col[t] = pos_col[t + 1];
+    row_pos[pos_row[t]] = t;
+    col_pos[pos_col[t]] = t;
+  }
+
+  pos_row[m() - 1] = rp;
+  pos_col[m() - 1] = p;
+  row_pos[rp] = m() - 1;
+  col_pos[p] = m() - 1;
+
+  /* the ratio between the new and the old diagonal element is the
+     pivot of the column (ratio of the determinants): if they
+     differ too much, or the multipliers are too large,
+     the update is numerically unstable */
+
+  if (fabs(d) <= zero_tolerance || max_multiplier > 1e6 ||
+      fabs(d - column[p] * old_diag) > 1e-8 * (1.0 + fabs(d)))
+    return 0;
+
+  return 1;
+}
+
+/* unit tests */
+void BasisFactor::test ()
+{
+  /* factorize, by columns:
+
+     2 0 1 0
+     0 3 0 1
+     1 0 4 0
+     0 1 0 5
+  */
+
+  int col_start[] = { 0, 2, 4, 6, 8 };
+  int row_index[] = { 0, 2,  1, 3,  0, 2,  1, 3 };
+  double value[]  = { 2, 1,  3, 1,  1, 4,  1, 5 };
+
+  BasisFactor *factor = new BasisFactor(4);
+
+  if (!factor->factorize(col_start, row_index, value))
+    puts("\nBasis factor: error, singular matrix");
+
+  double x[] = { 3, 4, 5, 6 }; // B * (1 1 1 1)
+  factor->ftran(x);
+
+  puts("\nBasis factor: solution of B x = (3 4 5 6):");
+  printf("%.5f %.5f %.5f %.5f\n", x[0], x[1], x[2], x[3]);
+
+  double y[] = { 3, 4, 5, 6 }; // (1 1 1 1) * B
+  factor->btran(y);
+
+  puts("\nBasis factor: solution of y B = (3 4 5 6):");
+  printf("%.5f %.5f %.5f %.5f\n", y[0], y[1], y[2], y[3]);
+
+  /* replace the third column with (0 1 1 0) */
+
+  for (int method = FOREST_TOMLIN; method <= PRODUCT_FORM; method++) {
+    factor->update_method = method;
+    factor->factorize(col_start, row_index, value);
+
+    double a[] = { 0, 1, 1, 0 };
+    factor->ftran(a);
+    factor->update(2, a);
+
+    double x2[] = { 2, 5, 2, 6 }; // new B * (1 1 1 1)
+    factor->ftran(x2);
+
+    printf("\nBasis factor: after the %s update, solution of B x = (2 5 2 6):\n",
+	   method == FOREST_TOMLIN ? "Forrest-Tomlin" : "product form");
+    printf("%.5f %.5f %.5f %.5f\n", x2[0], x2[1], x2[2], x2[3]);
+
+    double y2[] = { 3, 4, 1, 6 };
+    factor->btran(y2);
+
+    puts("Basis factor: solution of y B = (3 4 1 6):");
+    printf("%.5f %.5f %.5f %.5f\n", y2[0], y2[1], y2[2], y2[3]);
+  }
+
+  delete factor;
+}
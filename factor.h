@@ -0,0 +1,126 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef BASIS_FACTOR_H
+#define BASIS_FACTOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "eta.h"
+
+/*
+  Sparse LU factorization of a basis matrix.
+
+  The factorization computes F * B = U, where F is a product of
+  elementary matrices (the L etas of the elimination, followed by
+  the row etas of the Forrest-Tomlin updates) and U is a sparse
+  upper triangular matrix, up to a permutation of rows and columns:
+  the t-th pivot of U is on row pos_row[t] and column pos_col[t].
+
+  The pivots are chosen with the Markowitz criterion (minimum
+  (row count - 1) * (column count - 1)), accepting only elements
+  not too small with respect to the largest one of their row
+  (threshold pivoting).
+
+  The columns of B are the "slots" of the basis: ftran returns
+  the solution indexed by slot, btran takes the right-hand side
+  indexed by slot.
+*/
+
+class BasisFactor {
+
+ public:
+  BasisFactor (int m);
+  virtual ~BasisFactor ();
+
+  /* getters */
+
+  inline int m ()       { return _m; };
+  inline int updates () { return _updates; }; // column replacements since the last factorization
+
+  /* factorization */
+
+  int factorize (int *col_start, int *row_index, double *value); /* factorize the m columns
+								    in compressed form, 0 if singular */
+
+  void ftran (double *x); // x := B^-1 x        (x indexed by row, result by slot)
+  void btran (double *y); // y := y^T B^-1      (y indexed by slot, result by row)
+
+  int update (int p, double *column); /* replace the column of slot p with the column
+					 transformed by the last ftran (passed as column),
+					 0 if the factorization must be recomputed */
+
+  /* settings */
+
+  enum update_methods {
+    FOREST_TOMLIN,
+    PRODUCT_FORM
+  };
+
+  int update_method;   // how to replace a column
+  double threshold;    // pivot threshold, relative to the largest element of the row
+  int search_limit;    // candidate pivots examined by the Markowitz search
+
+  /* unit tests */
+  static void test ();
+
+ protected:
+  int _m;
+  int _updates;
+
+  /* rows of U (the active submatrix during the factorization),
+     the diagonal element is kept apart */
+
+  int **u_index;
+  double **u_value;
+  int *u_len, *u_size;
+  double *diag;
+
+  /* pivot sequence */
+
+  int *pos_row, *pos_col;  // row and column of the t-th pivot
+  int *row_pos, *col_pos;  // position of every row and column
+
+  /* elementary matrices of F: column etas from the elimination,
+     row etas from the Forrest-Tomlin updates */
+
+  struct eta_list {
+    int count, size;
+    int *pivot;          // pivot row of each eta
+    int *start;          // first entry of each eta
+    int nnz, nnz_size;
+    int *index;
+    double *value;
+  };
+
+  struct eta_list l_etas, r_etas;
+
+  EtaFile *pf_etas;      // updates in product form
+
+  /* work vectors (m entries) */
+
+  double *spike;         // F * a of the last ftran, for the Forrest-Tomlin update
+  double *work;
+
+  /* helpers */
+
+  void append (int row, int col, double value); // append an element to a row of U
+  int  find   (int row, int col);               // position of an element in a row of U, -1 if null
+
+  static void eta_init  (struct eta_list *list);
+  static void eta_free  (struct eta_list *list);
+  static void eta_begin (struct eta_list *list, int pivot);
+  static void eta_add   (struct eta_list *list, int index, double value);
+  static void eta_end   (struct eta_list *list);
+
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include "generator.h"
+#include "parser.h"
+#include "simplex.h"
+#include "dual.h"
+
+const char *Generator::family_names[] = {
+  "dense", "sparse", "degenerate", "transportation", "infeasible", "unbounded", "wide"
+};
+
+/* Family with the given name, -1 if none */
+int Generator::parse_family (const char *name)
+{
+  for (int f = 0; f < FAMILIES; f++)
+    if (strcmp(name, family_names[f]) == 0) return f;
+
+  return -1;
+}
+
+/* xorshift64*: the same numbers on every platform */
+static unsigned long next_random (unsigned long *state)
+{
+  unsigned long x = *state;
+
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+
+  return (x * 2685821657736338717UL) >> 11;
+}
+
+/* an integer between lo and hi, included */
+static double uniform (unsigned long *state, int lo, int hi)
+{
+  return lo + (double) (next_random(state) % (unsigned long) (hi - lo + 1));
+}
+
+/* the problem, before the slacks: A x <= b (packing) or A x >= b (covering) */
+struct problem {
+  int m, n;
+  double *a; // m x n, by rows
+  double *b;
+  double *c;
+  int covering;
+};
+
+static void sparse_coefficients (struct problem *p, unsigned long *state, int lo, int hi)
+{
+  for (int j = 0; j < p->n; j++) { // every column in some row
+    int count = (int) uniform(state, lo, hi);
+
+    for (int k = 0; k < count; k++)
+      p->a[(next_random(state) % p->m) * p->n + j] = uniform(state, 1, 10);
+  }
+
+  for (int i = 0; i < p->m; i++) { // every row with some column
+    int j;
+    for (j = 0; j < p->n && p->a[i * p->n + j] == 0.0; j++);
+    if (j == p->n) p->a[i * p->n + next_random(state) % p->n] = uniform(state, 1, 10);
+  }
+}
+
+static void build_transportation (struct problem *p, unsigned long *state)
+{
+  int sources = p->m / 2, destinations = p->m - sources;
+
+  for (int s = 0; s < sources; s++)
+    for (int d = 0; d < destinations; d++) {
+      int j = s * destinations + d;
+
+      p->a[s * p->n + j] = p->covering ? -1 : 1;      // supply: sum_d x_sd <= S_s
+      p->a[(sources + d) * p->n + j] = 1;            // demand: sum_s x_sd >= D_d
+    }
+
+  // the supplies cover the demands
+
+  for (int s = 0; s < sources; s++) {
+    double supply = uniform(state, 5 * destinations, 10 * destinations);
+    p->b[s] = p->covering ? -supply : supply;
+  }
+
+  for (int d = 0; d < destinations; d++)
+    p->b[sources + d] = uniform(state, 2 * sources, 5 * sources);
+
+  for (int j = 0; j < p->n; j++)
+    p->c[j] = p->covering ? uniform(state, 1, 10) : -uniform(state, 1, 10);
+}
+
+static int build (struct problem *p, int family, unsigned long *state)
+{
+  using namespace Generator;
+
+  if (family == TRANSPORTATION) {
+    build_transportation(p, state);
+    return 1;
+  }
+
+  switch (family) {
+  case DENSE:
+    for (long k = 0; k < (long) p->m * p->n; k++)
+      p->a[k] = uniform(state, 1, 10);
+    break;
+  case WIDE:
+    sparse_coefficients(p, state, 1, 2);
+    break;
+  default:
+    sparse_coefficients(p, state, 1, 3);
+    break;
+  }
+
+  for (int i = 0; i < p->m; i++)
+    p->b[i] = family == DENSE ? uniform(state, p->n, 5 * p->n) : uniform(state, 10, 100);
+
+  for (int j = 0; j < p->n; j++)
+    p->c[j] = p->covering ? uniform(state, 1, 10) : -uniform(state, 1, 10);
+
+  switch (family) {
+  case DEGENERATE:
+    for (int i = 1; i < p->m; i += 2)
+      p->b[i] = 0;
+    break;
+
+  case INFEASIBLE: // the last constraint: a_0 x <= b_0 / 2
+    if (!p->covering || p->m < 2) return 0;
+
+    for (int j = 0; j < p->n; j++)
+      p->a[(p->m - 1) * p->n + j] = -p->a[j];
+
+    p->b[p->m - 1] = -p->b[0] / 2;
+    break;
+
+  case UNBOUNDED:
+    if (p->covering) { // min c x with c >= 0 is bounded
+      p->c[0] = -1;    // a valid TWO_PHASE problem only
+      break;
+    }
+
+    for (int i = 0; i < p->m; i++) // x_0 can grow forever
+      p->a[i * p->n] = 0;
+    break;
+  }
+
+  return 1;
+}
+
+/* Generate a problem of the family, in the form of the method */
+Tableau *Generator::generate (int family, int m, int n, unsigned long seed, int method)
+{
+  assert( family >= 0 && family < FAMILIES && m > 0 && n > 0 );
+
+  struct problem p;
+  unsigned long state = seed * 0x9E3779B97F4A7C15UL + family + 1; // never zero
+
+  if (family == TRANSPORTATION) {
+    if (m < 2) return NULL;
+    n = (m / 2) * (m - m / 2);
+  }
+
+  p.m = m;
+  p.n = n;
+  p.a = (double *) calloc((size_t) m * n, sizeof(double));
+  p.b = (double *) calloc(m, sizeof(double));
+  p.c = (double *) calloc(n, sizeof(double));
+  p.covering = method != SIMPLEX;
+
+  if (!build(&p, family, &state) || (method == DUAL && family == UNBOUNDED)) {
+    free(p.a);
+    free(p.b);
+    free(p.c);
+    return NULL;
+  }
+
+  /* the tableau: SIMPLEX [A | I | b], DUAL [-A | I | -b], TWO_PHASE [A | -I | b],
+     the costs [c | 0 | 0] */
+
+  Tableau *tab = new Tableau(m + 1, n + m + 1, NULL, NULL);
+  double sign = method == DUAL ? -1 : 1;
+
+  for (int i = 0; i < m; i++) {
+    double *row = tab->row(i);
+
+    for (int j = 0; j < n; j++)
+      row[j] = sign * p.a[(long) i * n + j];
+
+    row[n + i] = method == TWO_PHASE ? -1 : 1;
+    row[n + m] = sign * p.b[i];
+
+    if (method != TWO_PHASE) tab->basis_at(i, n + i);
+  }
+
+  memcpy(tab->row(m), p.c, n * sizeof(double));
+
+  free(p.a);
+  free(p.b);
+  free(p.c);
+
+  return tab;
+}
+
+/* Write a problem in the format of the problem files */
+void Generator::write (FILE *out, Tableau *tab, int method)
+{
+  static const char *methods[] = { "SIMPLEX", "TWO_PHASE", "DUAL" };
+
+  fprintf(out, "%s\n\n", methods[method]);
+
+  for (int i = 0; i < tab->m(); i++) {
+    for (int j = 0; j < tab->n(); j++)
+      fprintf(out, j ? " %.17g" : "%.17g", tab->at(i, j));
+
+    fputc('\n', out);
+  }
+
+  int basis = 1;
+
+  for (int i = 0; i < tab->m() - 1; i++)
+    basis = basis && tab->basis_set_at(i);
+
+  if (!basis) return;
+
+  fputc('\n', out);
+
+  for (int i = 0; i < tab->m() - 1; i++)
+    fprintf(out, i ? " %d" : "%d", tab->basis_at(i));
+
+  fputc('\n', out);
+}
+
+/* Unit tests */
+
+void Generator::test ()
+{
+  for (int f = 0; f < FAMILIES; f++) {
+    printf("\nGenerator: %s problems (10 x 20):", family_names[f]);
+
+    for (int method = SIMPLEX; method <= DUAL; method++) {
+      Tableau *tab = generate(f, 10, 20, 1, method);
+      const char *name = method == SIMPLEX ? "simplex" : method == DUAL ? "dual" : "two-phase";
+
+      if (!tab) {
+	printf(" %s: none", name);
+	continue;
+      }
+
+      try {
+	double cost = method == SIMPLEX ? PrimalSimplex::simplex(tab) :
+	  method == DUAL ? DualSimplex::simplex(tab) : PrimalSimplex::two_phase(tab);
+	printf(" %s: %g", name, cost);
+      } catch (TableauException *ex) {
+	printf(" %s: no solution", name);
+	delete ex;
+      }
+
+      delete tab;
+    }
+
+    putchar('\n');
+  }
+
+  // the same seed gives the same problem
+
+  Tableau *a = generate(SPARSE, 5, 8, 42, SIMPLEX), *b = generate(SPARSE, 5, 8, 42, SIMPLEX);
+
+  int same = 1;
+
+  for (int i = 0; i < a->m(); i++)
+    same = same && !memcmp(a->row(i), b->row(i), a->n() * sizeof(double));
+
+  printf("\nGenerator: same problem from the same seed: %s\n", same ? "yes" : "no");
+
+  delete a;
+  delete b;
+
+  puts("\nGenerator: a small degenerate problem:");
+
+  a = generate(DEGENERATE, 3, 4, 7, SIMPLEX);
+  write(stdout, a, SIMPLEX);
+
+  delete a;
+}
@@ -0,0 +1,76 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Random linear problems, reproducible from a seed (the generator
+  doesn't depend on the C library), with m constraints and n
+  variables (besides the slacks). The families:
+
+    dense           every coefficient between 1 and 10
+    sparse          1 to 3 coefficients per column
+    degenerate      sparse, with half the right-hand sides zero
+    transportation  m/2 sources and m - m/2 destinations, a variable
+                    for every pair (n is ignored)
+    infeasible      sparse, the first constraint contradicted by the last
+    unbounded       sparse, with a variable of negative cost that
+                    doesn't use any resource
+    wide            1 or 2 coefficients per column, for n >> m
+
+  The problem is built in the form of the method:
+
+    SIMPLEX     min c x, A x <= b, with b >= 0 and c <= 0: the slacks
+                are a feasible basis (no infeasible problem exists)
+    DUAL        min c x, A x >= b, with c >= 0, as -A x + s = -b: the
+                slacks are a dual feasible basis (no unbounded problem)
+    TWO_PHASE   the same problems, as A x - s = b with no basis (c is
+                negative for the unbounded family)
+*/
+
+namespace Generator {
+
+  //public:
+
+  enum {          // families
+    DENSE,
+    SPARSE,
+    DEGENERATE,
+    TRANSPORTATION,
+    INFEASIBLE,
+    UNBOUNDED,
+    WIDE,
+    FAMILIES
+  };
+
+  extern const char *family_names[];
+
+  /* Family with the given name, -1 if none */
+  int parse_family (const char *name);
+
+  /* Generate a problem of the family, in the form of the method (see
+     solver_method), NULL if the family has no problem in that form */
+  Tableau *generate (int family, int m, int n, unsigned long seed, int method);
+
+  /* Write a problem in the format of the problem files (see Parser) */
+  void write (FILE *out, Tableau *tab, int method);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
@@ -0,0 +1,782 @@
+#include <math.h>
+
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define X86_KERNELS
+#endif
+
+/* scalar versions, for every scalar type */
+
+template <typename T>
+static void axpy_scalar (T *dst, const T *src, T k, int n)
+{
+  for (int j = 0; j < n; j++)
+    dst[j] += src[j] * k;
+}
+
+template <typename T>
+static void scale_scalar (T *x, T k, int n)
+{
+  for (int j = 0; j < n; j++)
+    x[j] *= k;
+}
+
+template <typename T>
+static void swap_scalar (T *a, T *b, int n)
+{
+  for (int j = 0; j < n; j++) {
+    T temp = a[j];
+    a[j] = b[j];
+    b[j] = temp;
+  }
+}
+
+template <typename T>
+static int first_below_scalar (const T *x, T limit, int n)
+{
+  for (int j = 0; j < n; j++)
+    if (x[j] < limit) return j;
+
+  return -1;
+}
+
+template <typename T>
+static T min_ratio_scalar (const T *num, const T *den, T limit, int n)
+{
+  T min = HUGE_VAL;
+
+  for (int i = 0; i < n; i++) {
+    if (den[i] <= limit) continue;
+
+    T ratio = num[i] / den[i];
+    if (ratio < min) min = ratio;
+  }
+
+  return min;
+}
+
+#ifdef X86_KERNELS
+
+/* SSE2 versions, 2 elements at a time */
+
+__attribute__((target("sse2")))
+static void axpy_sse2 (double *dst, const double *src, double k, int n)
+{
+  __m128d vk = _mm_set1_pd(k);
+  int j = 0;
+
+  for (; j + 2 <= n; j += 2)
+    _mm_storeu_pd(&dst[j], _mm_add_pd(_mm_loadu_pd(&dst[j]),
+				      _mm_mul_pd(_mm_loadu_pd(&src[j]), vk)));
+
+  axpy_scalar(&dst[j], &src[j], k, n - j);
+}
+
+__attribute__((target("sse2")))
+static void scale_sse2 (double *x, double k, int n)
+{
+  __m128d vk = _mm_set1_pd(k);
+  int j = 0;
+
+  for (; j + 2 <= n; j += 2)
+    _mm_storeu_pd(&x[j], _mm_mul_pd(_mm_loadu_pd(&x[j]), vk));
+
+  scale_scalar(&x[j], k, n - j);
+}
+
+__attribute__((target("sse2")))
+static void swap_sse2 (double *a, double *b, int n)
+{
+  int j = 0;
+
+  for (; j + 2 <= n; j += 2) {
+    __m128d va = _mm_loadu_pd(&a[j]);
+    _mm_storeu_pd(&a[j], _mm_loadu_pd(&b[j]));
+    _mm_storeu_pd(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("sse2")))
+static int first_below_sse2 (const double *x, double limit, int n)
+{
+  __m128d vlimit = _mm_set1_pd(limit);
+  int j = 0;
+
+  for (; j + 2 <= n; j += 2) {
+    int mask = _mm_movemask_pd(_mm_cmplt_pd(_mm_loadu_pd(&x[j]), vlimit));
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("sse2")))
+static double min_ratio_sse2 (const double *num, const double *den, double limit, int n)
+{
+  __m128d vlimit = _mm_set1_pd(limit);
+  __m128d inf = _mm_set1_pd(HUGE_VAL);
+  __m128d vmin = inf;
+  int i = 0;
+
+  for (; i + 2 <= n; i += 2) {
+    __m128d d = _mm_loadu_pd(&den[i]);
+    __m128d mask = _mm_cmpgt_pd(d, vlimit);
+    __m128d ratio = _mm_div_pd(_mm_loadu_pd(&num[i]), _mm_or_pd(_mm_and_pd(mask, d),
+								_mm_andnot_pd(mask, inf)));
+    ratio = _mm_or_pd(_mm_and_pd(mask, ratio), _mm_andnot_pd(mask, inf));
+    vmin = _mm_min_pd(vmin, ratio);
+  }
+
+  double lanes[2];
+  _mm_storeu_pd(lanes, vmin);
+
+  double min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  if (lanes[0] < min) min = lanes[0];
+  if (lanes[1] < min) min = lanes[1];
+
+  return min;
+}
+
+/* AVX2 versions, 4 elements at a time */
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2 (double *dst, const double *src, double k, int n)
+{
+  __m256d vk = _mm256_set1_pd(k);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8) { // two independent chains
+    __m256d d0 = _mm256_fmadd_pd(_mm256_loadu_pd(&src[j]), vk, _mm256_loadu_pd(&dst[j]));
+    __m256d d1 = _mm256_fmadd_pd(_mm256_loadu_pd(&src[j + 4]), vk, _mm256_loadu_pd(&dst[j + 4]));
+    _mm256_storeu_pd(&dst[j], d0);
+    _mm256_storeu_pd(&dst[j + 4], d1);
+  }
+
+  for (; j + 4 <= n; j += 4)
+    _mm256_storeu_pd(&dst[j], _mm256_fmadd_pd(_mm256_loadu_pd(&src[j]), vk, _mm256_loadu_pd(&dst[j])));
+
+  axpy_scalar(&dst[j], &src[j], k, n - j);
+}
+
+__attribute__((target("avx2")))
+static void scale_avx2 (double *x, double k, int n)
+{
+  __m256d vk = _mm256_set1_pd(k);
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4)
+    _mm256_storeu_pd(&x[j], _mm256_mul_pd(_mm256_loadu_pd(&x[j]), vk));
+
+  scale_scalar(&x[j], k, n - j);
+}
+
+__attribute__((target("avx2")))
+static void swap_avx2 (double *a, double *b, int n)
+{
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4) {
+    __m256d va = _mm256_loadu_pd(&a[j]);
+    _mm256_storeu_pd(&a[j], _mm256_loadu_pd(&b[j]));
+    _mm256_storeu_pd(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("avx2")))
+static int first_below_avx2 (const double *x, double limit, int n)
+{
+  __m256d vlimit = _mm256_set1_pd(limit);
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4) {
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(&x[j]), vlimit, _CMP_LT_OQ));
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("avx2")))
+static double min_ratio_avx2 (const double *num, const double *den, double limit, int n)
+{
+  __m256d vlimit = _mm256_set1_pd(limit);
+  __m256d inf = _mm256_set1_pd(HUGE_VAL);
+  __m256d vmin = inf;
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m256d d = _mm256_loadu_pd(&den[i]);
+    __m256d mask = _mm256_cmp_pd(d, vlimit, _CMP_GT_OQ);
+    __m256d ratio = _mm256_div_pd(_mm256_loadu_pd(&num[i]), _mm256_blendv_pd(inf, d, mask));
+    vmin = _mm256_min_pd(vmin, _mm256_blendv_pd(inf, ratio, mask));
+  }
+
+  double lanes[4];
+  _mm256_storeu_pd(lanes, vmin);
+
+  double min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  for (int k = 0; k < 4; k++)
+    if (lanes[k] < min) min = lanes[k];
+
+  return min;
+}
+
+/* AVX-512 versions, 8 elements at a time, the tails are masked */
+
+__attribute__((target("avx512f")))
+static void axpy_avx512 (double *dst, const double *src, double k, int n)
+{
+  __m512d vk = _mm512_set1_pd(k);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8)
+    _mm512_storeu_pd(&dst[j], _mm512_fmadd_pd(_mm512_loadu_pd(&src[j]), vk, _mm512_loadu_pd(&dst[j])));
+
+  if (j < n) {
+    __mmask8 tail = (__mmask8) ((1u << (n - j)) - 1);
+    __m512d d = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, &src[j]), vk, _mm512_maskz_loadu_pd(tail, &dst[j]));
+    _mm512_mask_storeu_pd(&dst[j], tail, d);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void scale_avx512 (double *x, double k, int n)
+{
+  __m512d vk = _mm512_set1_pd(k);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8)
+    _mm512_storeu_pd(&x[j], _mm512_mul_pd(_mm512_loadu_pd(&x[j]), vk));
+
+  if (j < n) {
+    __mmask8 tail = (__mmask8) ((1u << (n - j)) - 1);
+    _mm512_mask_storeu_pd(&x[j], tail, _mm512_mul_pd(_mm512_maskz_loadu_pd(tail, &x[j]), vk));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void swap_avx512 (double *a, double *b, int n)
+{
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8) {
+    __m512d va = _mm512_loadu_pd(&a[j]);
+    _mm512_storeu_pd(&a[j], _mm512_loadu_pd(&b[j]));
+    _mm512_storeu_pd(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("avx512f")))
+static int first_below_avx512 (const double *x, double limit, int n)
+{
+  __m512d vlimit = _mm512_set1_pd(limit);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8) {
+    __mmask8 mask = _mm512_cmp_pd_mask(_mm512_loadu_pd(&x[j]), vlimit, _CMP_LT_OQ);
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("avx512f")))
+static double min_ratio_avx512 (const double *num, const double *den, double limit, int n)
+{
+  __m512d vlimit = _mm512_set1_pd(limit);
+  __m512d vmin = _mm512_set1_pd(HUGE_VAL);
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m512d d = _mm512_loadu_pd(&den[i]);
+    __mmask8 mask = _mm512_cmp_pd_mask(d, vlimit, _CMP_GT_OQ);
+    __m512d ratio = _mm512_maskz_div_pd(mask, _mm512_loadu_pd(&num[i]), d);
+    vmin = _mm512_mask_min_pd(vmin, mask, vmin, ratio);
+  }
+
+  double lanes[8];
+  _mm512_storeu_pd(lanes, vmin);
+
+  double min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  for (int k = 0; k < 8; k++)
+    if (lanes[k] < min) min = lanes[k];
+
+  return min;
+}
+
+/* single precision: twice the elements in every vector */
+
+__attribute__((target("sse2")))
+static void axpy_sse2 (float *dst, const float *src, float k, int n)
+{
+  __m128 vk = _mm_set1_ps(k);
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4)
+    _mm_storeu_ps(&dst[j], _mm_add_ps(_mm_loadu_ps(&dst[j]),
+				      _mm_mul_ps(_mm_loadu_ps(&src[j]), vk)));
+
+  axpy_scalar(&dst[j], &src[j], k, n - j);
+}
+
+__attribute__((target("sse2")))
+static void scale_sse2 (float *x, float k, int n)
+{
+  __m128 vk = _mm_set1_ps(k);
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4)
+    _mm_storeu_ps(&x[j], _mm_mul_ps(_mm_loadu_ps(&x[j]), vk));
+
+  scale_scalar(&x[j], k, n - j);
+}
+
+__attribute__((target("sse2")))
+static void swap_sse2 (float *a, float *b, int n)
+{
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4) {
+    __m128 va = _mm_loadu_ps(&a[j]);
+    _mm_storeu_ps(&a[j], _mm_loadu_ps(&b[j]));
+    _mm_storeu_ps(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("sse2")))
+static int first_below_sse2 (const float *x, float limit, int n)
+{
+  __m128 vlimit = _mm_set1_ps(limit);
+  int j = 0;
+
+  for (; j + 4 <= n; j += 4) {
+    int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(&x[j]), vlimit));
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("sse2")))
+static float min_ratio_sse2 (const float *num, const float *den, float limit, int n)
+{
+  __m128 vlimit = _mm_set1_ps(limit);
+  __m128 inf = _mm_set1_ps(HUGE_VALF);
+  __m128 vmin = inf;
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 d = _mm_loadu_ps(&den[i]);
+    __m128 mask = _mm_cmpgt_ps(d, vlimit);
+    __m128 ratio = _mm_div_ps(_mm_loadu_ps(&num[i]), _mm_or_ps(_mm_and_ps(mask, d),
+							     _mm_andnot_ps(mask, inf)));
+    ratio = _mm_or_ps(_mm_and_ps(mask, ratio), _mm_andnot_ps(mask, inf));
+    vmin = _mm_min_ps(vmin, ratio);
+  }
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, vmin);
+
+  float min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  for (int k = 0; k < 4; k++)
+    if (lanes[k] < min) min = lanes[k];
+
+  return min;
+}
+
+__attribute__((target("avx2,fma")))
+static void axpy_avx2 (float *dst, const float *src, float k, int n)
+{
+  __m256 vk = _mm256_set1_ps(k);
+  int j = 0;
+
+  for (; j + 16 <= n; j += 16) { // two independent chains
+    __m256 d0 = _mm256_fmadd_ps(_mm256_loadu_ps(&src[j]), vk, _mm256_loadu_ps(&dst[j]));
+    __m256 d1 = _mm256_fmadd_ps(_mm256_loadu_ps(&src[j + 8]), vk, _mm256_loadu_ps(&dst[j + 8]));
+    _mm256_storeu_ps(&dst[j], d0);
+    _mm256_storeu_ps(&dst[j + 8], d1);
+  }
+
+  for (; j + 8 <= n; j += 8)
+    _mm256_storeu_ps(&dst[j], _mm256_fmadd_ps(_mm256_loadu_ps(&src[j]), vk, _mm256_loadu_ps(&dst[j])));
+
+  axpy_scalar(&dst[j], &src[j], k, n - j);
+}
+
+__attribute__((target("avx2")))
+static void scale_avx2 (float *x, float k, int n)
+{
+  __m256 vk = _mm256_set1_ps(k);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8)
+    _mm256_storeu_ps(&x[j], _mm256_mul_ps(_mm256_loadu_ps(&x[j]), vk));
+
+  scale_scalar(&x[j], k, n - j);
+}
+
+__attribute__((target("avx2")))
+static void swap_avx2 (float *a, float *b, int n)
+{
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8) {
+    __m256 va = _mm256_loadu_ps(&a[j]);
+    _mm256_storeu_ps(&a[j], _mm256_loadu_ps(&b[j]));
+    _mm256_storeu_ps(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("avx2")))
+static int first_below_avx2 (const float *x, float limit, int n)
+{
+  __m256 vlimit = _mm256_set1_ps(limit);
+  int j = 0;
+
+  for (; j + 8 <= n; j += 8) {
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(&x[j]), vlimit, _CMP_LT_OQ));
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("avx2")))
+static float min_ratio_avx2 (const float *num, const float *den, float limit, int n)
+{
+  __m256 vlimit = _mm256_set1_ps(limit);
+  __m256 inf = _mm256_set1_ps(HUGE_VALF);
+  __m256 vmin = inf;
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256 d = _mm256_loadu_ps(&den[i]);
+    __m256 mask = _mm256_cmp_ps(d, vlimit, _CMP_GT_OQ);
+    __m256 ratio = _mm256_div_ps(_mm256_loadu_ps(&num[i]), _mm256_blendv_ps(inf, d, mask));
+    vmin = _mm256_min_ps(vmin, _mm256_blendv_ps(inf, ratio, mask));
+  }
+
+  float lanes[8];
+  _mm256_storeu_ps(lanes, vmin);
+
+  float min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  for (int k = 0; k < 8; k++)
+    if (lanes[k] < min) min = lanes[k];
+
+  return min;
+}
+
+__attribute__((target("avx512f")))
+static void axpy_avx512 (float *dst, const float *src, float k, int n)
+{
+  __m512 vk = _mm512_set1_ps(k);
+  int j = 0;
+
+  for (; j + 16 <= n; j += 16)
+    _mm512_storeu_ps(&dst[j], _mm512_fmadd_ps(_mm512_loadu_ps(&src[j]), vk, _mm512_loadu_ps(&dst[j])));
+
+  if (j < n) {
+    __mmask16 tail = (__mmask16) ((1u << (n - j)) - 1);
+    __m512 d = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, &src[j]), vk, _mm512_maskz_loadu_ps(tail, &dst[j]));
+    _mm512_mask_storeu_ps(&dst[j], tail, d);
+  }
+}
+
+__attribute__((target("avx512f")))
+static void scale_avx512 (float *x, float k, int n)
+{
+  __m512 vk = _mm512_set1_ps(k);
+  int j = 0;
+
+  for (; j + 16 <= n; j += 16)
+    _mm512_storeu_ps(&x[j], _mm512_mul_ps(_mm512_loadu_ps(&x[j]), vk));
+
+  if (j < n) {
+    __mmask16 tail = (__mmask16) ((1u << (n - j)) - 1);
+    _mm512_mask_storeu_ps(&x[j], tail, _mm512_mul_ps(_mm512_maskz_loadu_ps(tail, &x[j]), vk));
+  }
+}
+
+__attribute__((target("avx512f")))
+static void swap_avx512 (float *a, float *b, int n)
+{
+  int j = 0;
+
+  for (; j + 16 <= n; j += 16) {
+    __m512 va = _mm512_loadu_ps(&a[j]);
+    _mm512_storeu_ps(&a[j], _mm512_loadu_ps(&b[j]));
+    _mm512_storeu_ps(&b[j], va);
+  }
+
+  swap_scalar(&a[j], &b[j], n - j);
+}
+
+__attribute__((target("avx512f")))
+static int first_below_avx512 (const float *x, float limit, int n)
+{
+  __m512 vlimit = _mm512_set1_ps(limit);
+  int j = 0;
+
+  for (; j + 16 <= n; j += 16) {
+    __mmask16 mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(&x[j]), vlimit, _CMP_LT_OQ);
+    if (mask) return j + __builtin_ctz(mask);
+  }
+
+  int pos = first_below_scalar(&x[j], limit, n - j);
+  return pos == -1 ? -1 : j + pos;
+}
+
+__attribute__((target("avx512f")))
+static float min_ratio_avx512 (const float *num, const float *den, float limit, int n)
+{
+  __m512 vlimit = _mm512_set1_ps(limit);
+  __m512 vmin = _mm512_set1_ps(HUGE_VALF);
+  int i = 0;
+
+  for (; i + 16 <= n; i += 16) {
+    __m512 d = _mm512_loadu_ps(&den[i]);
+    __mmask16 mask = _mm512_cmp_ps_mask(d, vlimit, _CMP_GT_OQ);
+    __m512 ratio = _mm512_maskz_div_ps(mask, _mm512_loadu_ps(&num[i]), d);
+    vmin = _mm512_mask_min_ps(vmin, mask, vmin, ratio);
+  }
+
+  float lanes[16];
+  _mm512_storeu_ps(lanes, vmin);
+
+  float min = min_ratio_scalar(&num[i], &den[i], limit, n - i);
+  for (int k = 0; k < 16; k++)
+    if (lanes[k] < min) min = lanes[k];
+
+  return min;
+}
+
+#endif
+
+/* runtime dispatch */
+
+template <typename T>
+struct kernel_set {
+  const char *name;
+  void (*axpy) (T *, const T *, T, int);
+  void (*scale) (T *, T, int);
+  void (*swap) (T *, T *, int);
+  int (*first_below) (const T *, T, int);
+  T (*min_ratio) (const T *, const T *, T, int);
+};
+
+// the sets of the two precisions, in the same order (the same instruction sets)
+
+static const struct kernel_set<double> kernel_sets[] = {
+#ifdef X86_KERNELS
+  { "avx512", axpy_avx512, scale_avx512, swap_avx512, first_below_avx512, min_ratio_avx512 },
+  { "avx2",   axpy_avx2,   scale_avx2,   swap_avx2,   first_below_avx2,   min_ratio_avx2 },
+  { "sse2",   axpy_sse2,   scale_sse2,   swap_sse2,   first_below_sse2,   min_ratio_sse2 },
+#endif
+  { "scalar", axpy_scalar, scale_scalar, swap_scalar, first_below_scalar, min_ratio_scalar }
+};
+
+static const struct kernel_set<float> float_kernel_sets[] = {
+#ifdef X86_KERNELS
+  { "avx512", axpy_avx512, scale_avx512, swap_avx512, first_below_avx512, min_ratio_avx512 },
+  { "avx2",   axpy_avx2,   scale_avx2,   swap_avx2,   first_below_avx2,   min_ratio_avx2 },
+  { "sse2",   axpy_sse2,   scale_sse2,   swap_sse2,   first_below_sse2,   min_ratio_sse2 },
+#endif
+  { "scalar", axpy_scalar, scale_scalar, swap_scalar, first_below_scalar, min_ratio_scalar }
+};
+
+static const int kernel_sets_count = sizeof(kernel_sets) / sizeof(*kernel_sets);
+
+static int supported (const char *name)
+{
+#ifdef X86_KERNELS
+  __builtin_cpu_init();
+
+  if (!strcmp(name, "avx512")) return __builtin_cpu_supports("avx512f");
+  if (!strcmp(name, "avx2"))   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  if (!strcmp(name, "sse2"))   return __builtin_cpu_supports("sse2");
+#endif
+
+  return !strcmp(name, "scalar");
+}
+
+static int current = -1; // position of the set in use
+
+static int kernels ()
+{
+  if (current == -1) { // the first set supported by the CPU
+    for (int k = 0; k < kernel_sets_count && current == -1; k++)
+      if (supported(kernel_sets[k].name)) current = k;
+  }
+
+  return current;
+}
+
+int Kernels::select (const char *name)
+{
+  for (int k = 0; k < kernel_sets_count; k++) {
+    if (!strcmp(kernel_sets[k].name, name) && supported(name)) {
+      current = k;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+const char *Kernels::instruction_set ()
+{
+  return kernel_sets[kernels()].name;
+}
+
+/* row operations */
+
+void Kernels::axpy (double *dst, const double *src, double k, int n)
+{
+  kernel_sets[kernels()].axpy(dst, src, k, n);
+}
+
+void Kernels::scale (double *x, double k, int n)
+{
+  kernel_sets[kernels()].scale(x, k, n);
+}
+
+void Kernels::swap (double *a, double *b, int n)
+{
+  kernel_sets[kernels()].swap(a, b, n);
+}
+
+void Kernels::axpy (float *dst, const float *src, float k, int n)
+{
+  float_kernel_sets[kernels()].axpy(dst, src, k, n);
+}
+
+void Kernels::scale (float *x, float k, int n)
+{
+  float_kernel_sets[kernels()].scale(x, k, n);
+}
+
+void Kernels::swap (float *a, float *b, int n)
+{
+  float_kernel_sets[kernels()].swap(a, b, n);
+}
+
+void Kernels::axpy (long double *dst, const long double *src, long double k, int n)
+{
+  axpy_scalar(dst, src, k, n);
+}
+
+void Kernels::scale (long double *x, long double k, int n)
+{
+  scale_scalar(x, k, n);
+}
+
+void Kernels::swap (long double *a, long double *b, int n)
+{
+  swap_scalar(a, b, n);
+}
+
+/* reductions */
+
+int Kernels::first_below (const double *x, double limit, int n)
+{
+  return kernel_sets[kernels()].first_below(x, limit, n);
+}
+
+double Kernels::min_ratio (const double *num, const double *den, double limit, int n)
+{
+  return kernel_sets[kernels()].min_ratio(num, den, limit, n);
+}
+
+int Kernels::first_below (const float *x, float limit, int n)
+{
+  return float_kernel_sets[kernels()].first_below(x, limit, n);
+}
+
+float Kernels::min_ratio (const float *num, const float *den, float limit, int n)
+{
+  return float_kernel_sets[kernels()].min_ratio(num, den, limit, n);
+}
+
+int Kernels::first_below (const long double *x, long double limit, int n)
+{
+  return first_below_scalar(x, limit, n);
+}
+
+long double Kernels::min_ratio (const long double *num, const long double *den,
+				long double limit, int n)
+{
+  return min_ratio_scalar(num, den, limit, n);
+}
+
+/* the kernels on a vector of the given type, with the set in use */
+template <typename T>
+static void test_kernels (const char *name, const char *type)
+{
+  const int n = 37; // not a multiple of any vector width
+
+  T x[n], y[n], num[n], den[n];
+
+  for (int i = 0; i < n; i++) {
+    num[i] = (i * 7) % 11 + 1;
+    den[i] = (i % 3 == 0) ? -1.0 : (i % 5) + 0.5;
+    x[i] = i + 1;
+    y[i] = n - i;
+  }
+
+  Kernels::axpy(x, y, (T) 2.0, n);  // x = i + 1 + 2 (n - i)
+  Kernels::scale(x, (T) 0.5, n);
+  Kernels::swap(x, y, n);
+  y[30] = -1.0;
+
+  double checksum = 0.0;
+  for (int i = 0; i < n; i++)
+    checksum += x[i] + 3 * y[i];
+
+  printf("%s (%s): checksum %.5f, first negative %d, first below 10 %d, "
+	 "min ratio %.5f, min ratio (den > 3) %.5f\n", name, type, checksum,
+	 Kernels::first_below(y, (T) 0.0, n), Kernels::first_below(y, (T) 10.0, n),
+	 (double) Kernels::min_ratio(num, den, (T) 0.0, n),
+	 (double) Kernels::min_ratio(num, den, (T) 3.0, n));
+}
+
+/* unit tests: every instruction set supported by the CPU
+   must give the same results of the scalar version */
+void Kernels::test ()
+{
+  int saved = kernels();
+
+  puts("\nKernels: instruction sets:");
+
+  for (int k = 0; k < kernel_sets_count; k++) {
+    const char *name = kernel_sets[k].name;
+
+    if (!select(name)) {
+      printf("%s: not supported\n", name);
+      continue;
+    }
+
+    test_kernels<double>(name, "double");
+    test_kernels<float>(name, "float");
+  }
+
+  test_kernels<long double>("scalar", "long double");
+
+  current = saved;
+}
@@ -0,0 +1,71 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+  Vector kernels used by the row operations and by the scans
+  of the simplex methods.
+
+  Every kernel has a portable scalar version and, on x86, SSE2,
+  AVX2 (with FMA) and AVX-512 versions: the best version supported
+  by the CPU is selected at runtime, the first time a kernel
+  is called.
+
+  The kernels are given for the scalar types of the matrices (see
+  BasicMatrix): the float versions process twice the elements of
+  the double ones in every vector, the long double versions are
+  scalar only.
+*/
+
+namespace Kernels {
+
+  /* row operations */
+
+  void axpy  (double *dst, const double *src, double k, int n); // dst += k * src
+  void scale (double *x, double k, int n);                      // x *= k
+  void swap  (double *a, double *b, int n);                     // exchange a and b
+
+  void axpy  (float *dst, const float *src, float k, int n);
+  void scale (float *x, float k, int n);
+  void swap  (float *a, float *b, int n);
+
+  void axpy  (long double *dst, const long double *src, long double k, int n);
+  void scale (long double *x, long double k, int n);
+  void swap  (long double *a, long double *b, int n);
+
+  /* reductions */
+
+  /* position of the first x < limit, -1 if none */
+  int first_below (const double *x, double limit, int n);
+  int first_below (const float *x, float limit, int n);
+  int first_below (const long double *x, long double limit, int n);
+
+  /* smallest num / den with den > limit, HUGE_VAL if none */
+  double min_ratio (const double *num, const double *den, double limit, int n);
+  float min_ratio (const float *num, const float *den, float limit, int n);
+  long double min_ratio (const long double *num, const long double *den, long double limit, int n);
+
+  /* the instruction set in use ("scalar", "sse2", "avx2", "avx512") */
+  const char *instruction_set ();
+
+  /* force an instruction set, 0 if not supported by the CPU */
+  int select (const char *name);
+
+  /* unit tests */
+  void test ();
+
+}
+
+#endif
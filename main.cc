@@ -11,292 +11,286 @@
 #include <string.h>
 #include <assert.h>
 
-#include <ctype.h>
+#include <unistd.h>
 
 #include "simplex.h"
+#include "revised.h"
 #include "dual.h"
+#include "kernels.h"
+#include "threads.h"
+#include "trace.h"
+#include "parser.h"
+#include "mps.h"
+#include "snapshot.h"
+#include "warm.h"
+#include "batch.h"
+#include "generator.h"
+#include "presolve.h"
+#include "scaling.h"
+#include "tolerances.h"
+#include "degeneracy.h"
+#include "mixed.h"
 
 char *pname;
 
-enum solver_method {
-  SIMPLEX,
-  TWO_PHASE,
-  DUAL
-};
-
-enum parser_phases {
-  METHOD_TO_READ,
-  TABLEAU_TO_READ,
-  READING_TABLEAU,
-  VARS_TO_READ,
-  PARSING_COMPLETED
-};
-
-struct parsed_file {
-  int method;
-  Tableau *tableau;
-};
-
 void usage ()
 {
   puts("Simple simplex implementation, written in summer 2014,");
   puts("after taking an operational research course.");
   puts("Emanuele Acri - crossbower@gmail.com - 2014");
-  printf("\nusage:\n\t %s -t | -f file\n", pname);
+  printf("\nusage:\n\t %s -t | -g family,m,n,seed,method |\n\t\t[-r] [-P] [-S] [-C] [-H] [-D] [-F] [-e tolerances] [-j threads] [-p pricing] [-v level] [-c file [-k iterations]]\n\t\t-f file | -m file | -s file | -b directory | -l list\n", pname);
+  puts("\noptions:");
+  puts("\t-t\t\texecute the unit tests");
+  puts("\t-g problem\twrite a random problem (e.g. sparse,100,200,1,simplex):");
+  puts("\t\t\tdense, sparse, degenerate, transportation, infeasible,");
+  puts("\t\t\tunbounded or wide, for simplex, two_phase or dual");
+  puts("\t-f file\t\tsolve the problem in the file");
+  puts("\t-m file\t\tsolve the problem in the MPS file (revised two-phase)");
+  puts("\t-s file\t\tsolve (or resume) the tableau in the snapshot file");
+  puts("\t-b directory\tsolve every problem in the directory, in parallel");
+  puts("\t-l list\t\tsolve every problem listed in the file (- for stdin)");
+  puts("\t-c file\t\twrite the checkpoints of the solve in the snapshot file");
+  puts("\t-k iterations\titerations between two checkpoints (default 1000)");
+  puts("\t-r\t\tuse the revised simplex (SIMPLEX and TWO_PHASE methods)");
+  puts("\t-P\t\tpresolve the problems of the two-phase method");
+  puts("\t-S\t\tscale the tableau before the solve");
+  puts("\t-C\t\tno crash basis in the two-phase method (artificial variables only)");
+  puts("\t-H\t\tuse the textbook ratio test, instead of Harris' test");
+  puts("\t-D\t\tno perturbation of the stalled methods (only Bland's rule)");
+  puts("\t-F\t\titerate in float, then refine in double (SIMPLEX method)");
+  puts("\t-e tolerances\tprimal,dual,pivot tolerances (default 1e-9,1e-9,1e-9)");
+  puts("\t-j threads\tthreads used by the pivots and the parser (default 1)");
+  puts("\t-p pricing\tpricing rule of the primal simplex:");
+  puts("\t\t\tbland, dantzig, devex (default) or steepest");
+  puts("\t-v level\ttrace level: 0 only the result (default), 1 summary,");
+  puts("\t\t\t2 iterations, 3 tableaux");
 }
 
-int count_word_in_line (char *line)
+/* Write the random problem described as family,m,n,seed,method */
+int generate_problem (char *spec)
 {
-  int count = 0;
-  int in_word = 0;
-
-  for (int i = 0; line[i]; i++) {
+  static const char *methods[] = { "simplex", "two_phase", "dual" };
 
-    if (isalnum(line[i]) && !in_word) {
-      in_word = 1;
-      count++;
-    }
-
-    else if (isspace(line[i])) {
-      in_word = 0;
-    }
+  char family[32], method[32];
+  int m, n, f, k;
+  unsigned long seed;
 
+  if (sscanf(spec, "%31[^,],%d,%d,%lu,%31s", family, &m, &n, &seed, method) != 5 ||
+      (f = Generator::parse_family(family)) == -1 || m < 1 || n < 1) {
+    usage();
+    return 1;
   }
 
-  return count;
-}
-
-struct parsed_file *parse_file (char *filename)
-{
-  FILE *fp = NULL;
-  struct parsed_file *parsed = NULL;
-  
-  char buffer[1024 * 4];
-  
-  int phase = METHOD_TO_READ;
-  
-  int method = -1;
-
-  int m = -1, n = -1;
-
-  double *matrix = NULL;
-  int matrix_pos = 0;
-
-  int *indices = NULL;
-  int indices_pos = 0;
-
-  int line = 0;
-
-  int count;
+  for (k = 0; k < 3 && strcmp(method, methods[k]); k++);
 
-  fp = fopen(filename, "r");
-  if (!fp) {
-    fprintf(stderr, "%s: error opening file: %s\n", pname, filename);
-    goto error_exit;
+  if (k == 3) {
+    usage();
+    return 1;
   }
 
-  parsed = (struct parsed_file *) malloc(sizeof(*parsed));
-
-  // read file, line per line
-  while (fgets(buffer, 1024 * 4 - 1, fp)) {
-    line++;
-
-    int i = 0;
-    while (isspace((int) buffer[i]) && buffer[i] != '\0') i++; // search the first non-space char
-
-    if (buffer[i] == '\0' || buffer[i] == '#') { // skip empty lines and comment lines
-
-      // this kind of line mark the end of the tableau rows
-      if (phase == READING_TABLEAU) phase = VARS_TO_READ;
-
-      continue;
-    }
+  Tableau *tab = Generator::generate(f, m, n, seed, k);
 
-    switch (phase) {
+  if (!tab) {
+    fprintf(stderr, "%s: no %s problem for the %s method\n", pname, family, method);
+    return 1;
+  }
 
-    case METHOD_TO_READ: // first of all read the solver method to apply
+  Generator::write(stdout, tab, k);
+  delete tab;
 
-      if (!strncmp(&buffer[i], "SIMPLEX", strlen("SIMPLEX")))
-	method = SIMPLEX;
-      else if (!strncmp(&buffer[i], "TWO_PHASE", strlen("TWO_PHASE")))
-	method = TWO_PHASE;
-      else if (!strncmp(&buffer[i], "DUAL", strlen("DUAL")))
-	method = DUAL;
-      else {
-	fprintf(stderr, "%s: invalid format for the file: %s, unknown method, line: %d\n", pname, filename, line);
-	goto error_exit;
-      }
+  return 0;
+}
 
-      phase = TABLEAU_TO_READ;
+int main (int argc, char *argv[])
+{
+  pname = argv[0];
 
+  int run_tests = 0;
+  int revised = 0;
+  char *filename = NULL;
+  char *mps_filename = NULL;
+  char *snapshot_filename = NULL;
+  char *batch_directory = NULL;
+  char *batch_list = NULL;
+  char *generate = NULL;
+
+  int opt;
+
+  while ((opt = getopt(argc, argv, "tg:f:m:s:b:l:c:k:rPSCHDFe:j:p:v:")) != -1) {
+    switch (opt) {
+    case 't':
+      run_tests = 1;
       break;
-
-    case TABLEAU_TO_READ: // begin reading the tableau
-
-      count = count_word_in_line(buffer);
-
-      m = 0;
-      n = count;
-      matrix = (double *) calloc(count * count, sizeof(*matrix));
-      matrix_pos = 0;
-
-      phase = READING_TABLEAU;
-
-      // fallthrough...
-
-    case READING_TABLEAU: // read tableau rows
-
-      m++;
-
-      if (m > n) {
-	fprintf(stderr, "%s: invalid format for the file: %s, matrix rows >= matrix columns, line: %d\n", pname, filename, line);
-	goto error_exit;
-      }
-
-      count = count_word_in_line(buffer);
-
-      if (count != n) {
-	fprintf(stderr, "%s: invalid format for the file: %s, invalid number of elements in row, line: %d\n", pname, filename, line);
-	goto error_exit;
+    case 'g':
+      generate = optarg;
+      break;
+    case 'f':
+      filename = optarg;
+      break;
+    case 'm':
+      mps_filename = optarg;
+      break;
+    case 's':
+      snapshot_filename = optarg;
+      break;
+    case 'b':
+      batch_directory = optarg;
+      break;
+    case 'l':
+      batch_list = optarg;
+      break;
+    case 'c':
+      Snapshot::checkpoint_file = optarg;
+      break;
+    case 'k':
+      Snapshot::frequency = atol(optarg);
+      if (Snapshot::frequency < 1) {
+	usage();
+	return 1;
       }
-
-      while (count) {
-	int r = sscanf(&buffer[i], "%lf", &matrix[matrix_pos]);
-	matrix_pos++;
-
-	if (r != 1) {
-	  fprintf(stderr, "%s: invalid format for the file: %s, invalid element in tableau, line: %d\n", pname, filename, line);
-	  goto error_exit;
-	}
-
-	while (!isspace((int) buffer[i]) && buffer[i] != '\0') i++; // go to next word
-	while (isspace((int) buffer[i]) && buffer[i] != '\0') i++;
-	
-	count--;
-
-	assert(buffer[i] != '\0' ||  !count);
+      break;
+    case 'r':
+      revised = 1;
+      break;
+    case 'P':
+      Presolve::enabled = 1;
+      break;
+    case 'S':
+      Scaling::enabled = 1;
+      break;
+    case 'C':
+      PrimalSimplex::crash = 0;
+      break;
+    case 'H':
+      Tolerances::harris = 0;
+      break;
+    case 'D':
+      Degeneracy::perturb = 0;
+      break;
+    case 'F':
+      Mixed::enabled = 1;
+      break;
+    case 'e':
+      if (!Tolerances::parse(optarg)) {
+	usage();
+	return 1;
       }
-
       break;
-
-    case VARS_TO_READ: // read indices of the variables in basis
-
-      indices = (int *) malloc((m - 1) * sizeof(*indices));
-
-      count = count_word_in_line(buffer);
-
-      if (count != m - 1) {
-	fprintf(stderr, "%s: invalid format for the file: %s, invalid number of variables in basis, line: %d\n", pname, filename, line);
-	goto error_exit;
+    case 'j':
+      Threads::count = atoi(optarg);
+      if (Threads::count < 1) {
+	usage();
+	return 1;
       }
-
-      while (count) {
-	int r = sscanf(&buffer[i], "%d", &indices[indices_pos]);
-	indices_pos++;
-	
-	if (r != 1 || indices[indices_pos - 1] < 0 || indices[indices_pos - 1] >= n) {
-	  fprintf(stderr, "%s: invalid format for the file: %s, invalid variable in basis, line: %d\n", pname, filename, line);
-	  goto error_exit;
-	}
-
-	while (!isspace((int) buffer[i]) && buffer[i] != '\0') i++; // go to next word
-	while (isspace((int) buffer[i]) && buffer[i] != '\0') i++;
-
-	count--;
-
-	assert(buffer[i] != '\0' || !count);
+      break;
+    case 'p':
+      Pricing::rule = Pricing::parse_rule(optarg);
+      if (Pricing::rule == -1) {
+	usage();
+	return 1;
       }
-
-      phase = PARSING_COMPLETED;
-
       break;
-
-    case PARSING_COMPLETED: // parsing completed...
+    case 'v':
+      Trace::level = atoi(optarg);
       break;
-
+    default:
+      usage();
+      return 1;
     }
-
   }
 
-  // prepare the tableau
-  parsed = (parsed_file *) malloc(sizeof(*parsed));
-  parsed->method = method;
-
-  parsed->tableau = new Tableau(m, n, matrix, indices);
-
-  puts("Initial Tableau:");
-  parsed->tableau->print();
-
-  fclose(fp);
-  free(matrix);
-  free(indices);
-
-  return parsed;
-  
- error_exit:
-  if (parsed) free(parsed);
-  if (fp) fclose(fp);
-  if (matrix) free(matrix);
-  if (indices) free(indices);
-  return NULL;
-}
-
-int main (int argc, char *argv[])
-{
-  pname = argv[0];
+  if (generate) // write a random problem
+    return generate_problem(generate);
 
-  if (argc < 2) {
+  if (!run_tests && !filename && !mps_filename && !snapshot_filename &&
+      !batch_directory && !batch_list) {
     usage();
     return 0;
   }
 
-  if (!strcmp(argv[1], "-t")) { // execute tests
+  if (run_tests) { // execute tests
+    Kernels::test();
+    Threads::test();
+    Parser::test();
+    Mps::test();
+    Snapshot::test();
     Matrix::test();
+    SparseMatrix::test();
     PrimalSimplex::test();
+    RevisedSimplex::test();
     DualSimplex::test();
+    Degeneracy::test();
+    Mixed::test();
+    WarmStart::test();
+    Batch::test();
+    Generator::test();
+    Presolve::test();
+    Scaling::test();
   }
 
-  if (argc == 3 && !strcmp(argv[1], "-f")) { // solve file
-    struct parsed_file *parsed= parse_file(argv[2]);
+  if (filename) { // solve file
+    struct parsed_file *parsed = Parser::parse_file(filename);
 
     if (!parsed) {
-      //fprintf(stderr, "%s: error parsing file: %s\n", pname, argv[2]);
+      //fprintf(stderr, "%s: error parsing file: %s\n", pname, filename);
       return 1;
     }
 
     double solution;
 
-    try {
-
-      switch (parsed->method) { // solve with the specified method
-      case SIMPLEX:
-	solution = PrimalSimplex::simplex(parsed->tableau);
-	break;
-      case TWO_PHASE:
-	solution = PrimalSimplex::two_phase(parsed->tableau);
-	break;
-      case DUAL:
-	solution = DualSimplex::simplex(parsed->tableau);
-	break;
-      default:
-	solution = PrimalSimplex::two_phase(parsed->tableau);
-	break;
-    }
+    // the first checkpoint is the problem itself
+    if (Snapshot::checkpoint_file)
+      Snapshot::save(Snapshot::checkpoint_file, parsed->tableau, parsed->method, 0);
 
+    try {
+      solution = Batch::solve(parsed->method, parsed->tableau, revised);
     } catch (TableauException *ex) {
-
-      puts("\nNo solution found.");
+      puts("No solution found.");
       goto end;
-
     }
 
-    puts("\nFinal Tableau:");
-    parsed->tableau->print();
+    TRACE_TABLEAU("main", "final tableau", parsed->tableau);
     printf("Solution value: %lf\n", solution);
 
   end:
-    delete parsed->tableau;
-    free(parsed);
+    Parser::delete_parsed(parsed);
+  }
+
+  if (snapshot_filename) { // solve snapshot
+    struct Snapshot::snapshot *snap = Snapshot::load(snapshot_filename);
+
+    if (!snap) return 1;
+
+    try {
+      double solution = Batch::solve(snap->method, snap->tableau, revised);
+
+      TRACE_TABLEAU("main", "final tableau", snap->tableau);
+      printf("Solution value: %lf\n", solution);
+    } catch (TableauException *ex) {
+      puts("No solution found.");
+    }
+
+    Snapshot::release(snap);
+  }
+
+  if (batch_directory && Batch::solve_directory(batch_directory, revised, stdout) != 0)
+    return 1;
+
+  if (batch_list && Batch::solve_list(batch_list, revised, stdout) != 0)
+    return 1;
+
+  if (mps_filename) { // solve MPS file
+    struct Mps::model *md = Mps::read(mps_filename);
+
+    if (!md) return 1;
+
+    try {
+      printf("Solution value: %lf\n", Mps::solve(md, NULL));
+    } catch (TableauException *ex) {
+      puts("No solution found.");
+    }
+
+    Mps::delete_model(md);
   }
 
   return 0;
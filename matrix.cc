@@ -1,61 +1,115 @@
 #include "matrix.h"
+#include "factor.h"
+#include "kernels.h"
 
-Matrix::Matrix (int m, int n, double *buff)
-  : _m(m), _n(n)
+static const size_t cache_line = 64; // bytes
+
+template <typename T>
+BasicMatrix<T>::BasicMatrix (int m, int n, T *buff)
+  : _m(m), _n(n), _ld(padded(n)), shared(0)
+{
+  buffer = allocate(m, _ld);
+  if (buff) copy_rows(buff, n);
+}
+
+template <typename T>
+BasicMatrix<T>::BasicMatrix (int m, int n, T *buff, int share)
+  : _m(m), _n(n), _ld(n), buffer(buff), shared(share)
+{
+  if (!share) { // same as the other constructor
+    _ld = padded(n);
+    buffer = allocate(m, _ld);
+    if (buff) copy_rows(buff, n);
+  }
+}
+
+template <typename T>
+BasicMatrix<T>::~BasicMatrix ()
+{
+  if (!shared) free(buffer);
+}
+
+/* getters and setters */
+
+template <typename T>
+void BasicMatrix<T>::column (int j, T *dst)
+{
+  assert( j >= 0 && j < n() );
+
+  for (int i = 0; i < m(); i++)
+    dst[i] = buffer[(size_t) i * _ld + j];
+}
+
+/* storage */
+
+template <typename T>
+int BasicMatrix<T>::padded (int n)
 {
-  size_t size = m * n * sizeof(*buffer);
+  int line = cache_line / sizeof(T); // elements in a cache line
 
-  if (buff) {
-    buffer = (double *) malloc(size);
-    memcpy(buffer, buff, size);
-  } else {
-    buffer = (double *) calloc(m * n, sizeof(*buffer));
+  return (n + line - 1) / line * line;
+}
+
+template <typename T>
+T *BasicMatrix<T>::allocate (int m, int ld)
+{
+  size_t size = (size_t) m * ld * sizeof(T);
+  void *mem;
+
+  if (size == 0) size = cache_line;
+
+  if (posix_memalign(&mem, cache_line, size) != 0) {
+    fprintf(stderr, "Error: can't allocate a matrix of %d rows.\n", m);
+    exit(1);
   }
+
+  memset(mem, 0, size);
+  return (T *) mem;
 }
 
-Matrix::~Matrix ()
+template <typename T>
+void BasicMatrix<T>::copy_rows (const T *src, int src_ld)
 {
-  free(buffer);
+  for (int i = 0; i < _m; i++)
+    memcpy(row(i), &src[(size_t) i * src_ld], _n * sizeof(T));
 }
 
 /* elementary row operations */
 
-void Matrix::swap_rows (int row1, int row2)
+template <typename T>
+void BasicMatrix<T>::swap_rows (int row1, int row2)
 {
   assert( row1 >= 0   &&  row2 >= 0    &&
 	  row1 <  m() &&  row2 <  m()  );
   assert(row1 != row2);
 
-  for (int j = 0; j < n(); j++) {
-    double temp = at(row1, j);
-    at(row1, j, at(row2, j));
-    at(row2, j, temp);
-  }
+  Kernels::swap(row(row1), row(row2), n());
 }
 
-void Matrix::swap_columns (int col1, int col2)
+template <typename T>
+void BasicMatrix<T>::swap_columns (int col1, int col2)
 {
   assert( col1 >= 0    && col2 >= 0    &&
 	  col1 <  n()  && col2 <  n()  );
   assert(col1 != col2);
 
   for (int i = 0; i < m(); i++) {
-    double temp = at(i, col1);
+    T temp = at(i, col1);
     at(i, col1, at(i, col2));
     at(i, col2, temp);
   }
 }
 
-void Matrix::scale_row (int row, double k)
+template <typename T>
+void BasicMatrix<T>::scale_row (int row, T k)
 {
   assert( row >= 0 && row < m() );
 
-  for (int j = 0; j < n(); j++) {
-    at(row, j, at(row, j) * k);
-  }
+  Kernels::scale(this->row(row), k, n());
 }
 
-void Matrix::scale_column (int col, double k)
+template <typename T>
+void BasicMatrix<T>::scale_column (int col, T k)
 {
   assert( col >= 0 && col < n() );
 
@@ -64,18 +118,18 @@ void Matrix::scale_column (int col, double k)
   }
 }
 
-void Matrix::add_premultiplied_row (int src, double k, int dst)
+template <typename T>
+void BasicMatrix<T>::add_premultiplied_row (int src, T k, int dst)
 {
   assert( src >= 0    &&  dst >= 0    &&
 	  src <  m()  &&  dst <  m()  );
   assert(src != dst);
 
-  for (int j = 0; j < n(); j++) {
-    at(dst, j, at(dst, j) + at(src, j) * k);
-  }
+  Kernels::axpy(row(dst), row(src), k, n());
 }
 
-void Matrix::add_premultiplied_column (int src, double k, int dst)
+template <typename T>
+void BasicMatrix<T>::add_premultiplied_column (int src, T k, int dst)
 {
   assert( src >= 0    &&  dst >= 0    &&
 	  src <  n()  &&  dst <  n()  );
@@ -88,80 +142,75 @@ void Matrix::add_premultiplied_column (int src, double k, int dst)
 
 /* matrix operations */
 
-void Matrix::invert ()
+template <typename T>
+void BasicMatrix<T>::invert ()
 {
   /*
-    The strategy adopted here is a simple one:
-   
-    First we prepare an identity matrix of the same
-    size of the input matrix, then we transform the
-    input matrix in the identity, using only elementary
-    row operations.
-   
-    Repeating the same operations on the identity matrix
-    we created, transforms it in the inverse of
-    the input matrix.
+    The matrix is factorized as a basis (sparse LU, see factor.h),
+    then the columns of the inverse are obtained solving
+    the systems having the columns of the identity
+    as right-hand sides.
    */ 
 
   assert(m() == n());
 
-  /* prepare an identity matrix */
-
-  Matrix *identity = new Matrix(m(), n(), NULL);
+  /* the matrix in compressed form, by columns */
 
-  for (int j = 0; j < n(); j++) // ones on the diagonal
-    identity->at(j, j, 1.0);
-
-  /* for every column of the matrix... */
+  int *col_start = (int *) malloc((n() + 1) * sizeof(*col_start));
+  int *row_index = (int *) malloc(m() * n() * sizeof(*row_index));
+  double *value = (double *) malloc(m() * n() * sizeof(*value));
+  int nnz = 0;
 
   for (int j = 0; j < n(); j++) {
-    double pivot = 0.0;
-
-    /* ...search a pivot */
-
-    for (int i = j; i < m(); i++) {
-      double value = at(i, j);
-
-      if (value != 0.0) {
-	if (j != i) { // move the pivot in the correct position
-	  swap_rows(j, i);
-	  identity->swap_rows(j, i);
-	}
-	
-	pivot = value;
-	break;
-      }
-    }
+    col_start[j] = nnz;
 
-    /* no pivot in a column means that the matrix is not invertible */
+    for (int i = 0; i < m(); i++) {
+      if (at(i, j) == 0.0) continue;
 
-    if (pivot == 0.0) {
-      fprintf(stderr, "Error: tried to invert a singular matrix.");
-      return; // fix this
+      row_index[nnz] = i;
+      value[nnz] = at(i, j);
+      nnz++;
     }
+  }
 
-    scale_row(j, 1.0 / pivot); // scale the pivot to assume value 1.0
-    identity->scale_row(j, 1.0 / pivot);
+  col_start[n()] = nnz;
 
-    /* nullify every element in the column that is not the pivot */
+  BasisFactor *factor = new BasisFactor(m());
 
-    for (int i = 0; i < m(); i++) {
-      if (i == j) continue;
+  int invertible = factor->factorize(col_start, row_index, value);
 
-      double value = at(i, j);
-      double multiplier = - 1.0 * value;
+  free(col_start);
+  free(row_index);
+  free(value);
 
-      add_premultiplied_row(j, multiplier, i); // nullify the element
-      identity->add_premultiplied_row(j, multiplier, i);
-    }
+  /* a singular factorization means that the matrix is not invertible */
+
+  if (!invertible) {
+    fprintf(stderr, "Error: tried to invert a singular matrix.");
+    delete factor;
+    return; // fix this
   }
 
-  memcpy(buffer, identity->buffer, m() * n() * sizeof(*buffer));
+  /* solve for every column of the identity */
+
+  double *column = (double *) malloc(m() * sizeof(*column));
+
+  for (int j = 0; j < n(); j++) {
+    memset(column, 0, m() * sizeof(*column));
+    column[j] = 1.0;
+
+    factor->ftran(column);
+
+    for (int i = 0; i < m(); i++)
+      at(i, j, column[i]);
+  }
 
-  delete(identity);
+  free(column);
+  delete factor;
 }
 
-Matrix *Matrix::multiply_by (Matrix *mat)
+template <typename T>
+BasicMatrix<T> *BasicMatrix<T>::multiply_by (BasicMatrix *mat)
 {
   /* 
     Naive matrix multiplication, with
@@ -172,7 +221,7 @@ Matrix *Matrix::multiply_by (Matrix *mat)
 
   /* prepare result matrix */
 
-  Matrix *result = new Matrix(m(), mat->n(), NULL);
+  BasicMatrix *result = new BasicMatrix(m(), mat->n(), NULL);
 
   /* fill every element of the result matrix using a simple dot-product:
      the corresponding row of the first matrix "dot" the corresponding
@@ -192,43 +241,49 @@ Matrix *Matrix::multiply_by (Matrix *mat)
 
 /* other stuff... */
 
-void Matrix::print ()
+template <typename T>
+void BasicMatrix<T>::print ()
 {
   for (int i = 0; i < m(); i++) {
 
     for (int j = 0; j < n(); j++) {
-      printf("%.5f ", at(i, j));
+      printf("%.5f ", (double) at(i, j));
     }
 
     putchar('\n');
   }
 }
 
-Matrix *Matrix::clone ()
+template <typename T>
+BasicMatrix<T> *BasicMatrix<T>::clone ()
 {
-  return new Matrix(m(), n(), buffer);
+  BasicMatrix *copy = new BasicMatrix(m(), n(), NULL);
+
+  copy->copy_rows(buffer, _ld);
+  return copy;
 }
 
 /* unit tests */
-void Matrix::test ()
+template <typename T>
+void BasicMatrix<T>::test ()
 {
-  Matrix *m1, *m2, *m3;
+  BasicMatrix *m1, *m2, *m3;
 
-  double b1[] = { 1, 0, 0, 0,
-                  0, 1, 0, 0,
-                  0, 0, 1, 0 };
+  T b1[] = { 1, 0, 0, 0,
+             0, 1, 0, 0,
+             0, 0, 1, 0 };
 
-  double b2[] = { 0, 0, 3,
-                  0, 3, 0,
-                  3, 0, 0 };
+  T b2[] = { 0, 0, 3,
+             0, 3, 0,
+             3, 0, 0 };
 
-  double b3[] = { 0, 0, 3,
-                  0, 3, 0,
-                  3, 0, 0 };
+  T b3[] = { 0, 0, 3,
+             0, 3, 0,
+             3, 0, 0 };
   
-  m1 = new Matrix(3, 4, b1);
-  m2 = new Matrix(3, 3, b2);
-  m3 = new Matrix(3, 3, b3);
+  m1 = new BasicMatrix(3, 4, b1);
+  m2 = new BasicMatrix(3, 3, b2);
+  m3 = new BasicMatrix(3, 3, b3);
 
   puts("Matrix: Elementary row/column operations:");
 
@@ -275,13 +330,35 @@ void Matrix::test ()
   puts("\nMatrix: inverse:");
   m2->print();
 
-  Matrix *m4 = m3->multiply_by(m2);
+  BasicMatrix *m4 = m3->multiply_by(m2);
 
   puts("\nMatrix: original matrix multiplied by its inverse:");
   m4->print();
 
+  puts("\nMatrix: storage:");
+
+  int aligned = 1;
+
+  for (int i = 0; i < m1->m(); i++)
+    aligned = aligned && (size_t) m1->row(i) % cache_line == 0;
+
+  Span<T> last = m1->span(2, 1, 4); // the last three elements of the last row
+  T sum = 0;
+
+  for (int j = 0; j < last.size; j++)
+    sum += last[j];
+
+  printf("stride of the rows %d (%d columns), aligned: %s, sum of a span: %.5f\n",
+	 m1->stride(), m1->n(), aligned ? "yes" : "no", (double) sum);
+
   delete m1;
   delete m2;
   delete m3;
   delete m4;
 }
+
+/* the three scalar types */
+
+template class BasicMatrix<float>;
+template class BasicMatrix<double>;
+template class BasicMatrix<long double>;
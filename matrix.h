@@ -14,62 +14,123 @@
 #ifndef MATRIX_H
 #define MATRIX_H
 
-class Matrix {
+/*
+  Dense matrix, stored by rows, of float, double or long double
+  elements (the implementation is instantiated for the three types).
+
+  The methods work in double (Matrix and Tableau, see tableau.h);
+  the other types are used for the iterations in lower precision
+  (see Mixed), and the long double build for the checks of the
+  accuracy.
+
+  Every row starts on a cache line (64 bytes): the rows are padded
+  to a leading dimension (stride) that is a multiple of the line, so
+  the vector kernels start aligned on every row, and a tableau can
+  grow by a few columns without moving its rows. A shared buffer
+  (e.g. a mapped snapshot) is used as it is, with stride n.
+
+  The accessors check the bounds only in the debug build (make debug):
+  the release build defines NDEBUG, so they cost a multiplication and
+  an addition in the hot loops.
+*/
+
+/* a row, or part of it, given to the kernels: the bounds of the
+   elements are checked like the ones of the matrix */
+template <typename T>
+struct Span {
+  T *data;
+  int size;
+
+  inline T &operator[] (int j) {
+    assert( j >= 0 && j < size );
+    return data[j];
+  }
+};
+
+template <typename T>
+class BasicMatrix {
 
  public:
-  Matrix (int m, int n, double *buffer);
-  virtual ~Matrix ();
+  BasicMatrix (int m, int n, T *buffer);             // copy the m x n elements of the buffer
+  BasicMatrix (int m, int n, T *buffer, int shared); /* if shared, use the buffer without
+							copying it (it must outlive the matrix,
+							and its stride is n) */
+  virtual ~BasicMatrix ();
 
   /* getters and setters */
 
   inline int m ()      { return _m; };
   inline int n ()      { return _n; };
+  inline int stride () { return _ld; };         // distance between two rows, in elements
 
-  inline double at (int i, int j) {             // get element at position
+  inline T at (int i, int j) {                  // get element at position
     assert ( i >= 0  &&  j >= 0  &&
 	     i < _m  &&  j < _n );
-    return buffer[i * _n + j];
+    return buffer[(size_t) i * _ld + j];
   }
 
-  inline double at (int i, int j, double val) { // set element at position
+  inline T at (int i, int j, T val) {           // set element at position
     assert ( i >= 0  &&  j >= 0  &&
 	     i < _m  &&  j < _n );
-    return buffer[i * _n + j] = val;
+    return buffer[(size_t) i * _ld + j] = val;
   }
+
+  inline T *row (int i) {                       // raw access to a row, for the vector kernels
+    assert( i >= 0 && i < _m );
+    return &buffer[(size_t) i * _ld];
+  }
+
+  inline Span<T> span (int i, int begin, int end) { // elements [begin, end) of a row
+    assert( begin >= 0 && begin <= end && end <= _n );
+    Span<T> s = { row(i) + begin, end - begin };
+    return s;
+  }
+
+  void column (int j, T *dst);                  // copy a column in a contiguous vector
  
   /* elementary row operations */
 
   void swap_rows    (int row1, int row2);
   void swap_columns (int col1, int col2);
 
-  void scale_row    (int row, double k);
-  void scale_column (int col, double k);
+  void scale_row    (int row, T k);
+  void scale_column (int col, T k);
 
-  void add_premultiplied_row    (int src, double k, int dst);
-  void add_premultiplied_column (int src, double k, int dst);
+  void add_premultiplied_row    (int src, T k, int dst);
+  void add_premultiplied_column (int src, T k, int dst);
 
   /* matrix operations */
 
-  void invert ();
-  Matrix *multiply_by (Matrix *mat);
+  void invert (); // (the factorization is in double)
+  BasicMatrix *multiply_by (BasicMatrix *mat);
 
   /* other stuff... */
 
   virtual void print (); // pretty print the matrix 
-  virtual Matrix *clone (); // create a copy
+  virtual BasicMatrix *clone (); // create a copy
 
   /* unit tests */
   static void test ();
 
  protected:
   int _m, _n;
-  double *buffer;
+  int _ld;    // leading dimension: the stride of the rows, in elements
+  T *buffer;
+  int shared; // the buffer is not owned by the matrix
 
   /* setters */
 
   inline int m (int v) { return _m = v; };
   inline int n (int v) { return _n = v; };
 
+  /* storage */
+
+  static int padded (int n);                 // stride of n columns: whole cache lines
+  static T *allocate (int m, int ld);        // m zero rows, aligned on a cache line
+  void copy_rows (const T *src, int src_ld); // copy the elements of src (stride src_ld)
+
 };
 
+typedef BasicMatrix<double> Matrix;
+
 #endif
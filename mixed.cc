@@ -0,0 +1,383 @@
+#include <math.h>
+
+#include "mixed.h"
+#include "simplex.h"
+#include "dual.h"
+#include "parser.h"
+#include "pricing.h"
+#include "generator.h"
+#include "degeneracy.h"
+#include "tolerances.h"
+#include "kernels.h"
+#include "trace.h"
+
+/* Settings */
+int Mixed::enabled = 0;
+double Mixed::tolerance = 1e-5; // about a hundred times the float rounding
+
+static const int iteration_factor = 10; // the float iterations stop after 10 (m + n) pivots
+static const double devex_reset = 1e6;  // weights restarted from 1 above this value
+
+/* Copy a tableau in another precision (basis and bounds included) */
+template <typename S, typename T>
+static BasicTableau<T> *convert (BasicTableau<S> *tab)
+{
+  BasicTableau<T> *copy = new BasicTableau<T>(tab->m(), tab->n(), NULL, NULL);
+
+  for (int i = 0; i < tab->m(); i++) {
+    S *src = tab->row(i);
+    T *dst = copy->row(i);
+
+    for (int j = 0; j < tab->n(); j++)
+      dst[j] = (T) src[j];
+  }
+
+  for (int i = 0; i < tab->m() - 1; i++)
+    if (tab->basis_set_at(i)) copy->basis_at(i, tab->basis_at(i));
+
+  for (int j = 0; j < tab->n() - 1; j++) {
+    copy->lower_at(j, tab->lower_at(j));
+    copy->upper_at(j, tab->upper_at(j));
+    copy->complemented_at(j, tab->complemented_at(j));
+  }
+
+  return copy;
+}
+
+/* Iterations of the primal simplex in the precision of the tableau,
+   at most limit pivots (or bound flips): the number of them done
+
+   The Devex rule selects the entering column (Bland's rule after
+   Pricing::stall_limit consecutive degenerate pivots, until the next
+   nondegenerate one, see Pricing), and the exiting row is the largest pivot among
+   the rows whose ratio is within the tolerance of the smallest one
+   (Harris' test, see PrimalSimplex::select_exiting_column). The
+   iterations stop at the optimum, or when the problem looks unlimited:
+   the refinement in double decides. */
+template <typename T>
+static int iterate_low (BasicTableau<T> *tab, int limit)
+{
+  int rows = tab->m() - 1, columns = tab->n() - 1;
+  T tolerance = Mixed::tolerance;
+
+  T *column = (T *) malloc(tab->m() * sizeof(*column)); // reduced costs row included
+  T *room = (T *) malloc(rows * sizeof(*room)); // distance of the basic variables from their bounds
+  T *weights = (T *) malloc(columns * sizeof(*weights)); // Devex reference weights
+
+  for (int k = 0; k < columns; k++)
+    weights[k] = 1;
+
+  int iterations = 0, degenerate = 0;
+
+  while (iterations < limit) {
+    T *costs = tab->row(rows);
+    int j = -1;
+
+    if (degenerate >= Pricing::stall_limit)
+      j = Kernels::first_below(costs, - tolerance, columns);
+    else {
+      T best = 0;
+
+      for (int k = 0; k < columns; k++) {
+	if (costs[k] >= - tolerance || costs[k] * costs[k] <= best * weights[k]) continue;
+
+	j = k;
+	best = costs[k] * costs[k] / weights[k];
+      }
+    }
+
+    if (j == -1) break; // optimal
+
+    tab->column(j, column);
+
+    // first pass: the largest step, with the bounds relaxed by the tolerance
+
+    T step = HUGE_VAL;
+
+    for (int i = 0; i < rows; i++) {
+      T x = tab->at(i, columns);
+      double u = tab->upper_at(tab->basis_at(i));
+
+      if (column[i] > tolerance) room[i] = fmax(x, 0);
+      else if (column[i] < - tolerance && u != HUGE_VAL) room[i] = fmax(u - x, 0);
+      else {
+	room[i] = -1;
+	continue;
+      }
+
+      step = fmin(step, (room[i] + tolerance) / fabs(column[i]));
+    }
+
+    if (tab->upper_at(j) <= step) { // the entering variable reaches its bound first
+      tab->complement_column(j);
+      iterations++;
+      degenerate = 0;
+      continue;
+    }
+
+    // second pass: the largest pivot not beyond the step
+
+    int i = -1;
+    T best = 0;
+
+    for (int k = 0; k < rows; k++) {
+      if (room[k] < 0) continue;
+
+      T a = fabs(column[k]);
+
+      if (room[k] / a <= step && a > best) {
+	i = k;
+	best = a;
+      }
+    }
+
+    if (i == -1) break; // unlimited
+
+    if (column[i] < 0) // the variable leaves the basis at its upper bound
+      tab->complement_column(tab->basis_at(i));
+
+    if (fabs(tab->at(i, columns)) <= tolerance) degenerate++;
+    else degenerate = 0;
+
+    // the Devex weights, before the pivot (see Pricing::update)
+
+    T *pivot_row = tab->row(i);
+    T pivot = pivot_row[j], weight = weights[j];
+    int reset = 0;
+
+    for (int k = 0; k < columns; k++) {
+      if (k == j || pivot_row[k] == 0) continue;
+
+      T r = pivot_row[k] / pivot;
+
+      if (r * r * weight > weights[k]) weights[k] = r * r * weight;
+      if (weights[k] > devex_reset) reset = 1;
+    }
+
+    weights[tab->basis_at(i)] = fmax(weight / (pivot * pivot), 1);
+    weights[j] = 1;
+
+    if (reset)
+      for (int k = 0; k < columns; k++)
+	weights[k] = 1;
+
+    tab->basis_at(i, j);
+    tab->pivot(i, j);
+
+    iterations++;
+    TRACE_ITERATION("mixed", iterations, i, j, - tab->at(rows, columns));
+  }
+
+  free(column);
+  free(room);
+  free(weights);
+
+  return iterations;
+}
+
+/* Make the columns of the basis basic, pivoting on the largest elements */
+int Mixed::install_basis (Tableau *tab, int *basis, int *complemented)
+{
+  int rows = tab->m() - 1, columns = tab->n() - 1;
+
+  for (int j = 0; j < columns; j++)
+    if (tab->complemented_at(j) != complemented[j]) tab->complement_column(j);
+
+  int *assigned = (int *) calloc(rows, sizeof(*assigned)); // rows holding a column of the basis
+  int *pending = (int *) calloc(columns, sizeof(*pending)); // columns of the basis not yet basic
+
+  for (int k = 0; k < rows; k++)
+    pending[basis[k]] = 1;
+
+  for (int i = 0; i < rows; i++) { // the columns already basic keep their rows
+    if (tab->basis_set_at(i) && pending[tab->basis_at(i)]) {
+      pending[tab->basis_at(i)] = 0;
+      assigned[i] = 1;
+    }
+  }
+
+  int installed = 1;
+
+  for (int k = 0; k < rows && installed; k++) {
+    int j = basis[k];
+
+    if (!pending[j]) continue;
+
+    int i = -1;
+    double best = Tolerances::pivot;
+
+    for (int r = 0; r < rows; r++) { // partial pivoting, among the rows still free
+      if (!assigned[r] && fabs(tab->at(r, j)) > best) {
+	i = r;
+	best = fabs(tab->at(r, j));
+      }
+    }
+
+    if (i == -1) {
+      installed = 0;
+      break;
+    }
+
+    tab->basis_at(i, j);
+    tab->pivot(i, j);
+
+    pending[j] = 0;
+    assigned[i] = 1;
+  }
+
+  free(assigned);
+  free(pending);
+
+  return installed;
+}
+
+double Mixed::simplex (Tableau *tab)
+{
+  int rows = tab->m() - 1, columns = tab->n() - 1;
+
+  for (int i = 0; i < rows; i++) // an incomplete basis is left to the primal simplex
+    if (!tab->basis_set_at(i)) return PrimalSimplex::simplex(tab);
+
+  int *basis = (int *) malloc(rows * sizeof(*basis));                      // original basis
+  int *complemented = (int *) malloc(columns * sizeof(*complemented));
+  int *low_basis = (int *) malloc(rows * sizeof(*low_basis));              // final float basis
+  int *low_complemented = (int *) malloc(columns * sizeof(*low_complemented));
+
+  for (int i = 0; i < rows; i++)
+    basis[i] = tab->basis_at(i);
+
+  for (int j = 0; j < columns; j++)
+    complemented[j] = tab->complemented_at(j);
+
+  // iterations in float, on a copy
+
+  BasicTableau<float> *low = convert<double, float>(tab);
+  int iterations = iterate_low(low, iteration_factor * (tab->m() + tab->n()));
+
+  for (int i = 0; i < rows; i++)
+    low_basis[i] = low->basis_at(i);
+
+  for (int j = 0; j < columns; j++)
+    low_complemented[j] = low->complemented_at(j);
+
+  TRACE_MESSAGE(Trace::SUMMARY, "mixed", "%d iterations in float, cost %f",
+		iterations, - (double) low->at(rows, columns));
+
+  delete low;
+
+  // the final basis, in double from the original data
+
+  int installed = install_basis(tab, low_basis, low_complemented);
+  int dual = installed && !DualSimplex::test_feasibility(tab);
+
+  if (dual && !PrimalSimplex::test_optimality(tab))
+    installed = 0; // neither primal nor dual feasible
+
+  if (!installed) {
+    TRACE_MESSAGE(Trace::SUMMARY, "mixed", "float basis not usable, solved from the original one");
+
+    dual = 0;
+
+    if (!install_basis(tab, basis, complemented)) {
+      free(basis); free(complemented); free(low_basis); free(low_complemented);
+      throw new SingularException();
+    }
+  }
+
+  free(basis);
+  free(complemented);
+  free(low_basis);
+  free(low_complemented);
+
+  // refinement
+
+  if (dual) {
+    TRACE_MESSAGE(Trace::SUMMARY, "mixed", "float basis optimal, not feasible: dual simplex refinement");
+    return DualSimplex::iterate(tab, 0, Degeneracy::perturb);
+  }
+
+  return PrimalSimplex::iterate(tab, 1, Degeneracy::perturb);
+}
+
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  int *counts = (int *) arg; // float and double pivots
+
+  if (ev->type == Trace::ITERATION) counts[strcmp(ev->method, "mixed") ? 1 : 0]++;
+}
+
+/* Unit tests */
+void Mixed::test ()
+{
+  double buffer[] = { 12,   8, 2, 0, /**/ 48,
+		       6,  -4, 0, 2, /**/ 12,
+		      /*--------------------*/
+		      -1,  -1, 0, 0, /**/  0 };
+
+  int indices[] = {2, 3};
+
+  Tableau *tab = new Tableau(3, 5, buffer, indices);
+  tab->canonicalize();
+
+  double cost = simplex(tab);
+
+  puts("\nMixed: solved tableau, float iterations and refinement in double:");
+  tab->print();
+  printf("Mixed: cost %g\n", cost);
+
+  delete tab;
+
+  // the random problems, in double and in mixed precision
+
+  int saved_level = Trace::level;
+  int counts[2];
+
+  for (int f = 0; f < Generator::FAMILIES; f++) {
+    if (f == Generator::UNBOUNDED || f == Generator::INFEASIBLE) continue;
+
+    Tableau *reference = Generator::generate(f, 40, 80, 1, SIMPLEX);
+    if (!reference) continue;
+
+    Tableau *mixed = reference->clone();
+
+    double expected = PrimalSimplex::simplex(reference);
+
+    Trace::level = Trace::ITERATIONS;
+    Trace::set_callback(count_iterations, counts);
+
+    counts[0] = counts[1] = 0;
+    double cost = simplex(mixed);
+
+    Trace::set_callback(NULL, NULL);
+    Trace::level = saved_level;
+
+    printf("Mixed: %s, cost %.6f (double: %.6f), %d float pivots, %d double pivots\n",
+	   Generator::family_names[f], cost, expected, counts[0], counts[1]);
+
+    delete reference;
+    delete mixed;
+  }
+
+  // the kernels of the three types give the same tableau
+
+  float low[] = { 12, 8, 2, 0, 48, 6, -4, 0, 2, 12, -1, -1, 0, 0, 0 };
+  long double high[] = { 12, 8, 2, 0, 48, 6, -4, 0, 2, 12, -1, -1, 0, 0, 0 };
+
+  BasicTableau<float> *tab_low = new BasicTableau<float>(3, 5, low, indices);
+  BasicTableau<long double> *tab_high = new BasicTableau<long double>(3, 5, high, indices);
+
+  tab_low->canonicalize();
+  tab_high->canonicalize();
+
+  int pivots_low = iterate_low(tab_low, 100);
+  int pivots_high = iterate_low(tab_high, 100);
+
+  printf("\nMixed: float tableau, %d pivots, cost %g\n", pivots_low, - (double) tab_low->at(2, 4));
+  tab_low->print();
+
+  printf("Mixed: long double tableau, %d pivots, cost %g\n", pivots_high, - (double) tab_high->at(2, 4));
+  tab_high->print();
+
+  delete tab_low;
+  delete tab_high;
+}
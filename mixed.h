@@ -0,0 +1,61 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef MIXED_H
+#define MIXED_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Mixed-precision primal simplex.
+
+  The pivots of a dense tableau read and write every element, so
+  on large tableaux they are bound by the memory bandwidth: in float
+  a row is half the bytes, and a vector holds twice the elements.
+
+  The tableau is copied in float and the primal simplex iterates on
+  the copy (Dantzig's rule, a ratio test with tolerances fitting the
+  float rounding, bound flips), until it is optimal or stops making
+  progress. Then its final basis (and the bounds of its complemented
+  columns) is installed in the original tableau, that was not
+  changed, with pivots in double on the original data, and the
+  primal simplex (or the dual, if the basis is optimal but slightly
+  infeasible) refines it: usually a few pivots, when the float
+  iterations were accurate enough.
+
+  If the float basis is singular in double, or neither primal nor
+  dual feasible, the solve restarts from the original basis.
+*/
+
+namespace Mixed {
+
+  /* Settings */
+  extern int enabled;      // iterate in float first (SIMPLEX method, see Batch::solve)
+  extern double tolerance; // primal, dual and pivot tolerance of the float iterations
+
+  /* Primal simplex, iterating in float and refining in double */
+  double simplex (Tableau *tab);
+
+  /* Unit tests */
+  void test ();
+
+  // private:
+
+  /* Make the columns of the basis basic in a tableau, and the
+     columns marked complemented complemented, pivoting on the
+     largest elements: 0 if the basis is singular */
+  int install_basis (Tableau *tab, int *basis, int *complemented);
+
+}
+
+#endif
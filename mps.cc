@@ -0,0 +1,683 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mps.h"
+#include "parser.h"
+#include "revised.h"
+#include "trace.h"
+
+extern char *pname;
+
+/* special row indices */
+#define OBJECTIVE_ROW (-1) // the first N row
+#define FREE_ROW      (-2) // the other N rows, ignored
+
+/* an element of the COLUMNS section */
+struct triplet {
+  int col, row;
+  double value;
+};
+
+/* a constraint row of the file */
+struct mps_row {
+  char type;  // 'L', 'G' or 'E'
+  double rhs;
+  double range;
+  int ranged;
+};
+
+/* a variable of the file */
+struct mps_column {
+  std::string name;
+  double cost;
+  double lower, upper;
+};
+
+/* the content of the file */
+struct mps_data {
+  std::unordered_map<std::string, int> row_index, col_index;
+  std::vector<struct mps_row> rows;
+  std::vector<struct mps_column> cols;
+  std::vector<struct triplet> elements;
+  double constant;
+  int maximize;
+};
+
+/* a field of a line */
+struct token {
+  const char *p;
+  int len;
+};
+
+/* Split a line in its fields, return their number */
+static int tokenize (const char *p, const char *end, struct token *tok, int max)
+{
+  int count = 0;
+
+  while (count < max) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p == end) break;
+
+    tok[count].p = p;
+    while (p < end && *p != ' ' && *p != '\t') p++;
+    tok[count].len = p - tok[count].p;
+    count++;
+  }
+
+  return count;
+}
+
+static inline int is_token (struct token *tok, const char *word)
+{
+  return tok->len == (int) strlen(word) && memcmp(tok->p, word, tok->len) == 0;
+}
+
+static inline std::string token_string (struct token *tok)
+{
+  return std::string(tok->p, tok->len);
+}
+
+/* Parse a number filling the whole field, 0 on errors */
+static int token_number (struct token *tok, double *value)
+{
+  const char *p = tok->p, *end = tok->p + tok->len;
+
+  if (p < end && *p == '+') p++; // from_chars doesn't accept the plus sign
+
+  std::from_chars_result r = std::from_chars(p, end, *value);
+  return r.ec == std::errc() && r.ptr == end;
+}
+
+/* Sections of the file */
+enum section { NONE, NAME, OBJSENSE, ROWS, COLUMNS, RHS, RANGES, BOUNDS, ENDATA };
+
+/* Parse a line of the ROWS section, return an error message or NULL */
+static const char *parse_row (struct mps_data *d, struct token *tok, int count, int *objective)
+{
+  if (count != 2 || tok[0].len != 1) return "invalid row";
+
+  std::string name = token_string(&tok[1]);
+  if (d->row_index.count(name)) return "duplicated row";
+
+  switch (tok[0].p[0]) {
+  case 'N':
+    d->row_index[name] = *objective ? FREE_ROW : OBJECTIVE_ROW;
+    *objective = 1;
+    return NULL;
+  case 'L':
+  case 'G':
+  case 'E':
+    break;
+  default:
+    return "invalid row type";
+  }
+
+  struct mps_row r = { tok[0].p[0], 0.0, 0.0, 0 };
+
+  d->row_index[name] = d->rows.size();
+  d->rows.push_back(r);
+
+  return NULL;
+}
+
+/* Parse a line of the COLUMNS section, return an error message or NULL */
+static const char *parse_column (struct mps_data *d, struct token *tok, int count, int *last)
+{
+  if (count >= 3 && is_token(&tok[1], "'MARKER'")) return NULL; // integrality is ignored
+
+  if (count != 3 && count != 5) return "invalid column";
+
+  // the elements of a column are usually contiguous
+  if (*last == -1 || !is_token(&tok[0], d->cols[*last].name.c_str())) {
+    std::string name = token_string(&tok[0]);
+    auto it = d->col_index.find(name);
+
+    if (it == d->col_index.end()) {
+      struct mps_column c = { name, 0.0, 0.0, HUGE_VAL };
+
+      *last = d->cols.size();
+      d->col_index[name] = *last;
+      d->cols.push_back(c);
+    } else {
+      *last = it->second;
+    }
+  }
+
+  for (int k = 1; k < count; k += 2) {
+    auto it = d->row_index.find(token_string(&tok[k]));
+    double value;
+
+    if (it == d->row_index.end()) return "unknown row";
+    if (!token_number(&tok[k + 1], &value)) return "invalid number";
+
+    if (it->second == OBJECTIVE_ROW) {
+      d->cols[*last].cost += value;
+    } else if (it->second != FREE_ROW && value != 0.0) {
+      struct triplet t = { *last, it->second, value };
+      d->elements.push_back(t);
+    }
+  }
+
+  return NULL;
+}
+
+/* Parse a line of the RHS or RANGES sections, return an error message or NULL */
+static const char *parse_rhs (struct mps_data *d, struct token *tok, int count, int ranges)
+{
+  if (count < 2 || count > 5) return "invalid line";
+
+  int first = count % 2; // the name of the set is optional
+
+  for (int k = first; k < count; k += 2) {
+    auto it = d->row_index.find(token_string(&tok[k]));
+    double value;
+
+    if (it == d->row_index.end()) return "unknown row";
+    if (!token_number(&tok[k + 1], &value)) return "invalid number";
+
+    if (it->second == OBJECTIVE_ROW) {
+      if (ranges) return "range on the objective";
+      d->constant = -value;
+    } else if (it->second != FREE_ROW) {
+      if (ranges) {
+	d->rows[it->second].range = value;
+	d->rows[it->second].ranged = 1;
+      } else {
+	d->rows[it->second].rhs = value;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/* Parse a line of the BOUNDS section, return an error message or NULL */
+static const char *parse_bound (struct mps_data *d, struct token *tok, int count)
+{
+  if (count < 2 || tok[0].len != 2) return "invalid bound";
+
+  int has_value = !(is_token(&tok[0], "FR") || is_token(&tok[0], "MI") ||
+		    is_token(&tok[0], "PL") || is_token(&tok[0], "BV"));
+
+  int field = count - 1 - has_value; // the name of the set is optional
+  if (field < 1 || field > 2) return "invalid bound";
+
+  auto it = d->col_index.find(token_string(&tok[field]));
+  if (it == d->col_index.end()) return "unknown column";
+
+  struct mps_column *c = &d->cols[it->second];
+  double value = 0.0;
+
+  if (has_value && !token_number(&tok[count - 1], &value)) return "invalid number";
+
+  if (is_token(&tok[0], "UP") || is_token(&tok[0], "UI")) {
+    if (value < 0.0 && c->lower == 0.0) c->lower = -HUGE_VAL;
+    c->upper = value;
+  } else if (is_token(&tok[0], "LO") || is_token(&tok[0], "LI")) {
+    c->lower = value;
+  } else if (is_token(&tok[0], "FX")) {
+    c->lower = c->upper = value;
+  } else if (is_token(&tok[0], "FR")) {
+    c->lower = -HUGE_VAL;
+    c->upper = HUGE_VAL;
+  } else if (is_token(&tok[0], "MI")) {
+    c->lower = -HUGE_VAL;
+  } else if (is_token(&tok[0], "PL")) {
+    c->upper = HUGE_VAL;
+  } else if (is_token(&tok[0], "BV")) {
+    c->lower = 0.0;
+    c->upper = 1.0;
+  } else {
+    return "invalid bound type";
+  }
+
+  return NULL;
+}
+
+/* Read the sections of the file, return an error message or NULL
+   (the line of the error is returned in error_line) */
+static const char *parse_data (struct mps_data *d, const char *begin, const char *end, int *error_line)
+{
+  enum section section = NONE;
+  int objective = 0, last = -1, line = 0;
+
+  struct token tok[8];
+
+  for (const char *p = begin, *next; p < end; p = next) {
+    const char *e = (const char *) memchr(p, '\n', end - p);
+
+    if (!e) e = end;
+    next = e < end ? e + 1 : end;
+    line++;
+
+    if (e > p && e[-1] == '\r') e--;
+    if (p == e || *p == '*') continue; // empty lines and comments
+
+    int count = tokenize(p, e, tok, 8);
+    if (count == 0) continue;
+
+    const char *error = NULL;
+
+    if (*p != ' ' && *p != '\t') { // section header
+
+      if (is_token(&tok[0], "NAME")) section = NAME;
+      else if (is_token(&tok[0], "ROWS")) section = ROWS;
+      else if (is_token(&tok[0], "COLUMNS")) section = COLUMNS;
+      else if (is_token(&tok[0], "RHS")) section = RHS;
+      else if (is_token(&tok[0], "RANGES")) section = RANGES;
+      else if (is_token(&tok[0], "BOUNDS")) section = BOUNDS;
+      else if (is_token(&tok[0], "ENDATA")) return NULL;
+      else if (is_token(&tok[0], "OBJSENSE")) {
+	section = OBJSENSE;
+	if (count > 1) d->maximize = is_token(&tok[1], "MAX") || is_token(&tok[1], "MAXIMIZE");
+      }
+      else error = "unknown section";
+
+    } else {
+
+      switch (section) {
+      case OBJSENSE:
+	d->maximize = is_token(&tok[0], "MAX") || is_token(&tok[0], "MAXIMIZE");
+	break;
+      case ROWS:
+	error = parse_row(d, tok, count, &objective);
+	break;
+      case COLUMNS:
+	error = parse_column(d, tok, count, &last);
+	break;
+      case RHS:
+	error = parse_rhs(d, tok, count, 0);
+	break;
+      case RANGES:
+	error = parse_rhs(d, tok, count, 1);
+	break;
+      case BOUNDS:
+	error = parse_bound(d, tok, count);
+	break;
+      default:
+	error = "line outside of the sections";
+	break;
+      }
+
+    }
+
+    if (error) {
+      *error_line = line;
+      return error;
+    }
+  }
+
+  *error_line = line;
+  return "missing ENDATA";
+}
+
+static inline int triplet_less (const struct triplet &a, const struct triplet &b)
+{
+  return a.col < b.col || (a.col == b.col && a.row < b.row);
+}
+
+/* Convert the problem to the standard form, in a sparse tableau */
+static struct Mps::model *build_model (struct mps_data *d)
+{
+  int rows = d->rows.size(), cols = d->cols.size();
+
+  struct Mps::model *md = (struct Mps::model *) malloc(sizeof(struct Mps::model));
+
+  md->columns  = cols;
+  md->names    = (char **) malloc(cols * sizeof(char *));
+  md->cost     = (double *) malloc(cols * sizeof(double));
+  md->positive = (int *) malloc(cols * sizeof(int));
+  md->negative = (int *) malloc(cols * sizeof(int));
+  md->offset   = (double *) malloc(cols * sizeof(double));
+  md->sign     = (double *) malloc(cols * sizeof(double));
+  md->constant = d->constant;
+  md->maximize = d->maximize;
+
+  // columns of the variables, and the bound rows of the variables
+
+  int n = 0, bound_rows = 0;
+
+  for (int j = 0; j < cols; j++) {
+    struct mps_column *c = &d->cols[j];
+
+    md->names[j] = strdup(c->name.c_str());
+    md->cost[j] = c->cost;
+    md->positive[j] = md->negative[j] = -1;
+    md->offset[j] = 0.0;
+    md->sign[j] = 1.0;
+
+    if (c->lower == c->upper) { // fixed
+      md->offset[j] = c->lower;
+    } else if (c->lower > -HUGE_VAL) {
+      md->positive[j] = n++;
+      md->offset[j] = c->lower;
+      if (c->upper < HUGE_VAL) bound_rows++;
+    } else if (c->upper < HUGE_VAL) {
+      md->positive[j] = n++;
+      md->offset[j] = c->upper;
+      md->sign[j] = -1.0;
+    } else { // free
+      md->positive[j] = n++;
+      md->negative[j] = n++;
+    }
+  }
+
+  // slack columns of the inequalities and of the ranges
+
+  int *slack = (int *) malloc((rows + 1) * sizeof(int));
+  double *rhs = (double *) malloc((rows + 1) * sizeof(double));
+
+  for (int i = 0; i < rows; i++) {
+    struct mps_row *r = &d->rows[i];
+
+    slack[i] = -1;
+    rhs[i] = r->rhs;
+
+    if (r->ranged && r->range != 0.0) { // a x + s = hi, s <= hi - lo
+      if (r->type == 'G' || (r->type == 'E' && r->range > 0.0)) rhs[i] += fabs(r->range);
+      slack[i] = n++;
+      bound_rows++;
+    } else if (r->type != 'E') {
+      slack[i] = n++;
+    }
+  }
+
+  int m = rows + bound_rows + 1;
+  int first_bound = n;
+
+  n += bound_rows + 1;
+
+  // move the offsets of the variables to the right hand side
+
+  for (size_t k = 0; k < d->elements.size(); k++) {
+    struct triplet *t = &d->elements[k];
+    rhs[t->row] -= t->value * md->offset[t->col];
+  }
+
+  // fill the tableau, column by column: the elements of every row are appended in order
+
+  std::sort(d->elements.begin(), d->elements.end(), triplet_less);
+
+  SparseMatrix *tab = new SparseMatrix(m, n);
+  double objective_sign = md->maximize ? -1.0 : 1.0;
+  int bound_row = rows, bound = first_bound;
+  size_t k = 0;
+
+  for (int j = 0; j < cols; j++) {
+    size_t start = k;
+
+    while (k < d->elements.size() && d->elements[k].col == j) k++;
+
+    if (md->positive[j] == -1) continue;
+
+    for (int part = 0; part < 2; part++) { // the positive and the negative part
+      int col = part ? md->negative[j] : md->positive[j];
+      double sign = part ? -1.0 : md->sign[j];
+
+      if (col == -1) break;
+
+      for (size_t q = start; q < k; q++) {
+	double value = d->elements[q].value;
+
+	while (q + 1 < k && d->elements[q + 1].row == d->elements[q].row) // duplicated elements
+	  value += d->elements[++q].value;
+
+	if (value != 0.0) tab->at(d->elements[q].row, col, sign * value);
+      }
+
+      if (!part && md->negative[j] == -1 && d->cols[j].lower > -HUGE_VAL && d->cols[j].upper < HUGE_VAL) {
+	tab->at(bound_row, col, 1.0); // x' + t = u - l
+	tab->at(bound_row, bound, 1.0);
+	tab->at(bound_row, n - 1, d->cols[j].upper - d->cols[j].lower);
+	bound_row++;
+	bound++;
+      }
+
+      if (md->cost[j] != 0.0) tab->at(m - 1, col, objective_sign * sign * md->cost[j]);
+    }
+  }
+
+  for (int i = 0; i < rows; i++) {
+    struct mps_row *r = &d->rows[i];
+
+    if (slack[i] == -1) continue;
+
+    if (r->ranged && r->range != 0.0) { // s + t = hi - lo
+      tab->at(i, slack[i], 1.0);
+      tab->at(bound_row, slack[i], 1.0);
+      tab->at(bound_row, bound, 1.0);
+      tab->at(bound_row, n - 1, fabs(r->range));
+      bound_row++;
+      bound++;
+    } else {
+      tab->at(i, slack[i], r->type == 'L' ? 1.0 : -1.0);
+    }
+  }
+
+  for (int i = 0; i < rows; i++)
+    if (rhs[i] != 0.0) tab->at(i, n - 1, rhs[i]);
+
+  assert( bound_row == m - 1 && bound == n - 1 );
+
+  md->tab = tab;
+
+  free(slack);
+  free(rhs);
+
+  return md;
+}
+
+/* Read a MPS file, NULL if the file is not valid (the error is printed) */
+struct Mps::model *Mps::read (const char *filename)
+{
+  struct Parser::mapped_file file;
+
+  if (!Parser::map_file(filename, &file)) {
+    fprintf(stderr, "%s: can't open the file: %s\n", pname, filename);
+    return NULL;
+  }
+
+  struct mps_data d;
+  int line;
+
+  d.constant = 0.0;
+  d.maximize = 0;
+
+  const char *error = parse_data(&d, file.begin, file.end, &line);
+
+  Parser::unmap_file(&file);
+
+  if (!error) {
+    for (size_t j = 0; j < d.cols.size(); j++)
+      if (d.cols[j].lower > d.cols[j].upper) {
+	error = "inconsistent bounds";
+	line = 0;
+      }
+  }
+
+  if (error) {
+    fprintf(stderr, "%s: invalid MPS file: %s, %s, line: %d\n", pname, filename, error, line);
+    return NULL;
+  }
+
+  struct model *md = build_model(&d);
+
+  TRACE_MESSAGE(Trace::SUMMARY, "mps", "%d rows, %d columns, %d elements: standard form %d x %d, %d nonzeros",
+		(int) d.rows.size(), (int) d.cols.size(), (int) d.elements.size(),
+		md->tab->m() - 1, md->tab->n() - 1, md->tab->nnz());
+
+  return md;
+}
+
+/* Free a model */
+void Mps::delete_model (struct model *md)
+{
+  for (int j = 0; j < md->columns; j++)
+    free(md->names[j]);
+
+  delete md->tab;
+
+  free(md->names);
+  free(md->cost);
+  free(md->positive);
+  free(md->negative);
+  free(md->offset);
+  free(md->sign);
+  free(md);
+}
+
+/* Solve a model with the revised two-phase method */
+double Mps::solve (struct model *md, double *x)
+{
+  int *basis = (int *) malloc((md->tab->m() - 1) * sizeof(int));
+  double *values = (double *) malloc((md->tab->n() - 1) * sizeof(double));
+
+  try {
+    RevisedSimplex::two_phase(md->tab, basis, values);
+  } catch (TableauException *ex) {
+    free(basis);
+    free(values);
+    throw;
+  }
+
+  double objective = md->constant;
+
+  for (int j = 0; j < md->columns; j++) {
+    double value = md->offset[j];
+
+    if (md->positive[j] != -1) value += md->sign[j] * values[md->positive[j]];
+    if (md->negative[j] != -1) value -= values[md->negative[j]];
+
+    objective += md->cost[j] * value;
+    if (x) x[j] = value;
+  }
+
+  free(basis);
+  free(values);
+
+  return objective;
+}
+
+/* Unit tests */
+
+static struct Mps::model *read_string (const char *content)
+{
+  char filename[] = "/tmp/simplex_mps_XXXXXX";
+  int fd = mkstemp(filename);
+
+  if (fd == -1) return NULL;
+
+  if (write(fd, content, strlen(content)) != (ssize_t) strlen(content)) {
+    close(fd);
+    unlink(filename);
+    return NULL;
+  }
+
+  close(fd);
+
+  struct Mps::model *md = Mps::read(filename);
+  unlink(filename);
+
+  return md;
+}
+
+static void solve_string (const char *title, const char *content)
+{
+  struct Mps::model *md = read_string(content);
+
+  printf("\nMPS: %s:\n", title);
+
+  if (!md) return;
+
+  double *x = (double *) malloc(md->columns * sizeof(double));
+
+  try {
+    double objective = Mps::solve(md, x);
+
+    for (int j = 0; j < md->columns; j++)
+      printf("%s = %f\n", md->names[j], x[j]);
+
+    printf("objective: %f\n", objective);
+  } catch (TableauException *ex) {
+    puts("No solution found.");
+  }
+
+  free(x);
+  delete_model(md);
+}
+
+void Mps::test ()
+{
+  // fixed format, bounds (optimum 16: x = 0, y = -1, z = 6)
+
+  solve_string("fixed format problem",
+	       "NAME          TESTPROB\n"
+	       "ROWS\n"
+	       " N  COST\n"
+	       " L  LIM1\n"
+	       " G  LIM2\n"
+	       " E  MYEQN\n"
+	       "COLUMNS\n"
+	       "    XONE      COST         1   LIM1         1\n"
+	       "    XONE      LIM2         1\n"
+	       "    YTWO      COST         2   LIM1         1\n"
+	       "    YTWO      MYEQN       -1\n"
+	       "    ZTHREE    COST         3   LIM2         1\n"
+	       "    ZTHREE    MYEQN        1\n"
+	       "RHS\n"
+	       "    RHS       LIM1         4   LIM2         1\n"
+	       "    RHS       MYEQN        7\n"
+	       "BOUNDS\n"
+	       " UP BND       XONE         4\n"
+	       " LO BND       YTWO        -1\n"
+	       " UP BND       YTWO         1\n"
+	       "ENDATA\n");
+
+  // free format, maximization, ranges, free and fixed variables
+  // (optimum 14.5: a = 3, b = 1, c = -1, d = 5)
+
+  solve_string("free format problem",
+	       "* a comment\n"
+	       "NAME example\n"
+	       "OBJSENSE MAX\n"
+	       "ROWS\n"
+	       " N obj\n"
+	       " L c1\n"
+	       " E c2\n"
+	       " G c3\n"
+	       "COLUMNS\n"
+	       " a obj 1.5 c1 1\n"
+	       " a c3 1\n"
+	       " MARKER 'MARKER' 'INTORG'\n"
+	       " b obj 2 c1 1\n"
+	       " b c2 1\n"
+	       " MARKER 'MARKER' 'INTEND'\n"
+	       " c obj -1 c2 -1\n"
+	       " d obj 1 c3 1\n"
+	       "RHS\n"
+	       " c1 4 c2 -1\n"
+	       " obj -2\n"
+	       "RANGES\n"
+	       " c2 3\n"
+	       "BOUNDS\n"
+	       " FR BND c\n"
+	       " MI BND a\n"
+	       " UP BND a 3\n"
+	       " FX BND d 5\n"
+	       " UP BND c 2\n"
+	       "ENDATA\n");
+}
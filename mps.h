@@ -0,0 +1,83 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef MPS_H
+#define MPS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sparse.h"
+
+/*
+  Reader of the problems in MPS format (fixed or free).
+
+  The file is mapped in memory and read line by line: the
+  elements of the COLUMNS section are collected as triplets,
+  and the problem is converted to the standard form (equality
+  constraints, nonnegative variables) directly in a sparse
+  tableau, with the layout of the other solvers (cost row last,
+  variables column last). The dense tableau is never built.
+
+  The conversion:
+
+    L row      a x + s = b         G row       a x - s = b
+    range R    a x + s = hi,       s + t = hi - lo
+    l <= x     x = l + x'          x <= u      x = u - x' (no lower bound)
+    l <= x <= u                    x = l + x', x' + t = u - l
+    free x     x = x+ - x-         fixed x     substituted
+
+  Sections: NAME, OBJSENSE, ROWS, COLUMNS, RHS, RANGES, BOUNDS
+  (UP, LO, FX, FR, MI, PL, BV, LI, UI) and ENDATA. The first N
+  row is the objective, the other ones are ignored. MARKER lines
+  and integer bounds are read as the continuous relaxation.
+
+  Names can't contain spaces (the fields are split on blanks).
+*/
+
+namespace Mps {
+
+  //public:
+
+  /* A problem read from a MPS file */
+  struct model {
+    SparseMatrix *tab; // the problem in standard form (sparse tableau)
+
+    int columns;       // variables of the file
+    char **names;      // their names
+    double *cost;      // and their costs
+
+    // x = offset + sign * (tab column positive) - (tab column negative)
+    int *positive;     // -1 for fixed variables
+    int *negative;     // -1 but for free variables
+    double *offset;
+    double *sign;
+
+    double constant;   // constant term of the objective
+    int maximize;      // OBJSENSE MAX
+  };
+
+  /* Read a MPS file, NULL if the file is not valid (the error is printed) */
+  struct model *read (const char *filename);
+
+  /* Free a model */
+  void delete_model (struct model *md);
+
+  /* Solve a model with the revised two-phase method, and return the
+     objective value (the values of the variables are returned in x,
+     if not NULL). Throws a TableauException if there is no solution */
+  double solve (struct model *md, double *x);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
@@ -0,0 +1,601 @@
+#include <charconv>
+#include <math.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "parser.h"
+#include "threads.h"
+#include "trace.h"
+
+extern char *pname;
+
+/* Settings */
+long Parser::parallel_size = 1 << 23;
+
+/* a growing vector of doubles */
+
+struct values {
+  double *data;
+  long size, capacity;
+};
+
+static void push_value (struct values *v, double value)
+{
+  if (v->size == v->capacity) { // grow geometrically
+    v->capacity = v->capacity ? 2 * v->capacity : 1024;
+    v->data = (double *) realloc(v->data, v->capacity * sizeof(double));
+  }
+
+  v->data[v->size++] = value;
+}
+
+/* rows parsed by a chunk of the file */
+
+struct chunk {
+  const char *begin, *end; // lines to parse
+  int n;                   // elements in a row
+
+  struct values values;    // elements of the parsed rows
+  int rows;
+
+  const char *stop;        // first line after the tableau, NULL if not in the chunk
+  const char *error;       // line with an error, NULL if none
+  const char *message;
+};
+
+/* Map a file in memory (or read it, if it can't be mapped), 0 if it can't be opened */
+int Parser::map_file (const char *filename, struct mapped_file *t)
+{
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) return 0;
+
+  struct stat st;
+  t->mapped = 0;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (p != MAP_FAILED) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+      t->begin = (const char *) p;
+      t->end = t->begin + st.st_size;
+      t->size = st.st_size;
+      t->mapped = 1;
+    }
+  }
+
+  if (!t->mapped) { // pipes and the like: read the whole input
+    size_t size = 0, capacity = 1 << 16;
+    char *buffer = (char *) malloc(capacity);
+    ssize_t r;
+
+    while ((r = read(fd, buffer + size, capacity - size)) > 0) {
+      size += r;
+
+      if (size == capacity) {
+	capacity *= 2;
+	buffer = (char *) realloc(buffer, capacity);
+      }
+    }
+
+    t->begin = buffer;
+    t->end = buffer + size;
+    t->size = capacity;
+  }
+
+  close(fd);
+  return 1;
+}
+
+/* Release a mapped file */
+void Parser::unmap_file (struct mapped_file *t)
+{
+  if (t->mapped) munmap((void *) t->begin, t->size);
+  else free((void *) t->begin);
+}
+
+static inline int is_blank (char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/* End of the line starting at p (the newline, or the end of the text) */
+static inline const char *line_end (const char *p, const char *end)
+{
+  const char *nl = (const char *) memchr(p, '\n', end - p);
+  return nl ? nl : end;
+}
+
+/* Check if a line is empty or a comment */
+static inline int is_skipped (const char *p, const char *end)
+{
+  while (p < end && is_blank(*p)) p++;
+  return p == end || *p == '#';
+}
+
+/* Number of the line containing p, for the error messages */
+static int line_number (struct Parser::mapped_file *t, const char *p)
+{
+  int line = 1;
+
+  for (const char *q = t->begin; q < p; q++)
+    if (*q == '\n') line++;
+
+  return line;
+}
+
+/* Parse the next number of a line, advancing p: 1 if parsed,
+   0 at the end of the line, -1 if the token is not a number */
+template <typename T>
+static int next_number (const char **p, const char *end, T *value)
+{
+  const char *q = *p;
+
+  while (q < end && is_blank(*q)) q++;
+
+  if (q == end) return 0;
+
+  if (*q == '+' && q + 1 < end && !is_blank(q[1])) q++; // from_chars doesn't accept it
+
+  std::from_chars_result r = std::from_chars(q, end, *value);
+
+  if (r.ec != std::errc() || (r.ptr < end && !is_blank(*r.ptr)))
+    return -1; // not a number, or followed by garbage
+
+  *p = r.ptr;
+  return 1;
+}
+
+/* Parse the rows of the tableau in a chunk, until the end of the chunk
+   or the first empty (or comment) line */
+static void parse_rows (int begin, int end, void *arg)
+{
+  struct chunk *chunks = (struct chunk *) arg;
+
+  for (int k = begin; k < end; k++) {
+    struct chunk *c = &chunks[k];
+    const char *p = c->begin;
+
+    while (p < c->end) {
+      const char *eol = line_end(p, c->end);
+
+      if (is_skipped(p, eol)) { // end of the tableau
+	c->stop = p;
+	break;
+      }
+
+      const char *line = p;
+      int count = 0, r;
+      double value;
+
+      while ((r = next_number(&p, eol, &value)) == 1) {
+	push_value(&c->values, value);
+	count++;
+      }
+
+      if (r == -1) {
+	c->error = line;
+	c->message = "invalid element in tableau";
+	return;
+      }
+
+      if (count != c->n) {
+	c->error = line;
+	c->message = "invalid number of elements in row";
+	return;
+      }
+
+      c->rows++;
+      p = eol + 1;
+    }
+  }
+}
+
+/* Parse the bounds of the n variables in a line (inf for no upper bound),
+   return an error message or NULL */
+static const char *parse_bounds (const char *p, const char *end, int n, double *bounds, int lower)
+{
+  int count = 0, r;
+  double value;
+
+  while ((r = next_number(&p, end, &value)) == 1) {
+    if (count == n) return "invalid number of bounds";
+    if (value != value || (lower ? value == HUGE_VAL || value == - HUGE_VAL : value == - HUGE_VAL))
+      return lower ? "invalid lower bound" : "invalid upper bound";
+
+    bounds[count++] = value;
+  }
+
+  if (r == -1) return "invalid bound";
+  if (count != n) return "invalid number of bounds";
+
+  return NULL;
+}
+
+/* Split the lines in [begin, end) in line-aligned chunks */
+static struct chunk *split_chunks (const char *begin, const char *end, int n, int *count)
+{
+  int chunks = 1;
+
+  if (Threads::count > 1 && end - begin >= Parser::parallel_size)
+    chunks = 4 * Threads::count;
+
+  struct chunk *c = (struct chunk *) calloc(chunks, sizeof(*c));
+  const char *p = begin;
+
+  for (int k = 0; k < chunks; k++) {
+    c[k].begin = p;
+    c[k].n = n;
+
+    if (k == chunks - 1) p = end;
+    else {
+      p = begin + (end - begin) * (k + 1) / chunks;
+      if (p < c[k].begin) p = c[k].begin;
+      p = line_end(p, end);
+      if (p < end) p++; // after the newline
+    }
+
+    c[k].end = p;
+  }
+
+  *count = chunks;
+  return c;
+}
+
+/* Parse a problem file, NULL on errors (printed on stderr) */
+struct parsed_file *Parser::parse_file (const char *filename)
+{
+  struct mapped_file t;
+  const char *p, *eol, *error = NULL, *message = NULL;
+
+  int method = -1;
+  int m = 0, n = 0;
+  int *indices = NULL;
+  double *lower = NULL, *upper = NULL;
+  const char *upper_line = NULL;
+
+  struct chunk *chunks = NULL;
+  int chunk_count = 0;
+
+  struct values first = { NULL, 0, 0 };
+
+  if (!map_file(filename, &t)) {
+    fprintf(stderr, "%s: error opening file: %s\n", pname, filename);
+    return NULL;
+  }
+
+  // first of all read the solver method to apply
+
+  for (p = t.begin; p < t.end && is_skipped(p, line_end(p, t.end)); p = line_end(p, t.end) + 1);
+
+  eol = p < t.end ? line_end(p, t.end) : t.end;
+  while (p < eol && is_blank(*p)) p++;
+
+  if (eol - p >= 7 && !strncmp(p, "SIMPLEX", 7))
+    method = SIMPLEX;
+  else if (eol - p >= 9 && !strncmp(p, "TWO_PHASE", 9))
+    method = TWO_PHASE;
+  else if (eol - p >= 4 && !strncmp(p, "DUAL", 4))
+    method = DUAL;
+  else {
+    error = p;
+    message = "unknown method";
+    goto error_exit;
+  }
+
+  // the first row of the tableau gives the number of columns
+
+  for (p = eol + 1; p < t.end && is_skipped(p, line_end(p, t.end)); p = line_end(p, t.end) + 1);
+
+  if (p >= t.end) {
+    error = t.end;
+    message = "missing tableau";
+    goto error_exit;
+  }
+
+  eol = line_end(p, t.end);
+
+  {
+    const char *q = p;
+    double value;
+    int r;
+
+    while ((r = next_number(&q, eol, &value)) == 1)
+      push_value(&first, value);
+
+    if (r == -1) {
+      error = p;
+      message = "invalid element in tableau";
+      goto error_exit;
+    }
+  }
+
+  n = first.size;
+  m = 1;
+
+  // the other rows, in chunks
+
+  chunks = split_chunks(eol < t.end ? eol + 1 : t.end, t.end, n, &chunk_count);
+
+  if (chunk_count > 1)
+    Threads::parallel_for(0, chunk_count, 1, parse_rows, chunks);
+  else
+    parse_rows(0, 1, chunks);
+
+  p = t.end; // the rows end here, if no chunk finds the end of the tableau
+
+  for (int k = 0; k < chunk_count; k++) {
+    if (chunks[k].error) {
+      error = chunks[k].error;
+      message = chunks[k].message;
+      goto error_exit;
+    }
+
+    m += chunks[k].rows;
+
+    if (m > n) { // the error is on the row n (counting from 0)
+      error = chunks[k].begin;
+      message = "matrix rows >= matrix columns";
+
+      for (int row = m - chunks[k].rows; row < n; row++)
+	error = line_end(error, t.end) + 1;
+
+      goto error_exit;
+    }
+
+    if (chunks[k].stop) { // the other chunks are after the tableau
+      p = chunks[k].stop;
+      chunk_count = k + 1;
+      break;
+    }
+  }
+
+  // read the indices of the variables in basis, and the bounds of the variables
+
+  for (;; p = eol + 1) {
+    for (; p < t.end && is_skipped(p, line_end(p, t.end)); p = line_end(p, t.end) + 1);
+
+    if (p >= t.end) break;
+
+    eol = line_end(p, t.end);
+
+    const char *q = p;
+    while (q < eol && is_blank(*q)) q++;
+
+    if (eol - q >= 5 && (!strncmp(q, "LOWER", 5) || !strncmp(q, "UPPER", 5)) &&
+	(q + 5 == eol || is_blank(q[5]))) {
+      double **bounds = *q == 'L' ? &lower : &upper;
+
+      if (*bounds) {
+	error = p;
+	message = "bounds given twice";
+	goto error_exit;
+      }
+
+      *bounds = (double *) malloc((n > 1 ? n - 1 : 1) * sizeof(double));
+
+      if (*q == 'U') upper_line = p;
+
+      if ((message = parse_bounds(q + 5, eol, n - 1, *bounds, *q == 'L'))) {
+	error = p;
+	goto error_exit;
+      }
+
+      continue;
+    }
+
+    if (indices) continue; // only the first line of indices is read
+
+    indices = (int *) malloc((m - 1) * sizeof(*indices));
+
+    int count = 0, index, r;
+
+    while ((r = next_number(&q, eol, &index)) == 1) {
+      if (index < 0 || index >= n) {
+	r = -1;
+	break;
+      }
+
+      if (count == m - 1) { // too many
+	count++;
+	break;
+      }
+
+      indices[count++] = index;
+    }
+
+    if (r == -1) {
+      error = p;
+      message = "invalid variable in basis";
+      goto error_exit;
+    }
+
+    if (count != m - 1) {
+      error = p;
+      message = "invalid number of variables in basis";
+      goto error_exit;
+    }
+  }
+
+  for (int j = 0; lower && upper && j < n - 1; j++)
+    if (upper[j] < lower[j]) {
+      error = upper_line;
+      message = "upper bound below the lower bound";
+      goto error_exit;
+    }
+
+  { // prepare the tableau
+    struct parsed_file *parsed = (struct parsed_file *) malloc(sizeof(*parsed));
+
+    parsed->method = method;
+    parsed->tableau = new Tableau(m, n, NULL, indices);
+
+    memcpy(parsed->tableau->row(0), first.data, n * sizeof(double));
+
+    for (int k = 0, i = 1; k < chunk_count; k++) // the rows of a chunk are contiguous
+      for (int r = 0; r < chunks[k].rows; r++, i++)
+	memcpy(parsed->tableau->row(i), chunks[k].values.data + (size_t) r * n,
+	       n * sizeof(double));
+
+    for (int j = 0; j < n - 1; j++) { // the bounds, on the complete tableau
+      double l = lower ? lower[j] : 0.0, u = upper ? upper[j] : HUGE_VAL;
+      if (l != 0.0 || u != HUGE_VAL) parsed->tableau->bound_column(j, l, u);
+    }
+
+    for (int k = 0; k < chunk_count; k++)
+      free(chunks[k].values.data);
+
+    free(chunks);
+    free(first.data);
+    free(indices);
+    free(lower);
+    free(upper);
+    unmap_file(&t);
+
+    TRACE_TABLEAU("parser", "initial tableau", parsed->tableau);
+
+    return parsed;
+  }
+
+ error_exit:
+  fprintf(stderr, "%s: invalid format for the file: %s, %s, line: %d\n",
+	  pname, filename, message, line_number(&t, error));
+
+  if (chunks) {
+    for (int k = 0; k < chunk_count; k++)
+      free(chunks[k].values.data);
+    free(chunks);
+  }
+
+  free(first.data);
+  free(indices);
+  free(lower);
+  free(upper);
+  unmap_file(&t);
+
+  return NULL;
+}
+
+/* Free a parsed file */
+void Parser::delete_parsed (struct parsed_file *parsed)
+{
+  delete parsed->tableau;
+  free(parsed);
+}
+
+/* Unit tests */
+
+static struct parsed_file *parse_string (const char *content)
+{
+  char filename[] = "/tmp/simplex_parser_XXXXXX";
+  int fd = mkstemp(filename);
+
+  if (fd == -1) return NULL;
+
+  if (write(fd, content, strlen(content)) != (ssize_t) strlen(content)) {
+    close(fd);
+    unlink(filename);
+    return NULL;
+  }
+
+  close(fd);
+
+  struct parsed_file *parsed = Parser::parse_file(filename);
+  unlink(filename);
+
+  return parsed;
+}
+
+void Parser::test ()
+{
+  const char *problem =
+    "# a comment\n"
+    "\n"
+    "TWO_PHASE\n"
+    "\n"
+    " 1.0  2.0 +3.0  0.0   3.0\r\n"
+    "-1.0  2.0  6.0  0.0\t2.0\n"
+    " 0.0  4.0  9.0  0.0   5.0\n"
+    " 0.0  0.0  3.0  1.0   1.0\n"
+    " 0.0 -8.0 -21.5 0.0 -11.0\n"
+    "# end of the tableau\n"
+    "0 1 2 3\n";
+
+  struct parsed_file *parsed = parse_string(problem);
+
+  puts("\nParser: tableau of a two-phase problem:");
+
+  if (parsed) {
+    parsed->tableau->print();
+    delete_parsed(parsed);
+  }
+
+  // a row longer than any line buffer, parsed in chunks
+
+  int n = 3000;
+  size_t size = 64 + 3 * (size_t) n * 12;
+  char *big = (char *) malloc(size), *p = big;
+
+  p += sprintf(p, "SIMPLEX\n");
+
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < n; j++)
+      p += sprintf(p, "%d.25 ", i * n + j);
+    *p++ = '\n';
+  }
+
+  *p = '\0';
+
+  long saved_size = parallel_size;
+  int saved_count = Threads::count;
+
+  parallel_size = 0;
+  Threads::count = 4;
+
+  parsed = parse_string(big);
+
+  if (parsed) {
+    printf("\nParser: tableau with long rows: %d x %d, last element %.2f\n",
+	   parsed->tableau->m(), parsed->tableau->n(),
+	   parsed->tableau->at(parsed->tableau->m() - 1, parsed->tableau->n() - 1));
+    delete_parsed(parsed);
+  }
+
+  parallel_size = saved_size;
+  Threads::count = saved_count;
+
+  free(big);
+
+  // bounds: 1 <= x0 <= 3, x1 <= 2 (the column of x0 is shifted)
+
+  parsed = parse_string("SIMPLEX\n"
+			" 1  1  1 0  4\n"
+			" 1 -1  0 1  2\n"
+			"-1 -1  0 0  0\n"
+			"\n"
+			"2 3\n"
+			"LOWER 1 0   0   0\n"
+			"UPPER 3 2 inf inf\n");
+
+  puts("\nParser: tableau with bounds:");
+
+  if (parsed) {
+    parsed->tableau->print();
+    delete_parsed(parsed);
+  }
+
+  puts("Parser: invalid bounds:");
+
+  parsed = parse_string("SIMPLEX\n"
+			" 1 1 4\n"
+			"-1 0 0\n"
+			"\n"
+			"LOWER 0 2\n"
+			"UPPER 1 1\n");
+
+  if (parsed) delete_parsed(parsed);
+}
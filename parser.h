@@ -0,0 +1,82 @@
+/* 
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Parser of the problem files.
+
+  The file is mapped in memory and tokenized in a single pass,
+  without copying its lines. The rows of a large tableau are
+  split in line-aligned chunks, parsed in parallel.
+
+  The format of a file is:
+
+    METHOD          (SIMPLEX, TWO_PHASE or DUAL)
+
+    a b c ... z     (the rows of the tableau, ended by an
+    ...              empty line or a comment line)
+
+    i j ...         (optional, the columns of the basis variables)
+
+    LOWER l0 l1 ... (optional, the bounds of the variables: 0 and inf
+    UPPER u0 u1 ...  if not given, the lower bounds must be finite)
+
+  Empty lines and lines starting with # are skipped. The columns of the
+  variables having a lower bound are shifted (see Tableau::bound_column).
+*/
+
+enum solver_method {
+  SIMPLEX,
+  TWO_PHASE,
+  DUAL
+};
+
+struct parsed_file {
+  int method;
+  Tableau *tableau;
+};
+
+namespace Parser {
+
+  /* A file mapped in memory */
+  struct mapped_file {
+    const char *begin, *end;
+    int mapped;  // 1 if mapped, 0 if read in a buffer
+    size_t size; // of the mapping, or of the buffer
+  };
+
+  /* Map a file in memory (or read it, if it can't be mapped), 0 if it can't be opened */
+  int map_file (const char *filename, struct mapped_file *file);
+
+  /* Release a mapped file */
+  void unmap_file (struct mapped_file *file);
+
+  /* Settings */
+  extern long parallel_size; // bytes of tableau rows, from which they are parsed in parallel
+
+  /* Parse a problem file, NULL on errors (printed on stderr) */
+  struct parsed_file *parse_file (const char *filename);
+
+  /* Free a parsed file */
+  void delete_parsed (struct parsed_file *parsed);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
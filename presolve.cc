@@ -0,0 +1,566 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+
+#include "presolve.h"
+#include "simplex.h"
+#include "scaling.h"
+#include "trace.h"
+#include "tolerances.h"
+
+/* Settings */
+int Presolve::enabled = 0;
+
+static const char *reduction_names[] = {
+  "empty row", "empty column", "fixed column", "singleton row",
+  "forcing row", "duplicate row", "dominated column"
+};
+
+/* the problem being reduced: the removed rows and columns are only marked */
+struct problem {
+  int m, n;         // constraints and variables
+  double *a;        // m x n, by rows
+  double *b, *c, *upper;
+  double corner;    // of the tableau (minus the constant of the cost)
+
+  char *row_active, *col_active;
+};
+
+static inline double &element (struct problem *p, int i, int j)
+{
+  return p->a[(long) i * p->n + j];
+}
+
+static void push (struct Presolve::postsolve *ps, int type, int row, int col, double value)
+{
+  if (ps->count == ps->size) {
+    ps->size = ps->size ? 2 * ps->size : 64;
+    ps->stack = (struct Presolve::reduction *)
+      realloc(ps->stack, ps->size * sizeof(struct Presolve::reduction));
+  }
+
+  struct Presolve::reduction *r = &ps->stack[ps->count++];
+
+  r->type = type;
+  r->row = row;
+  r->col = col;
+  r->value = value;
+
+  TRACE_MESSAGE(Trace::ITERATIONS, "presolve", "%s: row %d, column %d, value %g",
+		reduction_names[type], row, col, value);
+}
+
+/* remove a variable with the given value, moving it to the right-hand sides and the cost */
+static void remove_column (struct problem *p, struct Presolve::postsolve *ps,
+			   int type, int row, int j, double value)
+{
+  if (value != 0.0) {
+    for (int i = 0; i < p->m; i++)
+      if (p->row_active[i]) p->b[i] -= element(p, i, j) * value;
+
+    p->corner -= p->c[j] * value;
+  }
+
+  p->col_active[j] = 0;
+  push(ps, type, row, j, value);
+}
+
+static void remove_row (struct problem *p, struct Presolve::postsolve *ps, int type, int i)
+{
+  p->row_active[i] = 0;
+  push(ps, type, i, -1, 0);
+}
+
+/* the reductions of a single row, 0 if none applies */
+static int reduce_row (struct problem *p, struct Presolve::postsolve *ps, int i)
+{
+  int count = 0, last = -1, positive = 0, negative = 0;
+
+  for (int j = 0; j < p->n; j++) {
+    double a = p->col_active[j] ? element(p, i, j) : 0.0;
+
+    if (a == 0.0) continue;
+
+    count++;
+    last = j;
+
+    if (a > 0) positive++;
+    else negative++;
+  }
+
+  double b = p->b[i];
+
+  if (count == 0) { // empty row
+    if (fabs(b) > Tolerances::primal) throw new ImpossibleException();
+
+    remove_row(p, ps, Presolve::EMPTY_ROW, i);
+    return 1;
+  }
+
+  // the sum of the terms of the same sign can't reach b
+
+  if ((b > Tolerances::primal && positive == 0) || (b < -Tolerances::primal && negative == 0))
+    throw new ImpossibleException();
+
+  if (count == 1) { // singleton row
+    double value = b / element(p, i, last);
+
+    if (value < -Tolerances::primal || value > p->upper[last] + Tolerances::primal)
+      throw new ImpossibleException();
+
+    p->row_active[i] = 0;
+    remove_column(p, ps, Presolve::SINGLETON_ROW, i, last, fmax(value, 0.0));
+    return 1;
+  }
+
+  if (fabs(b) <= Tolerances::primal && (positive == 0 || negative == 0)) { // forcing row
+    for (int j = 0; j < p->n; j++)
+      if (p->col_active[j] && element(p, i, j) != 0.0)
+	remove_column(p, ps, Presolve::FORCING_ROW, -1, j, 0.0);
+
+    return 1; // the row is empty, now
+  }
+
+  return 0;
+}
+
+/* the reductions of a single column, 0 if none applies */
+static int reduce_column (struct problem *p, struct Presolve::postsolve *ps, int j)
+{
+  if (p->upper[j] == 0.0) {
+    remove_column(p, ps, Presolve::FIXED_COLUMN, -1, j, 0.0);
+    return 1;
+  }
+
+  for (int i = 0; i < p->m; i++)
+    if (p->row_active[i] && element(p, i, j) != 0.0) return 0;
+
+  if (p->c[j] < 0) return 0; // unlimited, if the problem is feasible
+
+  remove_column(p, ps, Presolve::EMPTY_COLUMN, -1, j, 0.0);
+  return 1;
+}
+
+/* rows (or columns) with the same nonzero pattern, for the duplicates */
+struct pattern {
+  unsigned long hash;
+  int index;
+};
+
+static int compare_patterns (const void *a, const void *b)
+{
+  const struct pattern *x = (const struct pattern *) a, *y = (const struct pattern *) b;
+
+  if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+  return x->index - y->index;
+}
+
+/* elements of a row (or column), through the active elements of the other dimension */
+struct line {
+  double *first;     // element 0
+  long step;         // between the elements of the line
+  char *active;      // of the other dimension
+  int length;
+};
+
+static unsigned long pattern_hash (struct line *l)
+{
+  unsigned long hash = 1469598103934665603UL;
+
+  for (int k = 0; k < l->length; k++)
+    if (l->active[k] && l->first[k * l->step] != 0.0)
+      hash = (hash ^ (unsigned long) k) * 1099511628211UL;
+
+  return hash;
+}
+
+/* the ratio of two lines if one is a multiple of the other, 0 if not */
+static double multiple (struct line *x, struct line *y)
+{
+  double ratio = 0.0;
+
+  for (int k = 0; k < x->length; k++) {
+    if (!x->active[k]) continue;
+
+    double u = x->first[k * x->step], v = y->first[k * y->step];
+
+    if (ratio == 0.0) {
+      if (u == 0.0 && v == 0.0) continue;
+      if (u == 0.0 || v == 0.0) return 0.0;
+
+      ratio = v / u;
+    }
+
+    else if (fabs(v - ratio * u) > Tolerances::primal * fmax(1.0, fabs(v)))
+      return 0.0;
+  }
+
+  return ratio;
+}
+
+static struct line row_line (struct problem *p, int i)
+{
+  struct line l = { &element(p, i, 0), 1, p->col_active, p->n };
+  return l;
+}
+
+static struct line column_line (struct problem *p, int j)
+{
+  struct line l = { &element(p, 0, j), p->n, p->row_active, p->m };
+  return l;
+}
+
+static int sort_patterns (struct problem *p, struct pattern *patterns, int rows)
+{
+  int count = 0;
+
+  for (int k = 0; k < (rows ? p->m : p->n); k++) {
+    if (!(rows ? p->row_active[k] : p->col_active[k])) continue;
+
+    struct line l = rows ? row_line(p, k) : column_line(p, k);
+
+    patterns[count].hash = pattern_hash(&l);
+    patterns[count].index = k;
+    count++;
+  }
+
+  qsort(patterns, count, sizeof(struct pattern), compare_patterns);
+
+  return count;
+}
+
+static int reduce_duplicate_rows (struct problem *p, struct Presolve::postsolve *ps)
+{
+  struct pattern *patterns = (struct pattern *) malloc(p->m * sizeof(struct pattern));
+  int count = sort_patterns(p, patterns, 1), reduced = 0;
+
+  for (int x = 0; x < count; x++) {
+    int i = patterns[x].index;
+    if (!p->row_active[i]) continue;
+
+    struct line li = row_line(p, i);
+
+    for (int y = x + 1; y < count && patterns[y].hash == patterns[x].hash; y++) {
+      int k = patterns[y].index;
+      if (!p->row_active[k]) continue;
+
+      struct line lk = row_line(p, k);
+      double ratio = multiple(&li, &lk);
+
+      if (ratio == 0.0) continue;
+
+      if (fabs(p->b[k] - ratio * p->b[i]) > Tolerances::primal * fmax(1.0, fabs(p->b[k]))) {
+	free(patterns);
+	throw new ImpossibleException();
+      }
+
+      remove_row(p, ps, Presolve::DUPLICATE_ROW, k);
+      reduced++;
+    }
+  }
+
+  free(patterns);
+  return reduced;
+}
+
+static int reduce_duplicate_columns (struct problem *p, struct Presolve::postsolve *ps)
+{
+  struct pattern *patterns = (struct pattern *) malloc(p->n * sizeof(struct pattern));
+  int count = sort_patterns(p, patterns, 0), reduced = 0;
+
+  for (int x = 0; x < count; x++) {
+    int j = patterns[x].index;
+    if (!p->col_active[j] || p->upper[j] != HUGE_VAL) continue;
+
+    struct line lj = column_line(p, j);
+
+    for (int y = x + 1; y < count && patterns[y].hash == patterns[x].hash; y++) {
+      int k = patterns[y].index;
+      if (!p->col_active[k] || p->upper[k] != HUGE_VAL) continue;
+
+      struct line lk = column_line(p, k);
+      double ratio = multiple(&lj, &lk);
+
+      if (ratio <= 0.0) continue;
+
+      /* a_k = ratio a_j: x_k contributes as ratio x_j, at cost c_k against
+	 ratio c_j. The more expensive one is never needed */
+
+      reduced++;
+
+      if (p->c[k] >= ratio * p->c[j]) {
+	remove_column(p, ps, Presolve::DOMINATED_COLUMN, -1, k, 0.0);
+      } else {
+	remove_column(p, ps, Presolve::DOMINATED_COLUMN, -1, j, 0.0);
+	break;
+      }
+    }
+  }
+
+  free(patterns);
+  return reduced;
+}
+
+/* Reduce the problem of a tableau */
+Tableau *Presolve::reduce (Tableau *tab, struct postsolve **result)
+{
+  int m = tab->m() - 1, n = tab->n() - 1; // constraints and variables
+
+  struct problem p;
+
+  p.m = m;
+  p.n = n;
+  p.a = (double *) malloc((size_t) m * n * sizeof(double));
+  p.b = (double *) malloc(m * sizeof(double));
+  p.c = (double *) malloc(n * sizeof(double));
+  p.upper = (double *) malloc(n * sizeof(double));
+  p.corner = tab->at(m, n);
+  p.row_active = (char *) malloc(m);
+  p.col_active = (char *) malloc(n);
+
+  for (int i = 0; i < m; i++) {
+    memcpy(&element(&p, i, 0), tab->row(i), n * sizeof(double));
+    p.b[i] = tab->at(i, n);
+  }
+
+  memcpy(p.c, tab->row(m), n * sizeof(double));
+
+  for (int j = 0; j < n; j++)
+    p.upper[j] = tab->upper_at(j);
+
+  memset(p.row_active, 1, m);
+  memset(p.col_active, 1, n);
+
+  struct postsolve *ps = (struct postsolve *) calloc(1, sizeof(struct postsolve));
+
+  ps->m = m;
+  ps->n = n;
+
+  try {
+    int reduced;
+
+    do {
+      reduced = 0;
+
+      for (int j = 0; j < n; j++)
+	if (p.col_active[j]) reduced += reduce_column(&p, ps, j);
+
+      for (int i = 0; i < m; i++)
+	if (p.row_active[i]) reduced += reduce_row(&p, ps, i);
+
+      if (!reduced) // the duplicates, once the cheaper reductions are done
+	reduced = reduce_duplicate_rows(&p, ps) + reduce_duplicate_columns(&p, ps);
+
+    } while (reduced);
+
+  } catch (TableauException *ex) {
+    TRACE_MESSAGE(Trace::SUMMARY, "presolve", "the problem is impossible");
+
+    free(p.a); free(p.b); free(p.c); free(p.upper);
+    free(p.row_active); free(p.col_active);
+    delete_postsolve(ps);
+    throw;
+  }
+
+  // the reduced tableau
+
+  ps->rows = (int *) malloc((m > 0 ? m : 1) * sizeof(int));
+  ps->columns = (int *) malloc((n > 0 ? n : 1) * sizeof(int));
+
+  for (int i = 0; i < m; i++)
+    if (p.row_active[i]) ps->rows[ps->reduced_m++] = i;
+
+  for (int j = 0; j < n; j++)
+    if (p.col_active[j]) ps->columns[ps->reduced_n++] = j;
+
+  Tableau *reduced = new Tableau(ps->reduced_m + 1, ps->reduced_n + 1, NULL, NULL);
+
+  for (int i = 0; i < ps->reduced_m; i++) {
+    for (int j = 0; j < ps->reduced_n; j++)
+      reduced->at(i, j, element(&p, ps->rows[i], ps->columns[j]));
+
+    reduced->at(i, ps->reduced_n, p.b[ps->rows[i]]);
+  }
+
+  for (int j = 0; j < ps->reduced_n; j++) {
+    reduced->at(ps->reduced_m, j, p.c[ps->columns[j]]);
+
+    if (p.upper[ps->columns[j]] != HUGE_VAL)
+      reduced->upper_at(j, p.upper[ps->columns[j]]);
+  }
+
+  reduced->at(ps->reduced_m, ps->reduced_n, p.corner);
+
+  TRACE_MESSAGE(Trace::SUMMARY, "presolve", "%d reductions, %d of %d rows and "
+		"%d of %d columns left", ps->count, ps->reduced_m, m, ps->reduced_n, n);
+
+  free(p.a); free(p.b); free(p.c); free(p.upper);
+  free(p.row_active); free(p.col_active);
+
+  *result = ps;
+  return reduced;
+}
+
+/* Values of the original variables, from the optimal reduced tableau */
+void Presolve::restore (struct postsolve *ps, Tableau *reduced, double *x)
+{
+  for (int j = 0; j < ps->n; j++)
+    x[j] = 0.0;
+
+  // the variables of the reduced problem (the ones out of the basis are at a bound)
+
+  for (int j = 0; j < reduced->n() - 1; j++)
+    x[ps->columns[j]] = reduced->value_at(j);
+
+  // the removed variables
+
+  for (int k = ps->count - 1; k >= 0; k--)
+    if (ps->stack[k].col >= 0) x[ps->stack[k].col] = ps->stack[k].value;
+}
+
+/* Free a postsolve stack */
+void Presolve::delete_postsolve (struct postsolve *ps)
+{
+  free(ps->stack);
+  free(ps->rows);
+  free(ps->columns);
+  free(ps);
+}
+
+/* Solve a problem with the two-phase method after the presolve */
+double Presolve::two_phase (Tableau *tab, double *x)
+{
+  struct postsolve *ps;
+  Tableau *reduced = reduce(tab, &ps);
+
+  double cost;
+
+  struct Scaling::factors *f = NULL;
+
+  try {
+    if (ps->reduced_m > 0) {
+      if (Scaling::enabled) f = Scaling::scale(reduced);
+
+      cost = PrimalSimplex::two_phase(reduced);
+
+      if (f) Scaling::unscale(reduced, f);
+    }
+
+    else { // no constraints left: the variables are zero, if no cost is negative
+      for (int j = 0; j < ps->reduced_n; j++)
+	if (reduced->at(0, j) < 0) throw new UnlimitedException();
+
+      cost = -reduced->at(0, ps->reduced_n);
+    }
+  } catch (TableauException *ex) {
+    if (f) Scaling::delete_factors(f);
+    delete reduced;
+    delete_postsolve(ps);
+    throw;
+  }
+
+  if (f) Scaling::delete_factors(f);
+
+  if (x) { // the columns of the variables having a lower bound are shifted
+    restore(ps, reduced, x);
+    for (int j = 0; j < ps->n; j++) x[j] += tab->lower_at(j);
+  }
+
+  delete reduced;
+  delete_postsolve(ps);
+
+  return cost;
+}
+
+/* Unit tests */
+
+static void print_postsolve (struct Presolve::postsolve *ps)
+{
+  for (int k = 0; k < ps->count; k++) {
+    struct Presolve::reduction *r = &ps->stack[k];
+
+    printf("  %s:", reduction_names[r->type]);
+    if (r->row >= 0) printf(" row %d", r->row);
+    if (r->col >= 0) printf(" column %d = %g", r->col, r->value);
+    putchar('\n');
+  }
+}
+
+void Presolve::test ()
+{
+  /* every reduction:
+
+     row 0: x0 + x1 + x2 + s0      = 4
+     row 1:      2 x3              = 6   singleton: x3 = 3
+     row 2: 2 x0 + 2 x1 + 2 x2 + 2 s0 = 8   duplicate of row 0
+     row 3:           x4 + x5      = 0   forcing: x4 = x5 = 0
+     row 4: x0 - x2           + x3 - s1 = 4
+     x6: empty column, x1 = 2 x7 (x7 costs more than 2 x1), x8 fixed */
+
+  double buffer[] = {
+    1, 1,  1, 0, 0, 0, 0, 0.5, 0, 1,  0, /**/ 4,
+    0, 0,  0, 2, 0, 0, 0, 0,   0, 0,  0, /**/ 6,
+    2, 2,  2, 0, 0, 0, 0, 1,   0, 2,  0, /**/ 8,
+    0, 0,  0, 0, 1, 1, 0, 0,   0, 0,  0, /**/ 0,
+    1, 0, -1, 1, 0, 0, 0, 0,   1, 0, -1, /**/ 4,
+    /*---------------------------------------*/
+   -1, -2, 1, 1, 0, 0, 3, -0.5, 1, 0, 0, /**/ 0 };
+
+  Tableau *tab = new Tableau(6, 12, buffer, NULL);
+  tab->upper_at(8, 0);
+
+  struct postsolve *ps;
+  Tableau *reduced = reduce(tab, &ps);
+
+  printf("\nPresolve: %d reductions, %d x %d problem reduced to %d x %d:\n",
+	 ps->count, ps->m, ps->n, ps->reduced_m, ps->reduced_n);
+  print_postsolve(ps);
+  reduced->print();
+
+  delete reduced;
+  delete_postsolve(ps);
+
+  double x[11];
+  double cost = two_phase(tab, x);
+
+  printf("\nPresolve: cost %f, x =", cost);
+  for (int j = 0; j < 11; j++) printf(" %g", x[j]);
+  putchar('\n');
+
+  Tableau *plain = tab->clone();
+
+  try {
+    printf("Presolve: cost without presolve %f\n", PrimalSimplex::two_phase(plain));
+  } catch (TableauException *ex) {
+    puts("Presolve: no solution without presolve");
+    delete ex;
+  }
+
+  delete plain;
+
+  // an impossible problem: x0 + x1 = 1 and 2 x0 + 2 x1 = 3
+
+  double buffer2[] = { 1, 1, /**/ 1,
+		       2, 2, /**/ 3,
+		       /*---------*/
+		       1, 1, /**/ 0 };
+
+  Tableau *tab2 = new Tableau(3, 3, buffer2, NULL);
+
+  try {
+    two_phase(tab2, NULL);
+    puts("\nPresolve: impossible problem solved");
+  } catch (ImpossibleException *ex) {
+    puts("\nPresolve: impossible problem found");
+    delete ex;
+  }
+
+  delete tab2;
+  delete tab;
+}
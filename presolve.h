@@ -0,0 +1,103 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Presolve of the problems of the two-phase method (A x = b, x >= 0,
+  min c x), before the artificial tableau is built.
+
+  The reductions, repeated until none applies:
+
+    empty row        0 = b_i: removed (impossible problem if b_i != 0)
+    empty column     x_j = 0 if c_j >= 0 (kept otherwise: the simplex
+                     finds the problem unlimited, if feasible)
+    fixed column     upper bound zero: x_j = 0
+    singleton row    a_ij x_j = b_i: x_j = b_i / a_ij, moved to the
+                     right-hand sides and the cost
+    forcing row      b_i = 0 and the a_ik of the same sign: every x_k
+                     with a_ik != 0 is zero
+    duplicate row    a_k = l a_i: removed if b_k = l b_i (impossible
+                     problem otherwise)
+    duplicate column a_k = l a_j, l > 0, no upper bounds: the one
+                     that costs more for the same contribution is
+                     dominated, and zero
+
+  Every reduction is pushed on the postsolve stack, that maps the
+  solution of the reduced problem back to the original variables
+  (popping the reductions in reverse order) and keeps the original
+  row and column of every row and column of the reduced problem.
+
+  The reduced problem is scaled, if the scaling is enabled (see Scaling).
+*/
+
+namespace Presolve {
+
+  //public:
+
+  enum {                // reductions
+    EMPTY_ROW,
+    EMPTY_COLUMN,
+    FIXED_COLUMN,
+    SINGLETON_ROW,
+    FORCING_ROW,
+    DUPLICATE_ROW,
+    DOMINATED_COLUMN
+  };
+
+  struct reduction {
+    int type;
+    int row, col;       // removed (original indices, -1 if none)
+    double value;       // of the removed variable
+  };
+
+  struct postsolve {
+    int m, n;           // original constraints and variables
+
+    struct reduction *stack;
+    int count, size;
+
+    int reduced_m, reduced_n;
+    int *rows;          // original row of every row of the reduced problem
+    int *columns;       // original column of every column of the reduced problem
+  };
+
+  /* Settings */
+  extern int enabled;   // presolve the problems of the two-phase method
+
+  /* Reduce the problem of a tableau (not modified), return the reduced
+     tableau and its postsolve stack. Throws an ImpossibleException if
+     the reductions find the problem impossible */
+  Tableau *reduce (Tableau *tab, struct postsolve **ps);
+
+  /* Values of the original variables, from the optimal reduced tableau */
+  void restore (struct postsolve *ps, Tableau *reduced, double *x);
+
+  /* Free a postsolve stack */
+  void delete_postsolve (struct postsolve *ps);
+
+  /* Solve a problem with the two-phase method after the presolve, and
+     return the cost (the values of the variables in x, if not NULL; the
+     tableau is not modified). Throws a TableauException if there is no
+     solution */
+  double two_phase (Tableau *tab, double *x);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
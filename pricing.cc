@@ -0,0 +1,241 @@
+#include <math.h>
+
+#include "pricing.h"
+#include "kernels.h"
+#include "tolerances.h"
+
+/* Settings */
+int Pricing::rule = Pricing::DEVEX;
+int Pricing::stall_limit = 50;
+int Pricing::partial_width = 5000;
+int Pricing::sections = 8;
+int Pricing::list_size = 16;
+
+static const double devex_reset = 1e6; // weights restarted from 1 above this value
+
+static const char *rule_names[] = { "bland", "dantzig", "devex", "steepest" };
+
+/* Create the pricing state for a tableau, using the current rule */
+struct Pricing::pricing_state *Pricing::create_state (Tableau *tab)
+{
+  struct pricing_state *ps = (struct pricing_state *) malloc(sizeof(*ps));
+
+  ps->rule = rule;
+  ps->n = tab->n();
+  ps->bland = 0;
+
+  ps->partial = partial_width > 0 && ps->n - 1 >= partial_width && sections > 1;
+  ps->section = 0;
+  ps->list_size = list_size > 0 ? list_size : 1;
+  ps->list = (int *) malloc(ps->list_size * sizeof(int));
+  ps->scores = (double *) malloc(ps->list_size * sizeof(double));
+  ps->previous = (int *) malloc(ps->list_size * sizeof(int));
+  ps->candidates = 0;
+
+  ps->weights = (double *) malloc((ps->n - 1) * sizeof(double));
+  ps->products = (double *) malloc((ps->n - 1) * sizeof(double));
+
+  for (int j = 0; j < ps->n - 1; j++)
+    ps->weights[j] = 1.0;
+
+  if (ps->rule == STEEPEST_EDGE) { // exact weights: 1 + squared norm of the columns
+
+    for (int i = 0; i < tab->m() - 1; i++) { // m - 1 to skip the reduced costs row
+      double *row = tab->row(i);
+
+      for (int j = 0; j < ps->n - 1; j++)
+	ps->weights[j] += row[j] * row[j];
+    }
+  }
+
+  return ps;
+}
+
+/* Free the state */
+void Pricing::delete_state (struct pricing_state *ps)
+{
+  free(ps->weights);
+  free(ps->products);
+  free(ps->list);
+  free(ps->scores);
+  free(ps->previous);
+  free(ps);
+}
+
+/* Score of a column with a negative reduced cost, the higher the better */
+static inline double score (struct Pricing::pricing_state *ps, double cost, int j)
+{
+  return ps->rule == Pricing::DANTZIG ? - cost : cost * cost / ps->weights[j];
+}
+
+/* Best column of [begin, end), -1 if no reduced cost is negative
+   (below the dual tolerance) */
+static int select_best (struct Pricing::pricing_state *ps, double *costs, int begin, int end)
+{
+  int first = Kernels::first_below(costs + begin, - Tolerances::dual, end - begin);
+
+  if (first == -1) return -1;
+
+  int best = begin + first;
+  double best_score = score(ps, costs[best], best);
+
+  for (int j = best + 1; j < end; j++) {
+    if (costs[j] >= - Tolerances::dual) continue;
+
+    double s = score(ps, costs[j], j);
+
+    if (s > best_score) {
+      best = j;
+      best_score = s;
+    }
+  }
+
+  return best;
+}
+
+/* Insert a column in the candidate list, that is kept sorted by score
+   and holds only the best columns */
+static void insert_candidate (struct Pricing::pricing_state *ps, double cost, int j)
+{
+  double s = score(ps, cost, j);
+  int k = ps->candidates;
+
+  if (k == ps->list_size) {           // the list is full:
+    if (s <= ps->scores[k - 1]) return; // not better than the last candidate
+    k--;
+  }
+  else ps->candidates++;
+
+  for (; k > 0 && ps->scores[k - 1] < s; k--) {
+    ps->list[k] = ps->list[k - 1];
+    ps->scores[k] = ps->scores[k - 1];
+  }
+
+  ps->list[k] = j;
+  ps->scores[k] = s;
+}
+
+/* Select the entering column, -1 if no reduced cost is negative */
+int Pricing::select_entering_column (struct pricing_state *ps, Tableau *tab)
+{
+  /* n - 1 to exclude the last column containing
+     the cost of the current solution */
+
+  double *costs = tab->row(tab->m() - 1);
+
+  if (ps->rule == BLAND || ps->bland) // the smallest subscript needs a full scan
+    return Kernels::first_below(costs, - Tolerances::dual, ps->n - 1);
+
+  if (!ps->partial)
+    return select_best(ps, costs, 0, ps->n - 1);
+
+  // price the candidates again, dropping the ones that are no longer attractive
+
+  int previous = ps->candidates;
+
+  memcpy(ps->previous, ps->list, previous * sizeof(int));
+  ps->candidates = 0;
+
+  for (int k = 0; k < previous; k++) {
+    int j = ps->previous[k];
+    if (costs[j] < - Tolerances::dual) insert_candidate(ps, costs[j], j);
+  }
+
+  /* scan the next section, and the following ones
+     only while the list is empty */
+
+  int columns = ps->n - 1;
+  int size = (columns + sections - 1) / sections;
+
+  for (int k = 0; k < sections; k++) {
+    int begin = ps->section * size;
+    int end = begin + size < columns ? begin + size : columns;
+
+    ps->section = (ps->section + 1) % sections;
+
+    for (int j = begin; j < end; j++)
+      if (costs[j] < - Tolerances::dual) insert_candidate(ps, costs[j], j);
+
+    if (ps->candidates > 0)
+      return ps->list[0];
+  }
+
+  return -1; // no reduced cost is negative in any section
+}
+
+/* Update the state before the pivot on (i, j)
+
+   With r[k] = a[i][k] / a[i][j], the ratio between the pivot row
+   and the pivot, the exact weights are updated as:
+
+     w[k] = w[k] - 2 r[k] (column j . column k) + r[k]^2 w[j]
+
+   and the Devex weights as:
+
+     w[k] = max(w[k], r[k]^2 w[j])
+
+   The column leaving the basis gets w[j] / a[i][j]^2 (at least 1).
+*/
+void Pricing::update (struct pricing_state *ps, Tableau *tab, int i, int j)
+{
+  if (ps->rule != DEVEX && ps->rule != STEEPEST_EDGE)
+    return;
+
+  double *pivot_row = tab->row(i);
+  double pivot = pivot_row[j];
+  double weight = ps->weights[j];
+  int leaving = tab->basis_at(i);
+
+  if (ps->rule == STEEPEST_EDGE) {
+
+    // products between the pivot column and the other columns
+    memset(ps->products, 0, (ps->n - 1) * sizeof(double));
+
+    for (int k = 0; k < tab->m() - 1; k++) { // m - 1 to skip the reduced costs row
+      double value = tab->at(k, j);
+      if (value != 0) Kernels::axpy(ps->products, tab->row(k), value, ps->n - 1);
+    }
+  }
+
+  int reset = 0;
+
+  for (int k = 0; k < ps->n - 1; k++) {
+    if (k == j || pivot_row[k] == 0) continue;
+
+    double r = pivot_row[k] / pivot;
+
+    if (ps->rule == STEEPEST_EDGE) {
+      double w = ps->weights[k] - 2 * r * ps->products[k] + r * r * weight;
+      ps->weights[k] = fmax(w, 1 + r * r); // protect from the cancellation errors
+    }
+    else {
+      ps->weights[k] = fmax(ps->weights[k], r * r * weight);
+      if (ps->weights[k] > devex_reset) reset = 1;
+    }
+  }
+
+  if (leaving >= 0 && leaving < ps->n - 1)
+    ps->weights[leaving] = fmax(weight / (pivot * pivot), 1.0);
+
+  ps->weights[j] = 1.0; // in basis, not used
+
+  if (reset) // restart the reference framework
+    for (int k = 0; k < ps->n - 1; k++)
+      ps->weights[k] = 1.0;
+}
+
+/* Parse the name of a rule, -1 if unknown */
+int Pricing::parse_rule (const char *name)
+{
+  for (int k = 0; k < (int) (sizeof(rule_names) / sizeof(*rule_names)); k++)
+    if (!strcmp(name, rule_names[k])) return k;
+
+  return -1;
+}
+
+/* Name of a rule */
+const char *Pricing::rule_name (int rule)
+{
+  assert(rule >= 0 && rule < (int) (sizeof(rule_names) / sizeof(*rule_names)));
+  return rule_names[rule];
+}
@@ -0,0 +1,99 @@
+/* 
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef PRICING_H
+#define PRICING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Pricing rules for the entering column of the full-tableau
+  primal simplex.
+
+  The rules that use weights (Devex and steepest edge) keep them
+  in a pricing state, that lives for a single run of the method
+  and is updated before every pivot. When the method stalls on
+  degenerate pivots, and the perturbation didn't help (see
+  Degeneracy), the pricing falls back on Bland's rule, that can't
+  cycle, until the cost decreases again.
+
+  On wide tableaux the reduced costs are priced partially: the
+  columns are divided in sections, and the best candidates of a
+  section are kept in a short list, from which the entering columns
+  are selected (their reduced costs are priced again at every
+  iteration, since the pivots change them). Every iteration scans
+  one more section, in rotation, merging its candidates in the list;
+  when the list runs dry the following sections are scanned too, and
+  only when all of them are scanned without candidates the solution
+  is optimal.
+
+  A reduced cost is negative if it is below the dual tolerance
+  (see Tolerances).
+*/
+
+namespace Pricing {
+
+  enum {
+    BLAND,         // first negative reduced cost
+    DANTZIG,       // most negative reduced cost
+    DEVEX,         // most negative reduced cost, relative to approximate edge lengths
+    STEEPEST_EDGE  // most negative reduced cost, relative to exact edge lengths
+  };
+
+  /* Settings */
+  extern int rule;        // the pricing rule used by the primal simplex
+  extern int stall_limit; // consecutive degenerate pivots of a stall (see Degeneracy)
+  extern int partial_width; // columns from which partial pricing is used (0: never)
+  extern int sections;      // sections of the columns, for partial pricing
+  extern int list_size;     // candidates kept by partial pricing
+
+  struct pricing_state {
+    int rule;
+    int n;            // columns of the tableau (variables column included)
+
+    double *weights;  // weight of every column (n - 1 entries)
+    double *products; // work vector (n - 1 entries)
+
+    int bland;        // 1 while falling back on Bland's rule
+
+    int partial;      // 1 if the columns are priced partially
+    int section;      // next section to scan
+    int *list;        // candidate columns
+    int list_size;    // capacity of the list
+    double *scores;   // their scores
+    int *previous;    // work vector, for the candidates of the previous iteration
+    int candidates;   // candidates in the list
+  };
+
+  /* Create the pricing state for a tableau, using the current rule */
+  struct pricing_state *create_state (Tableau *tab);
+
+  /* Free the state */
+  void delete_state (struct pricing_state *ps);
+
+  /* Select the entering column, -1 if no reduced cost is negative
+     (i.e. the current solution is optimal) */
+  int select_entering_column (struct pricing_state *ps, Tableau *tab);
+
+  /* Update the state before the pivot on (i, j) */
+  void update (struct pricing_state *ps, Tableau *tab, int i, int j);
+
+  /* Parse the name of a rule, -1 if unknown */
+  int parse_rule (const char *name);
+
+  /* Name of a rule */
+  const char *rule_name (int rule);
+
+}
+
+#endif
@@ -0,0 +1,749 @@
+#include <math.h>
+
+#include "revised.h"
+#include "simplex.h"
+#include "trace.h"
+#include "tolerances.h"
+
+/* Settings */
+int RevisedSimplex::refactor_frequency = 100;
+int RevisedSimplex::update_method = BasisFactor::FOREST_TOMLIN;
+
+/* Create the state from a sparse tableau, with the given basis
+   (NULL if the basis is not known yet) */
+struct RevisedSimplex::revised_state *RevisedSimplex::create_state (SparseMatrix *tab, int *basis)
+{
+  struct revised_state *st = (struct revised_state *) malloc(sizeof(*st));
+
+  st->m = tab->m();
+  st->n = tab->n();
+
+  /* the constraint rows are copied, the reduced costs row
+     is kept apart, as a dense vector */
+
+  st->mat = new SparseMatrix(st->m - 1, st->n);
+  st->cost = (double *) calloc(st->n, sizeof(*st->cost));
+
+  for (int i = 0; i < st->m - 1; i++) // m - 1 to skip the reduced costs row
+    for (int z = 0; z < tab->row_nnz(i); z++)
+      st->mat->at(i, tab->row_index(i)[z], tab->row_value(i)[z]);
+
+  for (int z = 0; z < tab->row_nnz(st->m - 1); z++)
+    st->cost[tab->row_index(st->m - 1)[z]] = tab->row_value(st->m - 1)[z];
+
+  st->basis = (int *) malloc((st->m - 1) * sizeof(*st->basis));
+  st->slot = (int *) malloc(st->m * sizeof(*st->slot));
+  st->is_basic = (int *) calloc(st->n, sizeof(*st->is_basic));
+
+  for (int i = 0; i < st->m - 1; i++) {
+    st->basis[i] = basis ? basis[i] : -1;
+    if (st->basis[i] != -1) st->is_basic[st->basis[i]] = 1;
+  }
+
+  for (int i = 0; i < st->m; i++) // the tableau is assumed to be in canonical form
+    st->slot[i] = -1;
+
+  st->x = (double *) malloc(st->m * sizeof(*st->x));
+  st->priced = st->n - 1;
+
+  st->column = (double *) malloc(st->m * sizeof(*st->column));
+  st->row = (double *) malloc(st->m * sizeof(*st->row));
+
+  st->factor = NULL;
+  refactorize(st); // the identity
+
+  return st;
+}
+
+/* Free the state */
+void RevisedSimplex::delete_state (struct revised_state *st)
+{
+  delete st->mat;
+
+  free(st->cost);
+  free(st->basis);
+  free(st->slot);
+  free(st->is_basic);
+  free(st->x);
+  free(st->column);
+  free(st->row);
+
+  delete st->factor;
+
+  free(st);
+}
+
+/* Load column j of the original tableau in a dense vector */
+void RevisedSimplex::load_column (struct revised_state *st, int j, double *dst)
+{
+  int *col_start = st->mat->col_start();
+  int *row_index = st->mat->col_index();
+  double *value = st->mat->col_value();
+
+  memset(dst, 0, st->m * sizeof(*dst));
+
+  for (int k = col_start[j]; k < col_start[j + 1]; k++)
+    dst[row_index[k]] = value[k];
+
+  dst[st->m - 1] = st->cost[j];
+}
+
+/* Dot product between a dense row vector and column j of the original tableau */
+double RevisedSimplex::dot_column (struct revised_state *st, double *src, int j)
+{
+  int *col_start = st->mat->col_start();
+  int *row_index = st->mat->col_index();
+  double *value = st->mat->col_value();
+
+  double sum = src[st->m - 1] * st->cost[j];
+
+  for (int k = col_start[j]; k < col_start[j + 1]; k++)
+    sum += src[row_index[k]] * value[k];
+
+  return sum;
+}
+
+/* Factorize B from scratch, 0 if singular
+
+   Every row either holds a unit column (the initial basic variable,
+   never pivoted, or the reduced costs row), or the column of the
+   variable that entered the basis in that row.
+
+   If the basis is singular the current factorization
+   is not modified.
+*/
+int RevisedSimplex::refactorize (struct revised_state *st)
+{
+  int *mat_start = st->mat->col_start();
+  int *mat_index = st->mat->col_index();
+  double *mat_value = st->mat->col_value();
+
+  /* B in compressed form, by columns */
+
+  int nnz = st->m;
+  for (int i = 0; i < st->m; i++)
+    if (st->slot[i] != -1)
+      nnz += mat_start[st->slot[i] + 1] - mat_start[st->slot[i]];
+
+  int *col_start = (int *) malloc((st->m + 1) * sizeof(*col_start));
+  int *row_index = (int *) malloc(nnz * sizeof(*row_index));
+  double *value = (double *) malloc(nnz * sizeof(*value));
+
+  nnz = 0;
+
+  for (int i = 0; i < st->m; i++) {
+    int j = st->slot[i];
+    col_start[i] = nnz;
+
+    if (j == -1) { // unit column
+      row_index[nnz] = i;
+      value[nnz] = 1.0;
+      nnz++;
+      continue;
+    }
+
+    for (int k = mat_start[j]; k < mat_start[j + 1]; k++) {
+      row_index[nnz] = mat_index[k];
+      value[nnz] = mat_value[k];
+      nnz++;
+    }
+
+    if (st->cost[j] != 0.0) {
+      row_index[nnz] = st->m - 1;
+      value[nnz] = st->cost[j];
+      nnz++;
+    }
+  }
+
+  col_start[st->m] = nnz;
+
+  BasisFactor *factor = new BasisFactor(st->m);
+  factor->update_method = update_method;
+
+  int factorized = factor->factorize(col_start, row_index, value);
+
+  free(col_start);
+  free(row_index);
+  free(value);
+
+  if (!factorized) {
+    delete factor;
+    return 0;
+  }
+
+  /* replace the old factorization */
+
+  delete st->factor;
+  st->factor = factor;
+
+  // recompute the variables column with the new T
+
+  load_column(st, st->n - 1, st->x);
+  st->factor->ftran(st->x);
+
+  return 1;
+}
+
+/* Select the entering column, -1 if the current solution is optimal
+
+   Uses Bland's rule, i.e. select the negative reduced cost having
+   the smallest position (smallest subscript) in the vector.
+
+   The reduced costs are the last row of T * M: the last row of T
+   is computed once, then multiplied by the columns of M
+   as long as a negative reduced cost is not found.
+*/
+int RevisedSimplex::select_entering_column (struct revised_state *st)
+{
+  memset(st->row, 0, st->m * sizeof(*st->row));
+  st->row[st->m - 1] = 1.0;
+
+  st->factor->btran(st->row);
+
+  for (int j = 0; j < st->priced; j++) {
+    if (st->is_basic[j]) continue;
+
+    if (dot_column(st, st->row, j) < - Tolerances::dual) return j;
+  }
+
+  return -1;
+}
+
+/* Select the exiting row, -1 if the problem is unlimited
+
+   Uses Bland's rule, i.e. select the smallest ratio, and,
+   when multiple variables in base give the same ratio,
+   select the one having the smallest subscript
+*/
+int RevisedSimplex::select_exiting_row (struct revised_state *st, double *column)
+{
+  double min_ratio = 0;
+  int min_ratio_position = -1;
+
+  for (int i = 0; i < st->m - 1; i++) { /* m - 1 to exclude the reduced costs row */
+    if (column[i] <= Tolerances::pivot) continue;
+
+    double ratio = st->x[i] / column[i];
+
+    if (min_ratio_position == -1 ||
+	ratio < min_ratio - Tolerances::primal ||
+	(ratio <= min_ratio + Tolerances::primal && st->basis[i] < st->basis[min_ratio_position])) {
+
+      min_ratio = ratio;
+      min_ratio_position = i;
+    }
+  }
+
+  return min_ratio_position;
+}
+
+/* Pivot on the given row of an already transformed column */
+void RevisedSimplex::pivot (struct revised_state *st, int i, int j, double *column)
+{
+  int stable = st->factor->update(i, column);
+
+  // update the variables column, without a full transformation
+
+  double theta = st->x[i] / column[i];
+
+  for (int r = 0; r < st->m; r++)
+    if (r != i) st->x[r] -= theta * column[r];
+
+  st->x[i] = theta;
+
+  st->is_basic[st->basis[i]] = 0;
+  st->is_basic[j] = 1;
+
+  st->basis[i] = j;
+  st->slot[i] = j;
+
+  if (!stable || st->factor->updates() >= refactor_frequency) {
+    if (!refactorize(st)) {
+      TRACE_MESSAGE(Trace::SUMMARY, "revised", "singular basis");
+      throw new SingularException();
+    }
+  }
+}
+
+/* Iterate the revised method, until the optimal solution is found
+
+   The steps are the same of the full-tableau implementation,
+   but only the reduced costs row and the entering column
+   of the current tableau are computed.
+*/
+double RevisedSimplex::iterate (struct revised_state *st)
+{
+  int i, j;
+  int iteration = 0;
+
+ step_2:
+  j = select_entering_column(st);
+
+  if (j == -1) {
+    TRACE_MESSAGE(Trace::SUMMARY, "revised", "optimal solution found, %d iterations, cost %f",
+		  iteration, - st->x[st->m - 1]);
+
+    // extract cost from the tableau (the sign is inverted)
+    return - st->x[st->m - 1];
+  }
+
+  // step 3
+
+  load_column(st, j, st->column);
+  st->factor->ftran(st->column);
+
+  i = select_exiting_row(st, st->column);
+
+  if (i == -1) {
+    TRACE_MESSAGE(Trace::SUMMARY, "revised", "the problem is unlimited (column %d)", j);
+    throw new UnlimitedException();
+  }
+
+  // step 4, 5
+  pivot(st, i, j, st->column);
+
+  iteration++;
+  TRACE_ITERATION("revised", iteration, i, j, - st->x[st->m - 1]);
+
+  goto step_2;
+}
+
+/* Write the current tableau T * M back into tab
+
+   Rows having an artificial variable in basis are skipped:
+   tab must already have the correct number of rows.
+*/
+void RevisedSimplex::write_tableau (struct revised_state *st, Tableau *tab)
+{
+  int orig_n = tab->n() - 1; // original variables (and artificial variables after them)
+
+  for (int j = 0; j < tab->n(); j++) {
+    int src_j = (j == orig_n) ? st->n - 1 : j;
+
+    load_column(st, src_j, st->column);
+    st->factor->ftran(st->column);
+
+    int dst_i = 0;
+
+    for (int i = 0; i < st->m; i++) {
+      if (i < st->m - 1 && st->basis[i] >= orig_n) continue; // artificial variable
+
+      tab->at(dst_i, j, st->column[i]);
+
+      if (i < st->m - 1 && j == 0)
+	tab->basis_at(dst_i, st->basis[i]);
+
+      dst_i++;
+    }
+
+    assert(dst_i == tab->m());
+  }
+}
+
+/* Search variable already usable for the initial basis
+
+   The same criterion of the full-tableau implementation:
+   columns having a single positive element, and all other
+   elements null. The rows are scaled at the end, so that the
+   column-wise view is built only once.
+*/
+int RevisedSimplex::search_usable_variables (struct revised_state *st)
+{
+  int *col_start = st->mat->col_start();
+  int *row_index = st->mat->col_index();
+  double *value = st->mat->col_value();
+
+  double *scale = (double *) calloc(st->m - 1, sizeof(*scale));
+  int found_indices = 0;
+
+  for (int j = 0; j < st->n - 1; j++) { // n - 1 to skip the variables vector
+
+    if (found_indices >= st->m - 1)
+      break;
+
+    if (col_start[j + 1] - col_start[j] != 1) continue;
+
+    int elem_row = row_index[col_start[j]];
+    double elem = value[col_start[j]];
+
+    // can be used as a variable in basis, if in that row there are still no basis variable
+    if (elem > 0 && st->basis[elem_row] == -1) {
+      st->basis[elem_row] = j;
+      scale[elem_row] = 1.0 / elem;
+      found_indices++;
+    }
+  }
+
+  for (int i = 0; i < st->m - 1; i++)
+    if (scale[i] != 0.0) st->mat->scale_row(i, scale[i]);
+
+  free(scale);
+
+  return found_indices;
+}
+
+/* Add the artificial columns to the rows without a variable in basis
+
+   The artificial columns are placed before the variables column,
+   and enter the basis. The cost of the artificial variables is 1,
+   all other costs are null (the cost function of phase I).
+*/
+void RevisedSimplex::add_artificial_columns (struct revised_state *st, int art_columns)
+{
+  int orig_n = st->n - 1;
+  int n = st->n + art_columns;
+
+  SparseMatrix *mat = new SparseMatrix(st->m - 1, n);
+  int art_j = orig_n;
+
+  for (int i = 0; i < st->m - 1; i++) { // the elements are appended in column order
+    int len = st->mat->row_nnz(i);
+    int *index = st->mat->row_index(i);
+    double *value = st->mat->row_value(i);
+
+    for (int z = 0; z < len && index[z] < orig_n; z++)
+      mat->at(i, index[z], value[z]);
+
+    if (st->basis[i] == -1) {
+      mat->at(i, art_j, 1.0);
+      st->basis[i] = art_j++;
+    }
+
+    if (len && index[len - 1] == orig_n) // the variables column
+      mat->at(i, n - 1, value[len - 1]);
+  }
+
+  assert(art_j == n - 1);
+
+  delete st->mat;
+  st->mat = mat;
+  st->n = n;
+
+  st->cost = (double *) realloc(st->cost, n * sizeof(*st->cost));
+  st->is_basic = (int *) realloc(st->is_basic, n * sizeof(*st->is_basic));
+
+  for (int j = 0; j < n; j++) {
+    st->cost[j] = (j >= orig_n && j < n - 1) ? 1.0 : 0.0;
+    st->is_basic[j] = 0;
+  }
+
+  for (int i = 0; i < st->m - 1; i++) {
+    st->is_basic[st->basis[i]] = 1;
+    st->slot[i] = st->basis[i];
+  }
+
+  st->priced = n - 1;
+}
+
+/*
+  Two-phase simplex method, revised implementation.
+
+  The same steps of the full-tableau implementation, but the
+  artificial columns are only added to the sparse copy of the
+  tableau, and the canonical form is obtained factorizing
+  the initial basis, including the cost row.
+
+  Returns the optimal cost, the state contains the final basis:
+  artificial variables still in basis mark redundant rows.
+*/
+double RevisedSimplex::solve_two_phase (struct revised_state *st)
+{
+  /* Phase I */
+
+  // step 1
+
+  for (int i = 0; i < st->m - 1; i++) // m - 1 to skip the reduced costs row
+    // all the variables must be positive
+    if (st->mat->at(i, st->n - 1) < 0) st->mat->scale_row(i, -1.0);
+
+  // step 2
+
+  for (int i = 0; i < st->m - 1; i++)
+    st->basis[i] = -1;
+
+  int found_indices = search_usable_variables(st);
+  int art_columns = (st->m - 1) - found_indices;
+
+  int orig_n = st->n - 1;
+
+  double *orig_cost = (double *) malloc(st->n * sizeof(*orig_cost));
+  memcpy(orig_cost, st->cost, st->n * sizeof(*orig_cost));
+
+  add_artificial_columns(st, art_columns);
+
+  /* canonicalize: factorizing the basis also nullifies
+     the costs of the basic variables */
+
+  if (!refactorize(st))
+    assert(0); // the artificial basis is never singular
+
+  double cost;
+
+  try {
+    cost = iterate(st);
+  } catch (TableauException *ex) {
+    free(orig_cost);
+    throw;
+  }
+
+  // step 3
+
+  if (cost > Tolerances::primal) { // case 3.1
+    TRACE_MESSAGE(Trace::SUMMARY, "revised", "the problem is impossible");
+    free(orig_cost);
+    throw new ImpossibleException();
+  }
+
+  for (int i = 0; i < st->m - 1; i++) { // m - 1 to skip the reduced costs row
+    if (st->basis[i] < orig_n) continue; // search artificial variables in basis
+
+    // check if the row is null
+
+    memset(st->row, 0, st->m * sizeof(*st->row));
+    st->row[i] = 1.0;
+    st->factor->btran(st->row); // i-th row of T
+
+    int not_null_elem_column = -1;
+
+    for (int j = 0; j < orig_n; j++) { // only original variable columns
+      if (st->is_basic[j]) continue;
+
+      if (fabs(dot_column(st, st->row, j)) > Tolerances::pivot) {
+	not_null_elem_column = j;
+	break;
+      }
+    }
+
+    if (not_null_elem_column != -1) { // case 3.3.2
+      load_column(st, not_null_elem_column, st->column);
+      st->factor->ftran(st->column);
+
+      pivot(st, i, not_null_elem_column, st->column);
+    }
+
+    // case 3.3.1: the row is redundant, the artificial variable stays in basis (at zero)
+  }
+
+  // Phase II
+
+  // step 1 and 2: restore the original costs, and canonicalize
+
+  for (int j = 0; j < st->n; j++)
+    st->cost[j] = (j < orig_n) ? orig_cost[j] : 0.0;
+
+  st->cost[st->n - 1] = orig_cost[orig_n];
+  free(orig_cost);
+
+  st->priced = orig_n; // the artificial columns cannot enter the basis
+
+  if (!refactorize(st))
+    assert(0); // the basis of phase I is never singular
+
+  // step 3
+
+  return iterate(st);
+}
+
+/* Extract the final basis and the values of the original variables
+
+   Redundant rows (with an artificial variable in basis) get -1 as basis index.
+*/
+void RevisedSimplex::get_solution (struct revised_state *st, int orig_n, int *basis, double *x)
+{
+  if (x) {
+    for (int j = 0; j < orig_n; j++)
+      x[j] = 0.0;
+  }
+
+  for (int i = 0; i < st->m - 1; i++) {
+    int j = st->basis[i];
+
+    if (basis) basis[i] = (j < orig_n) ? j : -1;
+    if (x && j < orig_n) x[j] = st->x[i];
+  }
+}
+
+/*
+  Primal simplex, revised implementation.
+
+  The tableau must be in canonical form, as required by
+  the full-tableau implementation. At the end the final
+  tableau is written back into tab.
+*/
+double RevisedSimplex::simplex (Tableau *tab)
+{
+  SparseMatrix *mat = new SparseMatrix(tab);
+
+  int *basis = (int *) malloc((tab->m() - 1) * sizeof(*basis));
+  for (int i = 0; i < tab->m() - 1; i++)
+    basis[i] = tab->basis_at(i);
+
+  struct revised_state *st = create_state(mat, basis);
+  double cost;
+
+  delete mat;
+  free(basis);
+
+  try {
+    cost = iterate(st);
+  } catch (TableauException *ex) {
+    write_tableau(st, tab);
+    delete_state(st);
+    throw;
+  }
+
+  write_tableau(st, tab);
+  delete_state(st);
+
+  return cost;
+}
+
+/* Two-phase simplex method, revised implementation:
+   at the end the final tableau is written back into tab,
+   without the redundant rows */
+double RevisedSimplex::two_phase (Tableau *tab)
+{
+  SparseMatrix *mat = new SparseMatrix(tab);
+  struct revised_state *st = create_state(mat, NULL);
+  double cost;
+
+  delete mat;
+
+  try {
+    cost = solve_two_phase(st);
+  } catch (TableauException *ex) {
+    delete_state(st);
+    throw;
+  }
+
+  int *redundant = (int *) calloc(tab->m() - 1, sizeof(*redundant));
+
+  for (int i = 0, k = 0; i < st->m - 1; i++) // delete the redundant rows (the last ones)
+    if (st->basis[i] >= tab->n() - 1) redundant[tab->m() - 2 - k++] = 1;
+
+  tab->delete_rows(redundant);
+  free(redundant);
+
+  write_tableau(st, tab);
+  delete_state(st);
+
+  return cost;
+}
+
+/* Primal simplex on a sparse tableau, in canonical form with respect to basis */
+double RevisedSimplex::simplex (SparseMatrix *tab, int *basis, double *x)
+{
+  struct revised_state *st = create_state(tab, basis);
+  double cost;
+
+  try {
+    cost = iterate(st);
+  } catch (TableauException *ex) {
+    delete_state(st);
+    throw;
+  }
+
+  get_solution(st, tab->n() - 1, basis, x);
+  delete_state(st);
+
+  return cost;
+}
+
+/* Two-phase simplex method on a sparse tableau */
+double RevisedSimplex::two_phase (SparseMatrix *tab, int *basis, double *x)
+{
+  struct revised_state *st = create_state(tab, NULL);
+  double cost;
+
+  try {
+    cost = solve_two_phase(st);
+  } catch (TableauException *ex) {
+    delete_state(st);
+    throw;
+  }
+
+  get_solution(st, tab->n() - 1, basis, x);
+  delete_state(st);
+
+  return cost;
+}
+
+/* Unit tests */
+void RevisedSimplex::test ()
+{
+  EtaFile::test();
+  BasisFactor::test();
+
+  // simplex only
+
+  double buffer[] = { 12,   8, 2, 0, /**/ 48,
+		       6,  -4, 0, 2, /**/ 12,
+		      /*--------------------*/
+		      -1,  -1, 0, 0, /**/  0 };
+
+  int indices[] = {2, 3};
+
+  Tableau *tab  = new Tableau(3, 5, buffer, indices);
+
+  tab->canonicalize();
+
+  puts("\nRevised Simplex: canonicalized tableau 1:");
+  tab->print();
+
+  try {
+    simplex(tab);
+  } catch (TableauException *ex) {
+    delete ex;
+  }
+
+  puts("\nRevised Simplex: solved tableau 1 using only the simplex method:");
+  tab->print();
+
+  delete tab;
+
+  // two-phase method only
+
+  double buffer2[] = { 12,   8, 2, 0, /**/ 48,
+			6,  -4, 0, 2, /**/ 12,
+		       18,   4, 2, 2, /**/ 60,
+		      /*---------------------*/
+		       -1,  -1, 0, 0, /**/  0 };
+
+  Tableau *tab2 = new Tableau(4, 5, buffer2, NULL);
+
+  puts("\nRevised Simplex: original tableau 2:");
+  tab2->print();
+
+  try {
+    two_phase(tab2);
+  } catch (TableauException *ex) {
+    delete ex;
+  }
+
+  puts("\nRevised Simplex: solved tableau 2, using the two-phase method:");
+  tab2->print();
+
+  delete tab2;
+
+  // two-phase method, on a sparse tableau
+
+  Tableau *tab3 = new Tableau(4, 5, buffer2, NULL);
+  SparseMatrix *sparse = new SparseMatrix(tab3);
+
+  int basis[3];
+  double x[4];
+
+  try {
+    double cost = two_phase(sparse, basis, x);
+
+    printf("\nRevised Simplex: sparse tableau 2, cost %.5f, solution:", cost);
+    for (int j = 0; j < 4; j++)
+      printf(" %.5f", x[j]);
+    putchar('\n');
+  } catch (TableauException *ex) {
+    delete ex;
+  }
+
+  delete sparse;
+  delete tab3;
+}
@@ -0,0 +1,126 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef REVISED_SIMPLEX_H
+#define REVISED_SIMPLEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+#include "sparse.h"
+#include "factor.h"
+
+namespace RevisedSimplex {
+
+  //public:
+
+  /* Primal simplex, revised implementation */
+  double simplex (Tableau *tab);
+
+  /* Two-Phase Method, revised implementation */
+  double two_phase (Tableau *tab);
+
+  /* The same methods, on a sparse tableau (with the same layout):
+     the tableau is not modified, the final basis and the values
+     of the variables (n - 1 entries) are returned in basis and x */
+  double simplex   (SparseMatrix *tab, int *basis, double *x);
+  double two_phase (SparseMatrix *tab, int *basis, double *x);
+
+  /* Unit tests */
+  void test ();
+
+  /* Settings */
+  extern int refactor_frequency; // basis updates before a refactorization
+  extern int update_method;      // how the factorization is updated, see BasisFactor
+
+  //private:
+
+  /*
+     State of the revised method.
+
+     The original tableau is never modified during the iterations:
+     its constraint rows are kept in a sparse matrix, and its cost
+     row is kept apart, so that it can be replaced between
+     the two phases.
+
+     The tableau of the current iteration is T * M, where M is the
+     original tableau and T is the inverse of the basis matrix B:
+     the column of B in a row is the original column of the variable
+     in basis in that row (or a unit column, if the initial basic
+     variable of the row has not been pivoted yet). The inverse is
+     kept as a sparse LU factorization of B, updated at every pivot.
+  */
+  struct revised_state {
+    int m, n;            // rows (cost row included) and columns (variables column included)
+
+    SparseMatrix *mat;   // constraint rows (m - 1 rows)
+
+    double *cost;        // cost row (n entries)
+
+    int *basis;          // column of the basic variable of each row (m - 1 entries)
+    int *slot;           // column factorized in each row, -1 for unit columns (m entries)
+    int *is_basic;       // 1 if a column is in basis (n entries)
+
+    double *x;           // transformed variables column, x[m - 1] is minus the cost
+    int priced;          // only the columns before this one can enter the basis
+
+    BasisFactor *factor; // the current T
+
+    double *column;      // work vectors (m entries)
+    double *row;
+  };
+
+  /* Create the state from a sparse tableau, with the given basis
+     (NULL if the basis is not known yet) */
+  struct revised_state *create_state (SparseMatrix *tab, int *basis);
+
+  /* Free the state */
+  void delete_state (struct revised_state *st);
+
+  /* Load column j of the original tableau in a dense vector */
+  void load_column (struct revised_state *st, int j, double *dst);
+
+  /* Dot product between a dense row vector and column j of the original tableau */
+  double dot_column (struct revised_state *st, double *src, int j);
+
+  /* Factorize B from scratch, 0 if singular */
+  int refactorize (struct revised_state *st);
+
+  /* Select the entering column, -1 if the current solution is optimal */
+  int select_entering_column (struct revised_state *st);
+
+  /* Select the exiting row, -1 if the problem is unlimited */
+  int select_exiting_row (struct revised_state *st, double *column);
+
+  /* Pivot on the given row of an already transformed column */
+  void pivot (struct revised_state *st, int i, int j, double *column);
+
+  /* Iterate the revised method, until the optimal solution is found */
+  double iterate (struct revised_state *st);
+
+  /* Search variable already usable for the initial basis */
+  int search_usable_variables (struct revised_state *st);
+
+  /* Add the artificial columns to the rows without a variable in basis */
+  void add_artificial_columns (struct revised_state *st, int art_columns);
+
+  /* Two-phase method on the state, returns the optimal cost */
+  double solve_two_phase (struct revised_state *st);
+
+  /* Extract the final basis and the values of the original variables */
+  void get_solution (struct revised_state *st, int orig_n, int *basis, double *x);
+
+  /* Write the current tableau T * M back into tab */
+  void write_tableau (struct revised_state *st, Tableau *tab);
+
+}
+
+#endif
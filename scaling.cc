@@ -0,0 +1,243 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+
+#include "scaling.h"
+#include "simplex.h"
+#include "trace.h"
+
+/* Settings */
+int Scaling::enabled = 0;
+int Scaling::passes = 4;
+
+/* the nearest power of 2 */
+static double power_of_two (double x)
+{
+  return exp2(round(log2(x)));
+}
+
+/* the factor of a line, from the smallest and largest scaled element */
+static double geometric (double min, double max)
+{
+  return max > 0 ? 1.0 / sqrt(min * max) : 1.0;
+}
+
+/* ratio between the largest and smallest element, for the trace */
+static double spread (Tableau *tab)
+{
+  double min = HUGE_VAL, max = 0;
+
+  for (int i = 0; i < tab->m() - 1; i++)
+    for (int j = 0; j < tab->n() - 1; j++) {
+      double a = fabs(tab->at(i, j));
+      if (a == 0.0) continue;
+
+      min = fmin(min, a);
+      max = fmax(max, a);
+    }
+
+  return max > 0 ? max / min : 1.0;
+}
+
+/* Scale a tableau, return the factors */
+struct Scaling::factors *Scaling::scale (Tableau *tab)
+{
+  struct factors *f = (struct factors *) malloc(sizeof(struct factors));
+
+  f->m = tab->m() - 1;
+  f->n = tab->n() - 1;
+  f->row = (double *) malloc((f->m > 0 ? f->m : 1) * sizeof(double));
+  f->col = (double *) malloc((f->n > 0 ? f->n : 1) * sizeof(double));
+
+  for (int i = 0; i < f->m; i++) f->row[i] = 1.0;
+  for (int j = 0; j < f->n; j++) f->col[j] = 1.0;
+
+  double *min = (double *) malloc((f->n > 0 ? f->n : 1) * sizeof(double));
+  double *max = (double *) malloc((f->n > 0 ? f->n : 1) * sizeof(double));
+
+  TRACE_MESSAGE(Trace::SUMMARY, "scaling", "ratio of the largest and smallest element %g",
+		spread(tab));
+
+  for (int pass = 0; pass < passes; pass++) {
+
+    // the rows
+
+    for (int i = 0; i < f->m; i++) {
+      double *row = tab->row(i), lo = HUGE_VAL, hi = 0;
+
+      for (int j = 0; j < f->n; j++) {
+	double a = fabs(row[j]) * f->col[j];
+	if (a == 0.0) continue;
+
+	lo = fmin(lo, a);
+	hi = fmax(hi, a);
+      }
+
+      f->row[i] = geometric(lo, hi);
+    }
+
+    // the columns, by rows
+
+    for (int j = 0; j < f->n; j++) {
+      min[j] = HUGE_VAL;
+      max[j] = 0;
+    }
+
+    for (int i = 0; i < f->m; i++) {
+      double *row = tab->row(i);
+
+      for (int j = 0; j < f->n; j++) {
+	double a = fabs(row[j]) * f->row[i];
+	if (a == 0.0) continue;
+
+	min[j] = fmin(min[j], a);
+	max[j] = fmax(max[j], a);
+      }
+    }
+
+    for (int j = 0; j < f->n; j++)
+      f->col[j] = geometric(min[j], max[j]);
+  }
+
+  // equilibration: the largest element of every column is 1
+
+  for (int j = 0; j < f->n; j++)
+    max[j] = 0;
+
+  for (int i = 0; i < f->m; i++)
+    for (int j = 0; j < f->n; j++)
+      max[j] = fmax(max[j], fabs(tab->at(i, j)) * f->row[i] * f->col[j]);
+
+  for (int j = 0; j < f->n; j++) {
+    if (max[j] > 0) f->col[j] /= max[j];
+    f->col[j] = power_of_two(f->col[j]);
+  }
+
+  for (int i = 0; i < f->m; i++)
+    f->row[i] = power_of_two(f->row[i]);
+
+  // the unit columns of the basis stay unit columns
+
+  for (int i = 0; i < f->m; i++)
+    if (tab->basis_set_at(i)) f->col[tab->basis_at(i)] = 1.0 / f->row[i];
+
+  free(min);
+  free(max);
+
+  // scale (the columns by rows, with the cost row)
+
+  for (int i = 0; i < f->m; i++)
+    tab->scale_row(i, f->row[i]);
+
+  for (int i = 0; i <= f->m; i++) {
+    double *row = tab->row(i);
+
+    for (int j = 0; j < f->n; j++)
+      row[j] *= f->col[j];
+  }
+
+  for (int j = 0; j < f->n; j++) {
+    if (tab->upper_at(j) != HUGE_VAL) tab->upper_at(j, tab->upper_at(j) / f->col[j]);
+    tab->lower_at(j, tab->lower_at(j) / f->col[j]);
+  }
+
+  TRACE_MESSAGE(Trace::SUMMARY, "scaling", "ratio after the scaling %g", spread(tab));
+
+  return f;
+}
+
+/* Unscale the final tableau */
+void Scaling::unscale (Tableau *tab, struct factors *f)
+{
+  assert( tab->n() - 1 == f->n );
+
+  // T = S_B T' S^-1 (the rows deleted by the two-phase method don't matter)
+
+  for (int i = 0; i < tab->m() - 1; i++)
+    if (tab->basis_set_at(i)) tab->scale_row(i, f->col[tab->basis_at(i)]);
+
+  for (int i = 0; i < tab->m(); i++) {
+    double *row = tab->row(i);
+
+    for (int j = 0; j < f->n; j++)
+      row[j] /= f->col[j];
+  }
+
+  for (int j = 0; j < f->n; j++) {
+    if (tab->upper_at(j) != HUGE_VAL) tab->upper_at(j, tab->upper_at(j) * f->col[j]);
+    tab->lower_at(j, tab->lower_at(j) * f->col[j]);
+  }
+}
+
+/* Free the factors */
+void Scaling::delete_factors (struct factors *f)
+{
+  free(f->row);
+  free(f->col);
+  free(f);
+}
+
+/* Unit tests */
+
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  if (ev->type == Trace::ITERATION) (*(int *) arg)++;
+}
+
+void Scaling::test ()
+{
+  // the first tableau of the primal simplex, with badly scaled rows and columns
+
+  double buffer[] = { 12e6,  8e-3, 2e6, 0, /**/ 48e6,
+		       6,   -4e-9, 0,   2, /**/ 12,
+		      /*------------------------*/
+		      -1,   -1e-9, 0,   0, /**/  0 };
+
+  int indices[] = {2, 3};
+
+  for (int scaled = 0; scaled <= 1; scaled++) {
+    Tableau *tab = new Tableau(3, 5, buffer, indices);
+    tab->canonicalize();
+
+    struct factors *f = scaled ? scale(tab) : NULL;
+
+    if (f) {
+      printf("\nScaling: row factors %g %g, column factors %g %g %g %g, scaled tableau:\n",
+	     f->row[0], f->row[1], f->col[0], f->col[1], f->col[2], f->col[3]);
+      tab->print();
+    }
+
+    int iterations = 0, saved_level = Trace::level;
+
+    Trace::level = Trace::ITERATIONS;
+    Trace::set_callback(count_iterations, &iterations);
+
+    try {
+      double cost = PrimalSimplex::simplex(tab);
+      printf("\nScaling: %s: cost %g, %d iterations\n", scaled ? "scaled" : "not scaled",
+	     cost, iterations);
+    } catch (TableauException *ex) {
+      printf("\nScaling: %s: no solution\n", scaled ? "scaled" : "not scaled");
+      delete ex;
+    }
+
+    Trace::set_callback(NULL, NULL);
+    Trace::level = saved_level;
+
+    if (f) {
+      unscale(tab, f);
+      delete_factors(f);
+    }
+
+    puts("Scaling: final tableau:");
+    tab->print();
+
+    delete tab;
+  }
+}
@@ -0,0 +1,70 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef SCALING_H
+#define SCALING_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Scaling of the constraints (R) and of the variables (S) of a
+  tableau, before the solve: A' = R A S, b' = R b, c' = c S, and
+  the variables x = S x' (the bounds too). The cost doesn't
+  change: c' x' = c x.
+
+  The factors come from some passes of geometric-mean scaling
+  (every row, then every column, divided by the square root of
+  the product of its largest and smallest element), followed by
+  the equilibration of the columns (largest element 1), and are
+  rounded to powers of 2, so scaling and unscaling are exact.
+
+  The final tableau of the scaled problem is T' = S_B^-1 T S (the
+  row factors cancel), so the unscaled tableau is T = S_B T' S^-1:
+  the solution, the reduced costs and the basis of the original
+  problem, even if rows were deleted by the two-phase method.
+
+  The factor of a basis column is the inverse of the factor of
+  its row, so a tableau in canonical form stays canonical, and
+  the scaling keeps the primal and dual feasibility of the basis
+  (the factors are positive).
+*/
+
+namespace Scaling {
+
+  //public:
+
+  struct factors {
+    int m, n;     // constraints and variables
+    double *row;  // R
+    double *col;  // S
+  };
+
+  /* Settings */
+  extern int enabled; // scale the tableaux before the solve
+  extern int passes;  // of geometric-mean scaling
+
+  /* Scale a tableau, return the factors */
+  struct factors *scale (Tableau *tab);
+
+  /* Unscale the final tableau (the basis is used, if set) */
+  void unscale (Tableau *tab, struct factors *f);
+
+  /* Free the factors */
+  void delete_factors (struct factors *f);
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
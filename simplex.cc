@@ -1,73 +1,165 @@
+#include <math.h>
+
 #include "simplex.h"
+#include "kernels.h"
+#include "tolerances.h"
+#include "threads.h"
+#include "trace.h"
+#include "snapshot.h"
+#include "degeneracy.h"
+#include "dual.h"
+
+/* Settings */
+int PrimalSimplex::crash = 1;
+
+static const double crash_stability = 0.1; /* smallest pivot of the crash, relative to
+					      the largest element of its column */
 
 /* Test the optimality of the current solution */
 int PrimalSimplex::test_optimality (Tableau *tab)
 {
-  for (int j = 0; j < tab->n() - 1; j++) { /* n - 1 to exclude the last column containing
-					      the cost of the current solution */
-    
-    if (tab->at(tab->m() - 1, j) < 0) return 0; // check if the j-th reduced cost is negative
-  }
+  /* n - 1 to exclude the last column containing
+     the cost of the current solution */
+
+  if (Kernels::first_below(tab->row(tab->m() - 1), - Tolerances::dual, tab->n() - 1) != -1)
+    return 0; // a reduced cost is negative (below the dual tolerance)
 
   // if no reduced cost is negative, the current solution is optimal
   return 1;
 }
 
-/* Select the entering column
+/* Select the entering column, -1 if the current solution is optimal
 
-   Uses Bland's rule, i.e. select the negative reduced cost having
-   the smallest position (smallest subscript) in the vector
+   Uses the pricing rule of the state (see pricing.h): Bland's rule
+   selects the negative reduced cost having the smallest position
+   (smallest subscript) in the vector. The optimality is tested
+   in the same pass over the reduced costs.
 */
-int PrimalSimplex::select_entering_column (Tableau *tab)
+int PrimalSimplex::select_entering_column (Tableau *tab, struct Pricing::pricing_state *ps)
 {
-  for (int j = 0; j < tab->n() - 1; j++) { /* n - 1 to exclude the last column containing
-					      the cost of the current solution */
-
-    if (tab->at(tab->m() - 1, j) < 0) return j; // return the first negative reduced cost
-  }
-
-  assert(0); // execution should not reach here
+  return Pricing::select_entering_column(ps, tab);
 }
 
 /* Test if the chosen next solution is unlimited */
-int PrimalSimplex::test_unlimited (Tableau *tab, int entering_column)
+int PrimalSimplex::test_unlimited (Tableau *tab, int entering_column, const double *column)
 {
+  if (tab->upper_at(entering_column) != HUGE_VAL) return 0; // the variable reaches its bound
+
   for (int i = 0; i < tab->m() - 1; i++) { // m - 1 to exclude the reduced costs row
+    double a = column ? column[i] : tab->at(i, entering_column);
 
-    if (tab->at(i, entering_column) >= 0) return 0; /* check if the i-th component of
-						       the entering column is positive */
+    if (a > Tolerances::pivot) return 0; /* check if the i-th component of the entering
+					    column is positive (a pivot) */
+
+    if (a < - Tolerances::pivot && tab->upper_at(tab->basis_at(i)) != HUGE_VAL)
+      return 0; // or if the i-th variable reaches its upper bound
   }
 
-  // if no element of the entering column is positive, the problem is unlimited
+  // if no variable of the basis and not the entering one reaches a bound, the problem is unlimited
   return 1;  
 }
 
 /* Select the exiting column
 
-   Uses Bland's rule, i.e. select the smallest ratio, and,
-   when multiple variables in base give the same ratio,
-   select the one having the smallest subscript
-   (a.k.a. the one associated with the smallest column position)
+   The entering variable increases until a variable of the basis
+   reaches zero (a positive element of the column) or its upper
+   bound (a negative element), or until it reaches its own upper
+   bound: then it is flipped to the bound, without a pivot, and
+   BOUND_FLIP is returned. Only the elements of the column larger
+   than the pivot tolerance are pivots.
+
+   With the Harris ratio test (the default, see Tolerances) the
+   exiting row is chosen in two passes:
+
+     1) the largest step allowed by the rows, if every variable
+        can leave its bounds by at most the primal tolerance:
+        t = min (x[i] + tolerance) / a[i][j], for a[i][j] > 0
+	    min (u[i] - x[i] + tolerance) / - a[i][j], for a[i][j] < 0
+
+     2) among the rows with ratio not above t, the one having the
+        largest pivot (in absolute value)
+
+   so the near-tied ratios of degenerate vertices don't force tiny
+   pivots. With Bland's rule (or the textbook test) select the
+   smallest ratio, and, when multiple variables in base give the same
+   ratio (within the primal tolerance), select the one having the
+   smallest subscript (a.k.a. the one associated with the smallest
+   column position)
 */
-int PrimalSimplex::select_exiting_column (Tableau *tab, int j)
+int PrimalSimplex::select_exiting_column (Tableau *tab, int j, int bland, const double *entering)
 {
-  double min_ratio = 0;
+  /* the distances of the variables from their bounds and the
+     entering column are copied in contiguous vectors, the smallest
+     ratio is found with vector reductions, then a second pass
+     selects the row among the ones giving that ratio */
+
+  int rows = tab->m() - 1; // m - 1 to exclude the reduced costs row
+  int harris = Tolerances::harris && !bland;
+  double delta = harris ? Tolerances::primal : 0.0;
+
+  double *lower = (double *) malloc(tab->m() * sizeof(*lower));     // x[i]
+  double *upper = (double *) malloc(tab->m() * sizeof(*upper));     // u[i] - x[i]
+  double *column = (double *) malloc(tab->m() * sizeof(*column));   // a[i][j]
+  double *negated = (double *) malloc(tab->m() * sizeof(*negated)); // - a[i][j]
+
+  tab->column(tab->n() - 1, lower);
+
+  if (entering) memcpy(column, entering, tab->m() * sizeof(*column));
+  else tab->column(j, column);
+
+  int bounded = 0;
+
+  for (int i = 0; i < rows; i++) {
+    double u = tab->upper_at(tab->basis_at(i));
+
+    upper[i] = u == HUGE_VAL ? HUGE_VAL : fmax(u - lower[i], 0.0) + delta;
+    bounded |= u != HUGE_VAL;
+
+    // the bounds relaxed by the tolerance (slightly infeasible variables are at the bound)
+    if (harris) lower[i] = fmax(lower[i], 0.0) + delta;
+  }
+
+  double min_ratio = Kernels::min_ratio(lower, column, Tolerances::pivot, rows);
+
+  if (bounded) {
+    for (int i = 0; i < rows; i++) negated[i] = - column[i];
+    min_ratio = fmin(min_ratio, Kernels::min_ratio(upper, negated, Tolerances::pivot, rows));
+  }
+
   int min_ratio_position = -1;
+  double best = 0;
+
+  if (tab->upper_at(j) <= min_ratio) // the entering variable reaches its bound first
+    min_ratio_position = BOUND_FLIP;
 
-  for (int i = 0; i < tab->m() - 1; i++) { /* m - 1 to exclude the reduced costs row */
-    if (tab->at(i, j) <= 0) continue;
+  for (int i = 0; i < rows && min_ratio != HUGE_VAL && min_ratio_position != BOUND_FLIP; i++) {
+    double a = column[i], room;
 
-    double ratio = tab->at(i, tab->n() - 1) / tab->at(i, j);
+    if (a > Tolerances::pivot) room = lower[i];
+    else if (a < - Tolerances::pivot && upper[i] != HUGE_VAL) room = upper[i];
+    else continue;
 
-    if (min_ratio_position == -1 ||
-	ratio < min_ratio  ||
-	(ratio == min_ratio && tab->basis_at(i) < tab->basis_at(min_ratio_position) ) ) {
+    a = fabs(a);
 
-      min_ratio = ratio;
+    if (harris) {
+      if ((room - delta) / a <= min_ratio && a > best) {
+	min_ratio_position = i;
+	best = a;
+      }
+    }
+
+    // a tie: the variable would be at its bound, within the tolerance, after the smallest step
+    else if (room - min_ratio * a <= Tolerances::primal &&
+	     (min_ratio_position == -1 || tab->basis_at(i) < tab->basis_at(min_ratio_position))) {
       min_ratio_position = i;
     }
   }
 
+  free(lower);
+  free(upper);
+  free(column);
+  free(negated);
+
   return min_ratio_position;
 }
 
@@ -92,67 +184,140 @@ int PrimalSimplex::select_exiting_column (Tableau *tab, int j)
       Select the smallest ratio and drive the corresponding variable (in the basis)
       out of the basis. The column of the selected reduced cost enter the basis.
 
+      With upper bounds, the negative elements give the ratios of the variables
+      reaching their bounds (that leave the basis complemented), and if the
+      entering variable reaches its own bound first, it's complemented without
+      a pivot (a bound flip). Goto 2.
+
    5) Normalize the entered column (standard pivot procedure). Goto 2.
 
  */
 double PrimalSimplex::simplex (Tableau *tab)
+{
+  return iterate(tab, 1, Degeneracy::perturb);
+}
+
+double PrimalSimplex::iterate (Tableau *tab, int checkpoints, int perturb)
 {
   // step 1
   int i, j;
-  // ... nothing to do ...
+  int iteration = 0;
+  struct Pricing::pricing_state *ps = Pricing::create_state(tab);
+  struct Degeneracy::detector *dd = Degeneracy::create_detector(tab);
+  struct Degeneracy::perturbation *perturbation = NULL;
+
+  // the entering column, read once from the rows by the ratio test
+  double *column = (double *) malloc(tab->m() * sizeof(*column));
 
  step_2:
-  if (test_optimality(tab)) {
-    printf("Optimal solution found!\n");
+  j = select_entering_column(tab, ps); // also tests the optimality
+
+  if (j == -1) {
+    Pricing::delete_state(ps);
+    Degeneracy::delete_detector(dd);
+    free(column);
+
+    if (perturbation) { // the basis can be slightly infeasible, without the perturbation
+      Degeneracy::remove_perturbation(tab, perturbation);
+
+      if (!DualSimplex::test_feasibility(tab)) {
+	TRACE_MESSAGE(Trace::SUMMARY, "primal", "perturbation removed, dual simplex cleanup");
+	DualSimplex::iterate(tab, 0, 0);
+      }
+    }
 
     // extract cost from the tableau (the sign is inverted)
     double cost = - tab->at(tab->m() - 1, tab->n() - 1);
-    return cost;
-  }
 
-  else {
-    j = select_entering_column(tab);
-    printf("Selected pivot: j = %d, ", j);
+    TRACE_MESSAGE(Trace::SUMMARY, "primal", "optimal solution found, %d iterations, cost %f",
+		  iteration, cost);
+    return cost;
   }
   
+  tab->column(j, column);
+
   // step 3
-  if (test_unlimited(tab, j)) {
-    printf("The problem is unlimited!\n");
+  if (test_unlimited(tab, j, column)) {
+    TRACE_MESSAGE(Trace::SUMMARY, "primal", "the problem is unlimited (column %d)", j);
+    Pricing::delete_state(ps);
+    Degeneracy::delete_detector(dd);
+    free(column);
+    if (perturbation) Degeneracy::remove_perturbation(tab, perturbation);
     throw new UnlimitedException();
   }
   
   // step 4
-  i = select_exiting_column(tab, j);
-  printf("i = %d\n", i);
+  i = select_exiting_column(tab, j, ps->rule == Pricing::BLAND || ps->bland, column);
+
+  if (i == BOUND_FLIP) {
+    TRACE_MESSAGE(Trace::ITERATIONS, "primal", "bound flip of column %d", j);
+    tab->complement_column(j);
+    if (tab->upper_at(j) > Tolerances::primal) Degeneracy::reset(dd); // the cost decreases
+    goto step_2;
+  }
+
+  if (tab->at(i, j) < 0) // the variable leaves the basis at its upper bound
+    tab->complement_column(tab->basis_at(i));
+
+  int leaving = tab->basis_at(i);
+  int degenerate = fabs(tab->at(i, tab->n() - 1)) <= Tolerances::primal;
+
+  Pricing::update(ps, tab, i, j); // the weights use the tableau before the pivot
   tab->basis_at(i, j);
 
   // step 5
   tab->pivot(i, j);
 
-  tab->print();
+  iteration++;
+  TRACE_ITERATION("primal", iteration, i, j, - tab->at(tab->m() - 1, tab->n() - 1));
+  TRACE_TABLEAU("primal", "after the pivot", tab);
+
+  /* a stall or a cycle perturbs the right-hand sides the first time,
+     then uses Bland's rule until the next nondegenerate pivot */
+
+  switch (Degeneracy::record(dd, leaving, j, degenerate)) {
+  case Degeneracy::NONE:
+    if (!degenerate) ps->bland = 0;
+    break;
+
+  default:
+    if (perturb && !perturbation &&
+	(perturbation = Degeneracy::perturb_tableau(tab, Degeneracy::RHS))) {
+      TRACE_MESSAGE(Trace::SUMMARY, "primal", "degenerate stall at iteration %d, "
+		    "right-hand sides perturbed", iteration);
+      Degeneracy::reset(dd);
+    }
+
+    else ps->bland = 1;
+  }
+
+  // the perturbed tableau isn't saved (the last checkpoint stays valid)
+  if (checkpoints && !perturbation) Snapshot::checkpoint(tab, SIMPLEX, iteration);
 
   goto step_2;
 }
 
-/* Search variable already usable for the initial basis */
-int PrimalSimplex::search_usable_variables (Tableau *tab)
-{
-  int found_indices = 0;
+/* 
+   NOTE: this is only a small optimization, can be further refined
+   to include variable that can enter in basis using some elementary
+   row operations (respecting the constraint that the variables vector
+   must remain positive).
 
-  for (int j = 0; j < tab->n() - 1; j++) { // n - 1 to skip the variables vector
+   Here we only select columns that have a single positive element,
+   and all other elements null.
+*/
 
-    if (found_indices >= tab->m() - 1)
-      break;
+struct usable_args {
+  Tableau *tab;
+  int *elem_rows; // for every column, the row of its positive element (or -1)
+};
 
-    /* 
-       NOTE: this is only a small optimization, can be further refined
-       to include variable that can enter in basis using some elementary
-       row operations (respecting the constraint that the variables vector
-       must remain positive).
+static void find_usable_columns (int begin, int end, void *arg)
+{
+  struct usable_args *args = (struct usable_args *) arg;
+  Tableau *tab = args->tab;
 
-       Here we only select columns that have a single positive element,
-       and all other elements null.
-    */
+  for (int j = begin; j < end; j++) {
 
     int elem_row = -1;
     int positive_elements = 0;
@@ -172,7 +337,33 @@ int PrimalSimplex::search_usable_variables (Tableau *tab)
       if (positive_elements > 1) break;
     }
 
-    if (positive_elements == 1) { // can be used as a variable in basis
+    args->elem_rows[j] = positive_elements == 1 ? elem_row : -1;
+  }
+}
+
+/* Search variable already usable for the initial basis */
+int PrimalSimplex::search_usable_variables (Tableau *tab)
+{
+  int found_indices = 0;
+  int columns = tab->n() - 1; // n - 1 to skip the variables vector
+
+  struct usable_args args = { tab, (int *) malloc(columns * sizeof(int)) };
+
+  // the columns are examined in parallel, and then selected in order
+  if (Threads::worth((long) tab->m() * tab->n()))
+    Threads::parallel_for(0, columns, 64, find_usable_columns, &args);
+  else
+    find_usable_columns(0, columns, &args);
+
+  for (int j = 0; j < columns; j++) {
+
+    if (found_indices >= tab->m() - 1)
+      break;
+
+    int elem_row = args.elem_rows[j];
+
+    if (elem_row >= 0 && // can be used as a variable in basis, if within its bound
+	tab->at(elem_row, tab->n() - 1) / tab->at(elem_row, j) <= tab->upper_at(j)) {
       
       // check if in that row there are still no basis variable
       if (tab->basis_set_at(elem_row) == 0) {
@@ -187,52 +378,194 @@ int PrimalSimplex::search_usable_variables (Tableau *tab)
 
   }
 
+  free(args.elem_rows);
+
   return found_indices;
 }
 
-/* Create artificial tableau, adding the artificial columns */
-Tableau *PrimalSimplex::create_artificial_tableau (Tableau *orig_tab, int art_columns)
+/* Triangular crash of the initial basis
+
+   The rows without a basis variable are covered one at a time, with
+   a pivot on a column that has no elements in the rows already
+   covered: the basis is triangular (every pivot leaves the values
+   of the basis variables already chosen unchanged), and the fill-in
+   stays in the rows still uncovered.
+
+   The row having the fewest candidate elements is covered first (it
+   has the fewest alternatives), with the candidate having the largest
+   element relative to its column (a stable pivot, at least
+   crash_stability times the largest element of the column in the
+   uncovered rows). A candidate must keep the solution feasible: the
+   value of the variable, b[r] / a[r][j], within its bounds. A row
+   without candidates keeps its artificial variable.
+
+   The rows still uncovered are made positive again, for the
+   artificial variables.
+*/
+int PrimalSimplex::crash_basis (Tableau *tab)
 {
-  
-  // fill the artificial tableau
+  int rows = tab->m() - 1, columns = tab->n() - 1; // skip the reduced costs row and the variables
+  int found = 0;
 
-  Tableau *art_tab = new Tableau(orig_tab->m(),
-				 orig_tab->n() + art_columns,
-				 NULL, NULL);
+  int *blocked = (int *) calloc(columns > 0 ? columns : 1, sizeof(int)); // elements in covered rows
+  int *count = (int *) calloc(rows > 0 ? rows : 1, sizeof(int));        // candidates of the rows
+  double *largest = (double *) calloc(columns > 0 ? columns : 1, sizeof(double)); // of the columns
 
-  for (int i = 0; i < orig_tab->m() - 1; i++) // fill the basis indices
-    if (orig_tab->basis_set_at(i)) art_tab->basis_at(i, orig_tab->basis_at(i));
+  for (int i = 0; i < rows; i++) {
+    if (!tab->basis_set_at(i)) continue;
 
-                                                 // fill the matrix:
-  for (int i = 0; i < orig_tab->m() - 1; i++)    // m - 1 to skip the reduced costs row
-    for (int j = 0; j < orig_tab->n() - 1; j++)  // n - 1 to skip the artificial columns
-      art_tab->at(i, j, orig_tab->at(i, j));
-  
-  for (int i = 0; i < orig_tab->m() - 1; i++) {        // m - 1 to skip the reduced costs row
-    for (int j = orig_tab->n() - 1;
-	 j < (orig_tab->n() - 1) + art_columns;        // only the artificial columns
-	 j++) {
-      
-      if (art_tab->basis_set_at(i) == 0 && j - (orig_tab->n() - 1) == i) {
-	
-	art_tab->at(i, j, 1);
-	art_tab->basis_at(i, j);
-	
+    double *row = tab->row(i);
+    for (int j = 0; j < columns; j++)
+      if (row[j] != 0) blocked[j] = 1;
+  }
+
+  /* the candidates and the largest elements of the uncovered rows are
+     computed once: a pivot changes only the columns of the pivot row,
+     that become blocked (and covering a row can only make the largest
+     elements smaller, so the stability test stays conservative) */
+
+  for (int i = 0; i < rows; i++) {
+    if (tab->basis_set_at(i)) continue;
+
+    double *row = tab->row(i);
+    for (int j = 0; j < columns; j++) {
+      if (blocked[j]) continue;
+
+      largest[j] = fmax(largest[j], fabs(row[j]));
+      if (fabs(row[j]) > Tolerances::pivot) count[i]++;
+    }
+  }
+
+  for (;;) {
+
+    // the uncovered row with the fewest candidates (rows without candidates have count 0)
+
+    int best_row = -1;
+
+    for (int i = 0; i < rows; i++)
+      if (!tab->basis_set_at(i) && count[i] > 0 && (best_row == -1 || count[i] < count[best_row]))
+	best_row = i;
+
+    if (best_row == -1) break;
+
+    // its most stable feasible candidate
+
+    double *row = tab->row(best_row);
+    double b = row[columns];
+    int best_col = -1;
+    double best_score = 0;
+
+    for (int j = 0; j < columns; j++) {
+      double a = row[j];
+
+      if (blocked[j] || fabs(a) <= Tolerances::pivot) continue;
+      if (b / a < 0 && b != 0) continue;      // negative value
+      if (b / a > tab->upper_at(j)) continue; // beyond its bound
+
+      double score = fabs(a) / largest[j];
+
+      if (score >= crash_stability && score > best_score) {
+	best_col = j;
+	best_score = score;
       }
     }
+
+    if (best_col == -1) { // the row keeps its artificial variable
+      count[best_row] = 0;
+      continue;
+    }
+
+    // the covered row blocks its columns (before the pivot, that changes only these columns)
+
+    for (int j = 0; j < columns; j++) {
+      if (blocked[j] || row[j] == 0) continue;
+
+      blocked[j] = 1;
+
+      for (int i = 0; i < rows; i++)
+	if (count[i] > 0 && fabs(tab->at(i, j)) > Tolerances::pivot) count[i]--;
+    }
+
+    tab->basis_at(best_row, best_col);
+    tab->pivot(best_row, best_col);
+    found++;
   }
-  
-  for (int j = orig_tab->n() - 1;    // set the cost function for artificial variables
-       j < (orig_tab->n() - 1) + art_columns;
-       j++)
-    art_tab->at(orig_tab->m() - 1, j, 1);
-  
-                                               // set the values of the variables column 
-  for (int i = 0; i < orig_tab->m() - 1; i++)  // m - 1 to skip the reduced costs row
-    art_tab->at(i, (orig_tab->n() - 1) + art_columns,
-		orig_tab->at(i, orig_tab->n() - 1));
 
-  return art_tab;
+  for (int i = 0; i < rows; i++) // the rows of the artificial variables
+    if (!tab->basis_set_at(i) && tab->at(i, columns) < 0) tab->scale_row(i, -1.0);
+
+  free(blocked);
+  free(count);
+  free(largest);
+
+  return found;
+}
+
+/* Add the artificial columns to a tableau, with the cost function of Phase I */
+void PrimalSimplex::add_artificial_columns (Tableau *tab, int art_columns)
+{
+  int j = tab->n() - 1; // the first artificial column
+
+  tab->insert_columns(j, art_columns); // before the variables column
+
+  for (int i = 0; i < tab->m() - 1; i++) { // m - 1 to skip the reduced costs row
+    if (tab->basis_set_at(i) == 0) {       // an artificial column for every
+      tab->at(i, j, 1);                    // row without a basis variable
+      tab->basis_at(i, j++);
+    }
+  }
+
+  double *costs = tab->row(tab->m() - 1); // the sum of the artificial variables
+
+  memset(costs, 0, tab->n() * sizeof(*costs));
+
+  for (j = tab->n() - 1 - art_columns; j < tab->n() - 1; j++)
+    costs[j] = 1;
+}
+
+static void make_variables_positive (int begin, int end, void *arg)
+{
+  Tableau *tab = (Tableau *) arg;
+
+  for (int i = begin; i < end; i++)
+    // all the variables must be positive
+    if (tab->at(i, tab->n() - 1) < 0) tab->scale_row(i, -1.0);
+}
+
+/* the state of Phase I needed by Phase II */
+struct phase_I {
+  double *costs;     // the cost row of the original problem
+  int *complemented; // the complemented columns, when it was saved
+  int *redundant;    // the rows to delete at the end of Phase I
+};
+
+/* Remove the artificial columns and the redundant rows (in a single
+   pass), and restore the costs of the original problem */
+static void end_phase_I (Tableau *tab, int columns, struct phase_I *saved)
+{
+  int *artificial = (int *) calloc(tab->n() - 1, sizeof(int));
+
+  for (int j = columns; j < tab->n() - 1; j++)
+    artificial[j] = 1;
+
+  tab->delete_rows(saved->redundant);
+  tab->delete_columns(artificial);
+
+  free(artificial);
+
+  double *costs = saved->costs;
+
+  for (int j = 0; j < columns; j++) // the columns complemented by Phase I
+    if (tab->complemented_at(j) != saved->complemented[j]) {
+      costs[columns] -= costs[j] * tab->upper_at(j);
+      costs[j] = - costs[j];
+    }
+
+  memcpy(tab->row(tab->m() - 1), costs, tab->n() * sizeof(double));
+
+  free(saved->costs);
+  free(saved->complemented);
+  free(saved->redundant);
 }
 
 /* 
@@ -243,7 +576,8 @@ Tableau *PrimalSimplex::create_artificial_tableau (Tableau *orig_tab, int art_co
    1) By multiplying some of the rows by -1, change the problem
       so that b >= 0
 
-   2) Introduce artificial variables (if necessary), canonicalize the artificial tableau,
+   2) Introduce artificial variables (if necessary: the basis takes the unit columns,
+      and then a triangular crash basis, see crash_basis), canonicalize the artificial tableau,
       and apply the simplex method to the auxiliary problem, with the sum of
       the artificial variables as cost function.
 
@@ -283,57 +617,83 @@ double PrimalSimplex::two_phase (Tableau *tab)
 
   // step 1
 
-  for (int i = 0; i < tab->m() - 1; i++) // m - 1 to skip the reduced costs row
-    // all the variables must be positive
-    if (tab->at(i, tab->n() - 1) < 0) tab->scale_row(i, -1.0);
+  if (Threads::worth((long) tab->m() * tab->n()))
+    Threads::parallel_for(0, tab->m() - 1, Threads::block_rows(tab->n()),
+			  make_variables_positive, tab);
+  else
+    make_variables_positive(0, tab->m() - 1, tab); // m - 1 to skip the reduced costs row
 
-  puts("\nafter step 1:");
-  tab->print();
+  TRACE_TABLEAU("two-phase", "after step 1", tab);
 
   // step 2
 
   // search variable already usable for the initial basis
   int found_indices = search_usable_variables(tab);
 
-  puts("\nafter step 2 (already available variables):");
-  tab->print();
+  TRACE_TABLEAU("two-phase", "after step 2 (already available variables)", tab);
+
+  if (crash && found_indices < tab->m() - 1) { // a triangular basis for the other rows
+    int crashed = crash_basis(tab);
+
+    TRACE_MESSAGE(Trace::SUMMARY, "two-phase", "%d variables of the crash basis", crashed);
+    TRACE_TABLEAU("two-phase", "after the crash", tab);
+
+    found_indices += crashed;
+  }
 
   /* at this point some valid variables in base should have been selected:
      we introduce artificial variables only for the rows that still doesn't
      have a variable in basis (a pivot) */
     
   int art_columns = (tab->m() - 1) - found_indices;
+  int columns = tab->n() - 1; // the original variables, before the artificial ones
+
+  /* Phase I runs on the tableau itself, with the artificial columns
+     inserted before the variables column: only the cost row of the
+     original problem is saved, with the complemented columns (the
+     variables at their upper bounds at the end of Phase I) */
 
-  Tableau *art_tab = create_artificial_tableau(tab, art_columns);
+  struct phase_I saved;
 
-  puts("\nthe artificial tableau:");
-  art_tab->print();
+  saved.costs = (double *) malloc(tab->n() * sizeof(double));
+  saved.complemented = (int *) malloc((columns > 0 ? columns : 1) * sizeof(int));
+  saved.redundant = (int *) calloc(tab->m() - 1, sizeof(int));
 
-  art_tab->canonicalize();
+  memcpy(saved.costs, tab->row(tab->m() - 1), tab->n() * sizeof(double));
 
-  puts("\ncanonicalized artificial tableau:");
-  art_tab->print();
-  putchar('\n');
+  for (int j = 0; j < columns; j++)
+    saved.complemented[j] = tab->complemented_at(j);
 
-  double cost = simplex(art_tab);
+  add_artificial_columns(tab, art_columns);
 
-  puts("\nsolution to the artificial problem:");
-  art_tab->print();
+  TRACE_MESSAGE(Trace::SUMMARY, "two-phase", "%d variables usable for the initial basis, "
+		"%d artificial columns", found_indices, art_columns);
+  TRACE_TABLEAU("two-phase", "the artificial tableau", tab);
+
+  tab->canonicalize();
+
+  TRACE_TABLEAU("two-phase", "canonicalized artificial tableau", tab);
+
+  double cost = iterate(tab, 0, Degeneracy::perturb); // the artificial tableau can't be resumed alone
+
+  TRACE_MESSAGE(Trace::SUMMARY, "two-phase", "phase I cost %f", cost);
+  TRACE_TABLEAU("two-phase", "solution to the artificial problem", tab);
   
   // step 3
 
  step_3:
   
-  if (cost > 0.0) { // case 3.1
-    puts("The problem is impossible!");
+  if (cost > Tolerances::primal) { // case 3.1
+    TRACE_MESSAGE(Trace::SUMMARY, "two-phase", "the problem is impossible");
+    end_phase_I(tab, columns, &saved);
     throw new ImpossibleException();
   }
 
   else {
     int art_var_row = -1;
   
-    for (int i = 0; i < art_tab->m() - 1; i++) { // m - 1 to skip the reduced costs row
-      if (art_tab->basis_at(i) >= tab->n()) { // search artificial variables in basis
+    for (int i = 0; i < tab->m() - 1; i++) { // m - 1 to skip the reduced costs row
+      if (!saved.redundant[i] && tab->basis_at(i) >= columns) { // search artificial variables in basis
 	art_var_row = i;
 	break;
       }
@@ -348,8 +708,8 @@ double PrimalSimplex::two_phase (Tableau *tab)
     int null_row = 1;
     int not_null_elem_column;
 
-    for (int j = 0; j < tab->n() - 1; j++) { // only original variable columns
-      if (art_tab->at(art_var_row, j) != 0) { // we need a positive "not-artificial" element
+    for (int j = 0; j < columns; j++) { // only original variable columns
+      if (fabs(tab->at(art_var_row, j)) > Tolerances::pivot) { // we need a "not-artificial" pivot
 	null_row = 0;
 	not_null_elem_column = j;
 	break;
@@ -357,12 +717,11 @@ double PrimalSimplex::two_phase (Tableau *tab)
     }
 
     if (null_row) { // case 3.3.1
-      art_tab->delete_row(art_var_row);
-      tab->delete_row(art_var_row);
+      saved.redundant[art_var_row] = 1; // deleted at the end of Phase I
     }
 
     else { // case 3.3.2
-      art_tab->pivot(art_var_row, not_null_elem_column);
+      tab->pivot(art_var_row, not_null_elem_column);
     }
 
     goto step_3;
@@ -375,36 +734,29 @@ double PrimalSimplex::two_phase (Tableau *tab)
 
   // step 1
 
-  puts("\ntableau, after phase I:");
-  art_tab->print();
-
-  /* use the obtained tableau, without the artificial columns,
-     in the original problem */
+  TRACE_TABLEAU("two-phase", "tableau, after phase I", tab);
 
-  // copy the relevant rows into the original tableau
-  for (int i = 0; i < tab->m() - 1; i++)
-    for (int j = 0; j < tab->n(); j++)
-      tab->at(i, j, art_tab->at(i, j));
+  /* use the obtained tableau, without the artificial columns and
+     the redundant rows, with the costs of the original problem */
 
-  // set the found variables in basis
-  for (int i = 0; i < tab->m() - 1; i++)
-    tab->basis_at(i, art_tab->basis_at(i));
-
-  delete art_tab;
+  end_phase_I(tab, columns, &saved);
 
   // step 2
 
   tab->canonicalize();
 
-  puts("\nresulting tableau, canonicalized with the just found basis:");
-  tab->print();
-  putchar('\n');
+  TRACE_TABLEAU("two-phase", "resulting tableau, canonicalized with the just found basis", tab);
 
   // step 3
 
   return simplex(tab);
 }
 
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  if (ev->type == Trace::ITERATION) (*(int *) arg)++;
+}
+
 /* Unit tests */
 void PrimalSimplex::test()
 {
@@ -485,4 +837,197 @@ void PrimalSimplex::test()
   tab3->print();
 
   delete tab3;
+
+  // parallel pivots (the tableau is too small to need them)
+
+  int saved_count = Threads::count;
+  long saved_threshold = Threads::threshold;
+
+  Threads::count = 4;
+  Threads::threshold = 0;
+
+  Tableau *tab4 = new Tableau(3, 5, buffer, indices);
+
+  tab4->canonicalize();
+
+  try {
+    simplex(tab4);
+  } catch (TableauException *ex) {
+    delete ex;
+  }
+
+  puts("\nPrimal Simplex: tableau 1 solved again, with 4 threads:");
+  tab4->print();
+
+  delete tab4;
+
+  Threads::count = saved_count;
+  Threads::threshold = saved_threshold;
+
+  // pricing rules
+
+  int saved_rule = Pricing::rule;
+
+  for (Pricing::rule = Pricing::BLAND; Pricing::rule <= Pricing::STEEPEST_EDGE; Pricing::rule++) {
+    Tableau *tab5 = new Tableau(3, 5, buffer, indices);
+
+    tab5->canonicalize();
+    printf("\nPrimal Simplex: tableau 1, %s pricing:\n", Pricing::rule_name(Pricing::rule));
+
+    double cost = simplex(tab5);
+    printf("cost: %lf\n", cost);
+
+    delete tab5;
+  }
+
+  Pricing::rule = saved_rule;
+
+  // partial pricing, with sections of one column
+
+  int saved_width = Pricing::partial_width;
+  int saved_sections = Pricing::sections;
+
+  Pricing::partial_width = 1;
+  Pricing::sections = 4;
+
+  Tableau *tab6 = new Tableau(3, 5, buffer, indices);
+
+  tab6->canonicalize();
+  puts("\nPrimal Simplex: tableau 1, partial pricing:");
+
+  double cost = simplex(tab6);
+  printf("cost: %lf\n", cost);
+
+  delete tab6;
+
+  Pricing::partial_width = saved_width;
+  Pricing::sections = saved_sections;
+
+  // trace callback, counting the iterations
+
+  int saved_level = Trace::level;
+  int iterations = 0;
+
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &iterations);
+
+  Tableau *tab7 = new Tableau(3, 5, buffer, indices);
+
+  tab7->canonicalize();
+  simplex(tab7);
+
+  printf("\nPrimal Simplex: tableau 1, iterations seen by the trace callback: %d\n", iterations);
+
+  delete tab7;
+
+  Trace::set_callback(NULL, NULL);
+  Trace::level = saved_level;
+
+  /* near-tied ratios: the textbook test takes the tiny pivot of the
+     first row (ratio 0), Harris' test the pivot 1 of the second row
+     (ratio 1e-10, within the primal tolerance) */
+
+  double buffer8[] = { 1e-6, 1, 0, /**/ 0,
+		       1,    0, 1, /**/ 1e-10,
+		      /*-------------------*/
+		      -1,    0, 0, /**/ 0 };
+
+  int indices8[] = {1, 2};
+
+  Tableau *tab8 = new Tableau(3, 4, buffer8, indices8);
+  int saved_harris = Tolerances::harris;
+
+  Tolerances::harris = 0;
+  int textbook = select_exiting_column(tab8, 0, 0, NULL);
+
+  Tolerances::harris = 1;
+  int harris = select_exiting_column(tab8, 0, 0, NULL);
+
+  Tolerances::harris = saved_harris;
+
+  printf("\nPrimal Simplex: near-tied ratios, exiting row %d (textbook), %d (Harris)\n",
+	 textbook, harris);
+
+  delete tab8;
+
+  /* upper bounds x0 <= 2, x1 <= 2, x2 <= 1: in the tableau,
+     and as constraints, with their slack variables */
+
+  double buffer9[] = {  1,  1,  1, 1, 0, /**/ 4,
+			1, -1,  0, 0, 1, /**/ 1,
+		       /*-----------------------*/
+		       -2, -1, -1, 0, 0, /**/ 0 };
+
+  double buffer10[] = {  1,  1,  1, 1, 0, 0, 0, 0, /**/ 4,
+			 1, -1,  0, 0, 1, 0, 0, 0, /**/ 1,
+			 1,  0,  0, 0, 0, 1, 0, 0, /**/ 2,
+			 0,  1,  0, 0, 0, 0, 1, 0, /**/ 2,
+			 0,  0,  1, 0, 0, 0, 0, 1, /**/ 1,
+			/*--------------------------------*/
+			-2, -1, -1, 0, 0, 0, 0, 0, /**/ 0 };
+
+  int indices9[] = {3, 4};
+  int indices10[] = {3, 4, 5, 6, 7};
+
+  Tableau *tab9 = new Tableau(3, 6, buffer9, indices9);
+  Tableau *tab10 = new Tableau(6, 9, buffer10, indices10);
+
+  tab9->upper_at(0, 2);
+  tab9->upper_at(1, 2);
+  tab9->upper_at(2, 1);
+
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &iterations);
+
+  iterations = 0;
+  double bounded = simplex(tab9);
+  int bounded_iterations = iterations;
+
+  iterations = 0;
+  double rows = simplex(tab10);
+
+  Trace::set_callback(NULL, NULL);
+  Trace::level = saved_level;
+
+  printf("\nPrimal Simplex: bounds in the tableau (3 x 6): cost %g, %d pivots, "
+	 "x = %g %g %g\n", bounded, bounded_iterations,
+	 tab9->value_at(0), tab9->value_at(1), tab9->value_at(2));
+  printf("Primal Simplex: bounds as constraints (6 x 9): cost %g, %d pivots\n",
+	 rows, iterations);
+
+  puts("Primal Simplex: final tableau, with bounds:");
+  tab9->print();
+
+  delete tab9;
+  delete tab10;
+
+  /* equalities without unit columns: the crash basis covers two
+     rows, the artificial variable of the third is the only one left */
+
+  double buffer11[] = { 2, 1, 1, 0, /**/ 4,
+			1, 0, 1, 1, /**/ 3,
+			0, 1, 0, 2, /**/ 2,
+		       /*-----------------*/
+			1, 2, 3, 1, /**/ 0 };
+
+  int saved_crash = crash;
+
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &iterations);
+
+  for (crash = 1; crash >= 0; crash--) {
+    Tableau *tab11 = new Tableau(4, 5, buffer11, NULL);
+
+    iterations = 0;
+    double cost = two_phase(tab11);
+
+    printf("\nPrimal Simplex: crash, %s: cost %g, %d iterations\n",
+	   crash ? "crash basis" : "artificial variables", cost, iterations);
+
+    delete tab11;
+  }
+
+  Trace::set_callback(NULL, NULL);
+  Trace::level = saved_level;
+  crash = saved_crash;
 }
@@ -15,39 +15,62 @@
 #include <assert.h>
 
 #include "tableau.h"
+#include "pricing.h"
 
 namespace PrimalSimplex {
 
   //public:
 
+  enum {
+    BOUND_FLIP = -2 // the entering variable reaches its upper bound (no pivot)
+  };
+
   /* Primal simplex, full-tableau implementation */
   double simplex (Tableau *tab);
 
   /* Two-Phase Method */
   double two_phase (Tableau *tab);
 
+  /* Settings */
+  extern int crash; // crash the initial basis of the two-phase method (triangular)
+
   /* Unit tests */
   void test ();
 
   //private:
 
+  /* Iterations of the primal simplex, writing the checkpoints
+     of the tableau if requested (see Snapshot), and perturbing
+     the right-hand sides on a stall if requested (see Degeneracy) */
+  double iterate (Tableau *tab, int checkpoints, int perturb);
+
   /* Test the optimality of the current solution */
   int test_optimality (Tableau *tab);
 
-  /* Select the entering column */
-  int select_entering_column (Tableau *tab);
+  /* Select the entering column, with the given pricing state,
+     -1 if the current solution is optimal */
+  int select_entering_column (Tableau *tab, struct Pricing::pricing_state *ps);
 
-  /* Test if the chosen next solution is unlimited */
-  int test_unlimited (Tableau *tab, int entering_column);
+  /* Test if the chosen next solution is unlimited (the entering
+     column can be given as a contiguous copy, or NULL) */
+  int test_unlimited (Tableau *tab, int entering_column, const double *column);
 
-  /* Select the exiting column */
-  int select_exiting_column (Tableau *tab, int j);
+  /* Select the exiting column, with Bland's rule if requested
+     (otherwise with the Harris ratio test, if enabled), or
+     BOUND_FLIP (the column j can be given as a contiguous copy,
+     or NULL to read it from the rows) */
+  int select_exiting_column (Tableau *tab, int j, int bland, const double *entering);
 
   /* Search variable already usable for the initial basis */
   int search_usable_variables (Tableau *tab);
 
-  /* Create artificial tableau, adding the artificial columns */
-  Tableau *create_artificial_tableau (Tableau *orig_tab, int art_columns);
+  /* Complete the initial basis with a triangular crash, return the
+     number of variables added */
+  int crash_basis (Tableau *tab);
+
+  /* Add the artificial columns to a tableau (before the variables
+     column), with the cost function of Phase I */
+  void add_artificial_columns (Tableau *tab, int art_columns);
 
 }
 
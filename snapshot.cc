@@ -0,0 +1,296 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+#include "simplex.h"
+#include "trace.h"
+
+extern char *pname;
+
+/* Settings */
+const char *Snapshot::checkpoint_file = NULL;
+long Snapshot::frequency = 1000;
+
+#define MAGIC      "SPXSNAP"
+#define VERSION    2 // 2: lower bounds (version 1 is still read)
+#define BYTE_ORDER_MARK 0x01020304
+
+struct header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  int32_t method;
+  int32_t m, n;
+  int32_t reserved;
+  int64_t iteration;
+  uint64_t size;  // of the whole file, to detect truncated files
+  char padding[16];
+};
+
+static_assert(sizeof(struct header) == 64, "the elements must be aligned");
+
+/* size of the file of a m x n tableau */
+static inline uint64_t file_size (int m, int n, int version)
+{
+  return sizeof(struct header) +
+    (uint64_t) m * n * sizeof(double) +
+    (uint64_t) (version >= 2 ? 2 : 1) * (n - 1) * sizeof(double) +
+    (uint64_t) 2 * (m - 1) * sizeof(int32_t) +
+    (uint64_t) (n - 1) * sizeof(int32_t);
+}
+
+static int write_all (int fd, const void *data, size_t size)
+{
+  const char *p = (const char *) data;
+
+  while (size > 0) {
+    ssize_t w = write(fd, p, size);
+    if (w <= 0) return 0;
+
+    p += w;
+    size -= w;
+  }
+
+  return 1;
+}
+
+/* Save a tableau, 0 on errors */
+int Snapshot::save (const char *filename, Tableau *tab, int method, long iteration)
+{
+  int m = tab->m(), n = tab->n();
+
+  struct header h;
+  memset(&h, 0, sizeof(h));
+
+  memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.byte_order = BYTE_ORDER_MARK;
+  h.method = method;
+  h.m = m;
+  h.n = n;
+  h.iteration = iteration;
+  h.size = file_size(m, n, VERSION);
+
+  // the small arrays are gathered, the elements are written directly
+
+  double *upper = (double *) malloc(2 * (n - 1) * sizeof(double)); // and the lower bounds
+  int32_t *flags = (int32_t *) malloc((2 * (m - 1) + (n - 1)) * sizeof(int32_t));
+
+  for (int j = 0; j < n - 1; j++) {
+    upper[j] = tab->upper_at(j);
+    upper[n - 1 + j] = tab->lower_at(j);
+    flags[2 * (m - 1) + j] = tab->complemented_at(j);
+  }
+
+  for (int i = 0; i < m - 1; i++) {
+    flags[i] = tab->basis_at(i);
+    flags[m - 1 + i] = tab->basis_set_at(i);
+  }
+
+  char *temporary = (char *) malloc(strlen(filename) + 5);
+  sprintf(temporary, "%s.tmp", filename);
+
+  int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  int ok = fd != -1;
+
+  ok = ok && write_all(fd, &h, sizeof(h));
+  for (int i = 0; i < m; i++) // without the padding of the rows
+    ok = ok && write_all(fd, tab->row(i), n * sizeof(double));
+  ok = ok && write_all(fd, upper, 2 * (n - 1) * sizeof(double));
+  ok = ok && write_all(fd, flags, (2 * (m - 1) + (n - 1)) * sizeof(int32_t));
+  ok = ok && fsync(fd) == 0;
+
+  if (fd != -1) close(fd);
+
+  ok = ok && rename(temporary, filename) == 0; // replace the previous snapshot
+
+  if (!ok) {
+    fprintf(stderr, "%s: can't write the snapshot: %s\n", pname, filename);
+    unlink(temporary);
+  } else {
+    TRACE_MESSAGE(Trace::ITERATIONS, "snapshot", "snapshot written at iteration %ld: %s",
+		  iteration, filename);
+  }
+
+  free(temporary);
+  free(upper);
+  free(flags);
+
+  return ok;
+}
+
+/* Check the content of a mapped snapshot, return an error message or NULL */
+static const char *validate (const char *data, size_t size)
+{
+  const struct header *h = (const struct header *) data;
+
+  if (size < sizeof(struct header) || memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0)
+    return "not a snapshot";
+
+  if (h->version < 1 || h->version > VERSION || h->byte_order != BYTE_ORDER_MARK)
+    return "unsupported version or byte order";
+
+  if (h->m < 2 || h->n < 2 || h->size != file_size(h->m, h->n, h->version) || h->size != size)
+    return "invalid size";
+
+  int m = h->m, n = h->n, bounds = h->version >= 2 ? 2 : 1;
+
+  const double *upper = (const double *) (data + sizeof(struct header)) + (size_t) m * n;
+  const int32_t *flags = (const int32_t *) (upper + bounds * (n - 1));
+
+  for (int i = 0; i < m - 1; i++)
+    if (flags[m - 1 + i] && (flags[i] < 0 || flags[i] >= n - 1))
+      return "invalid basis";
+
+  for (int j = 0; j < n - 1; j++)
+    if (!(upper[j] >= 0))
+      return "invalid upper bound";
+
+  for (int j = 0; bounds == 2 && j < n - 1; j++)
+    if (!(fabs(upper[n - 1 + j]) < HUGE_VAL))
+      return "invalid lower bound";
+
+  return NULL;
+}
+
+/* Load a snapshot, NULL if the file is not valid */
+struct Snapshot::snapshot *Snapshot::load (const char *filename)
+{
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+
+  if (fd == -1 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "%s: can't open the snapshot: %s\n", pname, filename);
+    if (fd != -1) close(fd);
+    return NULL;
+  }
+
+  size_t size = st.st_size;
+  void *mapping = size ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+
+  close(fd);
+
+  const char *error = mapping == MAP_FAILED ? "can't map the file" : validate((const char *) mapping, size);
+
+  if (error) {
+    fprintf(stderr, "%s: invalid snapshot: %s, %s\n", pname, filename, error);
+    if (mapping != MAP_FAILED) munmap(mapping, size);
+    return NULL;
+  }
+
+  const struct header *h = (const struct header *) mapping;
+  int m = h->m, n = h->n, bounds = h->version >= 2 ? 2 : 1;
+
+  double *elements = (double *) ((char *) mapping + sizeof(struct header));
+  double *upper = elements + (size_t) m * n;
+  int32_t *flags = (int32_t *) (upper + bounds * (n - 1));
+
+  Tableau *tab = new Tableau(m, n, elements, NULL, 1); // no copy of the elements
+
+  for (int i = 0; i < m - 1; i++)
+    if (flags[m - 1 + i]) tab->basis_at(i, flags[i]);
+
+  for (int j = 0; j < n - 1; j++) {
+    tab->upper_at(j, upper[j]);
+    tab->complemented_at(j, flags[2 * (m - 1) + j]);
+    if (bounds == 2) tab->lower_at(j, upper[n - 1 + j]);
+  }
+
+  struct snapshot *snap = (struct snapshot *) malloc(sizeof(struct snapshot));
+
+  snap->tableau = tab;
+  snap->method = h->method;
+  snap->iteration = h->iteration;
+  snap->mapping = mapping;
+  snap->size = size;
+
+  TRACE_MESSAGE(Trace::SUMMARY, "snapshot", "%d x %d tableau loaded, taken at iteration %ld",
+		m, n, snap->iteration);
+
+  return snap;
+}
+
+/* Free a snapshot (and its tableau) */
+void Snapshot::release (struct snapshot *snap)
+{
+  delete snap->tableau; // before the mapping of its elements
+
+  munmap(snap->mapping, snap->size);
+  free(snap);
+}
+
+/* Unit tests */
+void Snapshot::test ()
+{
+  double buffer[] = { 12,   8, 2, 0, /**/ 48,
+		       6,  -4, 0, 2, /**/ 12,
+		      /*--------------------*/
+		      -1,  -1, 0, 0, /**/  0 };
+
+  int indices[] = {2, 3};
+
+  Tableau *tab = new Tableau(3, 5, buffer, indices);
+  tab->canonicalize();
+  tab->upper_at(0, 3.0);
+
+  char filename[] = "/tmp/simplex_snapshot_XXXXXX";
+  int fd = mkstemp(filename);
+
+  if (fd == -1) return;
+  close(fd);
+
+  // save and load
+
+  save(filename, tab, SIMPLEX, 0);
+
+  struct snapshot *snap = load(filename);
+
+  if (snap) {
+    puts("\nSnapshot: loaded tableau:");
+    snap->tableau->print();
+    release(snap);
+  }
+
+  // checkpoints at every iteration, resumed with the saved method
+
+  const char *saved_file = checkpoint_file;
+  long saved_frequency = frequency;
+
+  checkpoint_file = filename;
+  frequency = 1;
+
+  Tableau *copy = tab->clone();
+  double cost = PrimalSimplex::simplex(copy);
+
+  checkpoint_file = saved_file;
+  frequency = saved_frequency;
+
+  snap = load(filename);
+
+  if (snap) {
+    double resumed = PrimalSimplex::simplex(snap->tableau);
+
+    printf("\nSnapshot: checkpoint at iteration %ld, cost %f, resumed cost %f\n",
+	   snap->iteration, cost, resumed);
+
+    release(snap);
+  }
+
+  unlink(filename);
+
+  delete copy;
+  delete tab;
+}
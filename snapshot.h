@@ -0,0 +1,90 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+#include "parser.h"
+
+/*
+  Binary snapshots of a tableau (checkpoints of the solvers).
+
+  A snapshot holds the elements of the tableau, its basis, the
+  bounds of the variables, the method to solve it with and
+  the iteration it was taken at. The file is the memory image of
+  the tableau:
+
+    header (64 bytes)
+    elements          m * n doubles, row by row
+    upper bounds      n - 1 doubles
+    lower bounds      n - 1 doubles (from version 2)
+    basis             m - 1 ints
+    basis set flags   m - 1 ints
+    complemented      n - 1 ints
+
+  It is loaded mapping the file in memory (privately): the tableau
+  uses the mapped elements without copying them, and the pages are
+  copied only when the solver writes them.
+
+  The primal and dual simplex methods write a checkpoint every
+  frequency iterations, if a checkpoint file is set: the tableau
+  of every iteration is canonical and feasible (primal or dual),
+  so the solve is resumed calling the same method on the snapshot.
+  The checkpoints of the two-phase method are taken in phase II
+  (the phase I tableau can't be resumed alone).
+
+  Snapshots are written to a temporary file and then renamed, so
+  a crash while writing leaves the previous checkpoint intact.
+  The format is native (byte order and sizes are checked on load).
+*/
+
+namespace Snapshot {
+
+  //public:
+
+  /* Settings */
+  extern const char *checkpoint_file; // where the checkpoints are written (NULL: disabled)
+  extern long frequency;              // iterations between two checkpoints
+
+  /* A loaded snapshot */
+  struct snapshot {
+    Tableau *tableau; // uses the mapped elements
+    int method;       // see solver_method
+    long iteration;
+
+    void *mapping;
+    size_t size;
+  };
+
+  /* Save a tableau, 0 on errors */
+  int save (const char *filename, Tableau *tab, int method, long iteration);
+
+  /* Load a snapshot, NULL if the file is not valid (the error is printed) */
+  struct snapshot *load (const char *filename);
+
+  /* Free a snapshot (and its tableau) */
+  void release (struct snapshot *snap);
+
+  /* Write a checkpoint, if the checkpoints are enabled and it's time to */
+  inline void checkpoint (Tableau *tab, int method, long iteration) {
+    if (checkpoint_file && frequency > 0 && iteration % frequency == 0)
+      save(checkpoint_file, tab, method, iteration);
+  }
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
@@ -0,0 +1,481 @@
+#include "sparse.h"
+
+SparseMatrix::SparseMatrix (int m, int n)
+  : _m(m), _n(n), _nnz(0), columns_valid(0), c_start(NULL), c_index(NULL), c_value(NULL)
+{
+  r_index = (int **) calloc(m, sizeof(*r_index));
+  r_value = (double **) calloc(m, sizeof(*r_value));
+  r_len = (int *) calloc(m, sizeof(*r_len));
+  r_size = (int *) calloc(m, sizeof(*r_size));
+}
+
+SparseMatrix::SparseMatrix (Matrix *mat)
+  : _m(mat->m()), _n(mat->n()), _nnz(0), columns_valid(0), c_start(NULL), c_index(NULL), c_value(NULL)
+{
+  r_index = (int **) calloc(m(), sizeof(*r_index));
+  r_value = (double **) calloc(m(), sizeof(*r_value));
+  r_len = (int *) calloc(m(), sizeof(*r_len));
+  r_size = (int *) calloc(m(), sizeof(*r_size));
+
+  for (int i = 0; i < m(); i++) {
+    int count = 0;
+    for (int j = 0; j < n(); j++)
+      if (mat->at(i, j) != 0.0) count++;
+
+    reserve(i, count);
+
+    for (int j = 0; j < n(); j++) {
+      double value = mat->at(i, j);
+      if (value == 0.0) continue;
+
+      r_index[i][r_len[i]] = j;
+      r_value[i][r_len[i]] = value;
+      r_len[i]++;
+    }
+
+    _nnz += count;
+  }
+}
+
+SparseMatrix::~SparseMatrix ()
+{
+  for (int i = 0; i < m(); i++) {
+    free(r_index[i]);
+    free(r_value[i]);
+  }
+
+  free(r_index);
+  free(r_value);
+  free(r_len);
+  free(r_size);
+
+  free(c_start);
+  free(c_index);
+  free(c_value);
+}
+
+/* helpers */
+
+void SparseMatrix::reserve (int row, int size)
+{
+  if (size <= r_size[row]) return;
+
+  if (size < 2 * r_size[row]) size = 2 * r_size[row]; // grow geometrically
+  if (size < 4) size = 4;
+
+  r_size[row] = size;
+  r_index[row] = (int *) realloc(r_index[row], size * sizeof(**r_index));
+  r_value[row] = (double *) realloc(r_value[row], size * sizeof(**r_value));
+}
+
+int SparseMatrix::search (int row, int col)
+{
+  int low = 0, high = r_len[row]; // binary search
+
+  while (low < high) {
+    int mid = (low + high) / 2;
+
+    if (r_index[row][mid] < col) low = mid + 1;
+    else high = mid;
+  }
+
+  return low;
+}
+
+void SparseMatrix::build_columns ()
+{
+  free(c_start);
+  free(c_index);
+  free(c_value);
+
+  c_start = (int *) calloc(n() + 1, sizeof(*c_start));
+  c_index = (int *) malloc((nnz() + 1) * sizeof(*c_index));
+  c_value = (double *) malloc((nnz() + 1) * sizeof(*c_value));
+
+  /* count the elements of every column, then place
+     them scanning the rows in order */
+
+  for (int i = 0; i < m(); i++)
+    for (int k = 0; k < r_len[i]; k++)
+      c_start[r_index[i][k] + 1]++;
+
+  for (int j = 0; j < n(); j++)
+    c_start[j + 1] += c_start[j];
+
+  int *next = (int *) malloc(n() * sizeof(*next));
+  memcpy(next, c_start, n() * sizeof(*next));
+
+  for (int i = 0; i < m(); i++) {
+    for (int k = 0; k < r_len[i]; k++) {
+      int pos = next[r_index[i][k]]++;
+
+      c_index[pos] = i;
+      c_value[pos] = r_value[i][k];
+    }
+  }
+
+  free(next);
+
+  columns_valid = 1;
+}
+
+/* getters and setters */
+
+double SparseMatrix::at (int i, int j)
+{
+  assert( i >= 0  &&  j >= 0  &&
+	  i < _m  &&  j < _n );
+
+  int pos = search(i, j);
+
+  if (pos < r_len[i] && r_index[i][pos] == j)
+    return r_value[i][pos];
+
+  return 0.0;
+}
+
+double SparseMatrix::at (int i, int j, double val)
+{
+  assert( i >= 0  &&  j >= 0  &&
+	  i < _m  &&  j < _n );
+
+  columns_valid = 0;
+
+  int pos = (r_len[i] && r_index[i][r_len[i] - 1] < j) ? r_len[i] : search(i, j); // appending is common
+
+  if (pos < r_len[i] && r_index[i][pos] == j) { // existing element
+
+    if (val != 0.0) {
+      r_value[i][pos] = val;
+    }
+
+    else { // remove it
+      memmove(&r_index[i][pos], &r_index[i][pos + 1], (r_len[i] - pos - 1) * sizeof(**r_index));
+      memmove(&r_value[i][pos], &r_value[i][pos + 1], (r_len[i] - pos - 1) * sizeof(**r_value));
+      r_len[i]--;
+      _nnz--;
+    }
+
+    return val;
+  }
+
+  if (val == 0.0) return val;
+
+  // insert a new element
+
+  reserve(i, r_len[i] + 1);
+
+  memmove(&r_index[i][pos + 1], &r_index[i][pos], (r_len[i] - pos) * sizeof(**r_index));
+  memmove(&r_value[i][pos + 1], &r_value[i][pos], (r_len[i] - pos) * sizeof(**r_value));
+
+  r_index[i][pos] = j;
+  r_value[i][pos] = val;
+  r_len[i]++;
+  _nnz++;
+
+  return val;
+}
+
+/* column-wise view */
+
+int *SparseMatrix::col_start ()
+{
+  if (!columns_valid) build_columns();
+  return c_start;
+}
+
+int *SparseMatrix::col_index ()
+{
+  if (!columns_valid) build_columns();
+  return c_index;
+}
+
+double *SparseMatrix::col_value ()
+{
+  if (!columns_valid) build_columns();
+  return c_value;
+}
+
+/* elementary row operations */
+
+void SparseMatrix::swap_rows (int row1, int row2)
+{
+  assert( row1 >= 0   &&  row2 >= 0    &&
+	  row1 <  m() &&  row2 <  m()  );
+  assert(row1 != row2);
+
+  // only the row pointers are exchanged
+
+  int *tmp_index = r_index[row1];
+  r_index[row1] = r_index[row2];
+  r_index[row2] = tmp_index;
+
+  double *tmp_value = r_value[row1];
+  r_value[row1] = r_value[row2];
+  r_value[row2] = tmp_value;
+
+  int tmp = r_len[row1];
+  r_len[row1] = r_len[row2];
+  r_len[row2] = tmp;
+
+  tmp = r_size[row1];
+  r_size[row1] = r_size[row2];
+  r_size[row2] = tmp;
+
+  columns_valid = 0;
+}
+
+void SparseMatrix::swap_columns (int col1, int col2)
+{
+  assert( col1 >= 0    && col2 >= 0    &&
+	  col1 <  n()  && col2 <  n()  );
+  assert(col1 != col2);
+
+  for (int i = 0; i < m(); i++) {
+    double value1 = at(i, col1);
+    double value2 = at(i, col2);
+
+    if (value1 == 0.0 && value2 == 0.0) continue;
+
+    at(i, col1, value2);
+    at(i, col2, value1);
+  }
+
+  columns_valid = 0;
+}
+
+void SparseMatrix::scale_row (int row, double k)
+{
+  assert( row >= 0 && row < m() );
+
+  if (k == 0.0) { // all the elements become null
+    _nnz -= r_len[row];
+    r_len[row] = 0;
+    columns_valid = 0;
+    return;
+  }
+
+  for (int z = 0; z < r_len[row]; z++)
+    r_value[row][z] *= k;
+
+  columns_valid = 0;
+}
+
+void SparseMatrix::scale_column (int col, double k)
+{
+  assert( col >= 0 && col < n() );
+
+  for (int i = 0; i < m(); i++) {
+    double value = at(i, col);
+    if (value != 0.0) at(i, col, value * k);
+  }
+}
+
+void SparseMatrix::add_premultiplied_row (int src, double k, int dst)
+{
+  assert( src >= 0    &&  dst >= 0    &&
+	  src <  m()  &&  dst <  m()  );
+  assert(src != dst);
+
+  if (k == 0.0 || r_len[src] == 0) return;
+
+  /* merge the two sorted rows into a new one */
+
+  int size = r_len[src] + r_len[dst];
+  int *index = (int *) malloc(size * sizeof(*index));
+  double *value = (double *) malloc(size * sizeof(*value));
+
+  int a = 0, b = 0, len = 0;
+
+  while (a < r_len[src] || b < r_len[dst]) {
+    int col_a = (a < r_len[src]) ? r_index[src][a] : n();
+    int col_b = (b < r_len[dst]) ? r_index[dst][b] : n();
+    double v;
+
+    if (col_a < col_b) {
+      index[len] = col_a;
+      v = k * r_value[src][a++];
+    } else if (col_b < col_a) {
+      index[len] = col_b;
+      v = r_value[dst][b++];
+    } else {
+      index[len] = col_a;
+      v = r_value[dst][b++] + k * r_value[src][a++];
+    }
+
+    if (v == 0.0) continue; // cancellation
+    value[len++] = v;
+  }
+
+  _nnz += len - r_len[dst];
+
+  free(r_index[dst]);
+  free(r_value[dst]);
+
+  r_index[dst] = index;
+  r_value[dst] = value;
+  r_len[dst] = len;
+  r_size[dst] = size;
+
+  columns_valid = 0;
+}
+
+void SparseMatrix::add_premultiplied_column (int src, double k, int dst)
+{
+  assert( src >= 0    &&  dst >= 0    &&
+	  src <  n()  &&  dst <  n()  );
+  assert(src != dst);
+
+  for (int i = 0; i < m(); i++) {
+    double value = at(i, src);
+    if (value != 0.0) at(i, dst, at(i, dst) + value * k);
+  }
+}
+
+/* matrix operations */
+
+SparseMatrix *SparseMatrix::multiply_by (SparseMatrix *mat)
+{
+  /*
+    Row-by-row product: the i-th row of the result is the
+    combination of the rows of mat, with the elements of the
+    i-th row of this matrix as coefficients. Only the
+    nonzero elements are visited.
+   */
+
+  assert(n() == mat->m());
+
+  SparseMatrix *result = new SparseMatrix(m(), mat->n());
+
+  double *accumulator = (double *) calloc(mat->n(), sizeof(*accumulator));
+  int *touched = (int *) calloc(mat->n(), sizeof(*touched));
+
+  for (int i = 0; i < m(); i++) {
+
+    for (int z = 0; z < r_len[i]; z++) {
+      int row = r_index[i][z];
+      double k = r_value[i][z];
+
+      for (int w = 0; w < mat->r_len[row]; w++) {
+	int col = mat->r_index[row][w];
+
+	accumulator[col] += k * mat->r_value[row][w];
+	touched[col] = 1;
+      }
+    }
+
+    for (int j = 0; j < mat->n(); j++) { // collect the row, in column order
+      if (!touched[j]) continue;
+
+      result->at(i, j, accumulator[j]);
+      accumulator[j] = 0.0;
+      touched[j] = 0;
+    }
+  }
+
+  free(accumulator);
+  free(touched);
+
+  return result;
+}
+
+/* other stuff... */
+
+void SparseMatrix::print ()
+{
+  for (int i = 0; i < m(); i++) {
+
+    for (int j = 0; j < n(); j++) {
+      printf("%.5f ", at(i, j));
+    }
+
+    putchar('\n');
+  }
+}
+
+SparseMatrix *SparseMatrix::clone ()
+{
+  SparseMatrix *copy = new SparseMatrix(m(), n());
+
+  for (int i = 0; i < m(); i++) {
+    copy->reserve(i, r_len[i]);
+
+    memcpy(copy->r_index[i], r_index[i], r_len[i] * sizeof(**r_index));
+    memcpy(copy->r_value[i], r_value[i], r_len[i] * sizeof(**r_value));
+    copy->r_len[i] = r_len[i];
+  }
+
+  copy->_nnz = nnz();
+
+  return copy;
+}
+
+Matrix *SparseMatrix::densify ()
+{
+  Matrix *mat = new Matrix(m(), n(), NULL);
+
+  for (int i = 0; i < m(); i++)
+    for (int z = 0; z < r_len[i]; z++)
+      mat->at(i, r_index[i][z], r_value[i][z]);
+
+  return mat;
+}
+
+/* unit tests */
+void SparseMatrix::test ()
+{
+  double b1[] = { 1, 0, 0, 0,
+		  0, 1, 0, 0,
+		  0, 0, 1, 0 };
+
+  double b2[] = { 0, 0, 3,
+		  0, 3, 0,
+		  3, 0, 0 };
+
+  Matrix *d1 = new Matrix(3, 4, b1);
+  Matrix *d2 = new Matrix(3, 3, b2);
+
+  SparseMatrix *m1 = new SparseMatrix(d1);
+  SparseMatrix *m2 = new SparseMatrix(d2);
+
+  puts("\nSparse matrix: Elementary row/column operations:");
+
+  puts("\nSparse matrix: matrix 1:");
+  m1->print();
+
+  m1->swap_rows(0, 2);
+
+  puts("\nSparse matrix: swap first and last rows:");
+  m1->print();
+
+  m1->swap_columns(0, 3);
+
+  puts("\nSparse matrix: swap first and last columns:");
+  m1->print();
+
+  m1->add_premultiplied_row(2, 2.5, 0);
+
+  puts("\nSparse matrix: add last row to first (mult. by 2.5):");
+  m1->print();
+
+  m1->scale_row(0, 0.5);
+
+  puts("\nSparse matrix: scale first row by 0.5:");
+  m1->print();
+
+  printf("\nSparse matrix: nonzero elements: %d, by column:", m1->nnz());
+  for (int j = 0; j < m1->n(); j++)
+    printf(" %d", m1->col_start()[j + 1] - m1->col_start()[j]);
+  putchar('\n');
+
+  SparseMatrix *m3 = m2->multiply_by(m1);
+
+  puts("\nSparse matrix: matrix 2 multiplied by matrix 1:");
+  m3->print();
+
+  delete d1;
+  delete d2;
+  delete m1;
+  delete m2;
+  delete m3;
+}
@@ -0,0 +1,100 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "matrix.h"
+
+/*
+  Sparse matrix: only the nonzero elements are stored.
+
+  Every row keeps its elements sorted by column (row-wise view),
+  and can grow when an elementary operation introduces new elements.
+  The column-wise view (compressed sparse columns) is rebuilt
+  from the rows only when requested after a modification.
+*/
+
+class SparseMatrix {
+
+ public:
+  SparseMatrix (int m, int n);
+  SparseMatrix (Matrix *mat); // copy the nonzero elements of a dense matrix
+  virtual ~SparseMatrix ();
+
+  /* getters and setters */
+
+  inline int m ()   { return _m; };
+  inline int n ()   { return _n; };
+  inline int nnz () { return _nnz; };
+
+  double at (int i, int j);             // get element at position
+  double at (int i, int j, double val); // set element at position (zero removes it)
+
+  /* row-wise view */
+
+  inline int row_nnz (int i)        { assert( i >= 0 && i < _m ); return r_len[i]; };
+  inline int *row_index (int i)     { assert( i >= 0 && i < _m ); return r_index[i]; };
+  inline double *row_value (int i)  { assert( i >= 0 && i < _m ); return r_value[i]; };
+
+  /* column-wise view: the elements of column j are in positions
+     col_start()[j] ... col_start()[j + 1] - 1 of the other arrays */
+
+  int *col_start ();
+  int *col_index ();    // row of each element
+  double *col_value ();
+
+  /* elementary row operations */
+
+  void swap_rows    (int row1, int row2);
+  void swap_columns (int col1, int col2);
+
+  void scale_row    (int row, double k);
+  void scale_column (int col, double k);
+
+  void add_premultiplied_row    (int src, double k, int dst);
+  void add_premultiplied_column (int src, double k, int dst);
+
+  /* matrix operations */
+
+  SparseMatrix *multiply_by (SparseMatrix *mat);
+
+  /* other stuff... */
+
+  virtual void print ();            // pretty print the matrix (as a dense one)
+  virtual SparseMatrix *clone ();   // create a copy
+  Matrix *densify ();               // create a dense copy
+
+  /* unit tests */
+  static void test ();
+
+ protected:
+  int _m, _n;
+  int _nnz;
+
+  int **r_index;       // column of every element, by row
+  double **r_value;
+  int *r_len, *r_size;
+
+  int columns_valid;   // the column-wise view is up to date
+  int *c_start;
+  int *c_index;
+  double *c_value;
+
+  void reserve (int row, int size); // make room for size elements in a row
+  int  search  (int row, int col);  // position of the first element with column >= col
+  void build_columns ();
+
+};
+
+#endif
@@ -1,7 +1,18 @@
+#include <math.h>
+
 #include "tableau.h"
+#include "threads.h"
+#include "tolerances.h"
 
-Tableau::Tableau (int m, int n, double *buffer, int *indices)
-  : Matrix::Matrix(m, n, buffer)
+template <typename T>
+BasicTableau<T>::BasicTableau (int m, int n, T *buffer, int *indices)
+  : BasicTableau(m, n, buffer, indices, 0)
+{
+}
+
+template <typename T>
+BasicTableau<T>::BasicTableau (int m, int n, T *buffer, int *indices, int shared)
+  : BasicMatrix<T>(m, n, buffer, shared)
 {
   size_t size = (m - 1) * sizeof(*basis_indices);
 
@@ -18,74 +29,306 @@ Tableau::Tableau (int m, int n, double *buffer, int *indices)
     basis_indices = (int *) calloc(m - 1, sizeof(*basis_indices));
     basis_indices_set = (int *) calloc(m - 1, sizeof(*basis_indices_set));
   }
+
+  lower_bounds = (double *) calloc(n - 1, sizeof(*lower_bounds));
+  upper_bounds = (double *) malloc((n - 1) * sizeof(*upper_bounds));
+  complemented = (int *) calloc(n - 1, sizeof(*complemented));
+
+  for (int j = 0; j < n - 1; j++)
+    upper_bounds[j] = HUGE_VAL;
 }
 
-Tableau::~Tableau ()
+template <typename T>
+BasicTableau<T>::~BasicTableau ()
 {
   free(basis_indices);
+  free(lower_bounds);
+  free(upper_bounds);
+  free(complemented);
+}
+
+/* upper bounds */
+
+template <typename T>
+void BasicTableau<T>::complement_column (int col)
+{
+  assert( col >= 0 && col < n() - 1 && upper_bounds[col] != HUGE_VAL );
+
+  double upper = upper_bounds[col];
+
+  /* a[i][col] * x = a[i][col] * u - a[i][col] * x',
+     on every row (reduced costs row included) */
+
+  for (int i = 0; i < m(); i++) {
+    T value = at(i, col);
+    if (value == 0) continue;
+
+    at(i, n() - 1, at(i, n() - 1) - value * upper);
+    at(i, col, - value);
+  }
+
+  complemented[col] = !complemented[col];
+
+  for (int i = 0; i < m() - 1; i++) // a basic column must remain a unit column
+    if (basis_indices_set[i] && basis_indices[i] == col) this->scale_row(i, -1.0);
+}
+
+template <typename T>
+void BasicTableau<T>::bound_column (int col, double lower, double upper)
+{
+  assert( col >= 0 && col < n() - 1 && !complemented[col] &&
+	  lower > - HUGE_VAL && lower != HUGE_VAL && upper >= lower );
+
+  /* a[i][col] * x = a[i][col] * l + a[i][col] * x',
+     on every row (reduced costs row included) */
+
+  if (lower != 0)
+    for (int i = 0; i < m(); i++) {
+      T value = at(i, col);
+      if (value == 0) continue;
+
+      at(i, n() - 1, at(i, n() - 1) - value * lower);
+    }
+
+  lower_bounds[col] += lower;
+  upper_bounds[col] = upper == HUGE_VAL ? HUGE_VAL : upper - lower;
+}
+
+template <typename T>
+double BasicTableau<T>::value_at (int col)
+{
+  assert( col >= 0 && col < n() - 1 );
+
+  double value = 0; // a variable out of the basis is at its (shifted) lower bound
+
+  for (int i = 0; i < m() - 1; i++)
+    if (basis_indices_set[i] && basis_indices[i] == col) value = at(i, n() - 1);
+
+  if (complemented[col]) value = upper_bounds[col] - value;
+
+  return lower_bounds[col] + value;
 }
 
 /* add/delete row and columns */
 
-void Tableau::delete_row (int row)
+template <typename T>
+void BasicTableau<T>::insert_columns (int col, int count)
 {
-  assert( row >= 0 && row <= m() - 1 );
-  
-  for (int i = row; i < m() - 1; i++) {
-    swap_rows(i, i+1);
+  assert( col >= 0 && col <= n() - 1 && count >= 0 );
 
-    if (i < m() - 2) basis_at(i, basis_at(i+1));
+  if (count == 0) return;
+
+  int old_n = n(), new_n = n() + count;
+
+  /* the new columns fit in the padding of the rows: the rows stay in
+     place, and only their tails move. Otherwise (or if the buffer is
+     shared, and can't grow) the rows are copied in a new buffer */
+
+  int new_ld = shared || new_n > _ld ? BasicMatrix<T>::padded(new_n) : _ld;
+  T *target = new_ld == _ld && !shared ? buffer : BasicMatrix<T>::allocate(m(), new_ld);
+
+  for (int i = 0; i < m(); i++) {
+    T *src = &buffer[(size_t) i * _ld], *dst = &target[(size_t) i * new_ld];
+
+    memmove(dst + col + count, src + col, (old_n - col) * sizeof(*buffer));
+    if (dst != src) memcpy(dst, src, col * sizeof(*buffer));
+    memset(dst + col, 0, count * sizeof(*buffer));
   }
-  
-  m(m() - 1);
+
+  if (target != buffer) {
+    if (!shared) free(buffer);
+
+    buffer = target;
+    shared = 0;
+    _ld = new_ld;
+  }
+
+  lower_bounds = (double *) realloc(lower_bounds, (new_n - 1) * sizeof(*lower_bounds));
+  upper_bounds = (double *) realloc(upper_bounds, (new_n - 1) * sizeof(*upper_bounds));
+  complemented = (int *) realloc(complemented, (new_n - 1) * sizeof(*complemented));
+
+  for (int j = old_n - 2; j >= col; j--) {
+    lower_bounds[j + count] = lower_bounds[j];
+    upper_bounds[j + count] = upper_bounds[j];
+    complemented[j + count] = complemented[j];
+  }
+
+  for (int j = col; j < col + count; j++) {
+    lower_bounds[j] = 0;
+    upper_bounds[j] = HUGE_VAL;
+    complemented[j] = 0;
+  }
+
+  for (int i = 0; i < m() - 1; i++)
+    if (basis_indices[i] >= col) basis_indices[i] += count;
+
+  BasicMatrix<T>::n(new_n);
 }
 
-void Tableau::delete_column (int col)
+template <typename T>
+void BasicTableau<T>::delete_rows (int *mask)
 {
-  assert( col >= 0 && col <= n() - 1 );
- 
-  for (int j = col; j < n() - 1; j++) {
-    swap_columns(j, j+1);
+  int k = 0; // the rows kept are moved up, in order
+
+  for (int i = 0; i < m() - 1; i++) {
+    if (mask[i]) continue;
+
+    if (k != i) {
+      memcpy(row(k), row(i), n() * sizeof(*buffer));
+      basis_indices[k] = basis_indices[i];
+      basis_indices_set[k] = basis_indices_set[i];
+    }
+
+    k++;
   }
 
-  double *tmp = (double *) malloc(m() * (n() - 1) * sizeof(*tmp));
+  if (k == m() - 1) return;
 
-  for (int i = 0; i < m(); i++)
-    for (int j = 0; j < n() - 1; j++)
-      tmp[i * (n() - 1) + j] = at(i, j);
+  memcpy(row(k), row(m() - 1), n() * sizeof(*buffer)); // the reduced costs row
 
-  free(buffer);
-  buffer = tmp;
-  
-  n(n() - 1);
+  BasicMatrix<T>::m(k + 1);
+}
+
+template <typename T>
+void BasicTableau<T>::delete_columns (int *mask)
+{
+  int *index = (int *) malloc(n() * sizeof(*index)); // new index of every column kept
+  int k = 0;
+
+  for (int j = 0; j < n() - 1; j++) {
+    index[j] = mask[j] ? -1 : k;
+    if (!mask[j]) k++;
+  }
+
+  index[n() - 1] = k; // the variables column
+
+  if (k == n() - 1) {
+    free(index);
+    return;
+  }
+
+  int old_n = n(), new_n = k + 1;
+
+  /* every element moves to a lower (or the same) position of its
+     row: the rows are compacted in place, keeping their stride (a
+     shared buffer is copied instead, as it belongs to the caller) */
+
+  int new_ld = shared ? BasicMatrix<T>::padded(new_n) : _ld;
+  T *target = shared ? BasicMatrix<T>::allocate(m(), new_ld) : buffer;
+
+  for (int i = 0; i < m(); i++) {
+    T *src = &buffer[(size_t) i * _ld], *dst = &target[(size_t) i * new_ld];
+
+    for (int j = 0; j < old_n; j++)
+      if (index[j] != -1) dst[index[j]] = src[j];
+  }
+
+  buffer = target;
+  shared = 0;
+  _ld = new_ld;
+
+  for (int j = 0; j < old_n - 1; j++) {
+    if (index[j] == -1) continue;
+
+    lower_bounds[index[j]] = lower_bounds[j];
+    upper_bounds[index[j]] = upper_bounds[j];
+    complemented[index[j]] = complemented[j];
+  }
+
+  for (int i = 0; i < m() - 1; i++) { // the basis variables of the deleted columns are unset
+    if (!basis_indices_set[i]) continue;
+
+    if (index[basis_indices[i]] == -1) basis_indices[i] = basis_indices_set[i] = 0;
+    else basis_indices[i] = index[basis_indices[i]];
+  }
+
+  free(index);
+
+  BasicMatrix<T>::n(new_n);
+}
+
+template <typename T>
+void BasicTableau<T>::delete_row (int row)
+{
+  assert( row >= 0 && row < m() - 1 );
+
+  int *mask = (int *) calloc(m() - 1, sizeof(*mask));
+
+  mask[row] = 1;
+  delete_rows(mask);
+
+  free(mask);
+}
+
+template <typename T>
+void BasicTableau<T>::delete_column (int col)
+{
+  assert( col >= 0 && col < n() - 1 );
+
+  int *mask = (int *) calloc(n() - 1, sizeof(*mask));
+
+  mask[col] = 1;
+  delete_columns(mask);
+
+  free(mask);
 }
 
 /* tableau operations */
 
-void Tableau::pivot (int row, int col)
+/* the rows of a block are updated independently of the other blocks:
+   they only read the pivot row. An element of the pivot column below
+   the zero tolerance is a rounding error: it becomes an exact zero,
+   instead of spreading in its row */
+
+template <typename T>
+struct pivot_args {
+  BasicTableau<T> *tab;
+  int row, col;
+};
+
+template <typename T>
+static void eliminate_rows (int begin, int end, void *arg)
+{
+  struct pivot_args<T> *args = (struct pivot_args<T> *) arg;
+
+  for (int i = begin; i < end; i++) {
+    if (i == args->row) continue;
+
+    T value = args->tab->at(i, args->col);
+
+    if (fabs(value) <= Tolerances::zero) {
+      if (value != 0) args->tab->at(i, args->col, 0.0);
+      continue;
+    }
+    
+    T multiplier = - 1.0 * value;
+    args->tab->add_premultiplied_row(args->row, multiplier, i); // nullify the element
+  }
+}
+
+template <typename T>
+void BasicTableau<T>::pivot (int row, int col)
 {
   assert( row >= 0        &&  col >= 0       &&
 	  row <  m() - 1  &&  col <  n() - 1 );
 
-  double pivot = at(row, col);
+  T pivot = at(row, col);
 
   if (pivot != 1.0)
-    scale_row(row, 1.0 / pivot); // scale the pivot to assume value 1.0
+    this->scale_row(row, 1.0 / pivot); // scale the pivot to assume value 1.0
   
   /* nullify every element in the column that is not the pivot */
 
-  for (int i = 0; i < m(); i++) {
-    if (i == row) continue;
+  struct pivot_args<T> args = { this, row, col };
 
-    double value = at(i, col);
-    if (value == 0) continue;
-    
-    double multiplier = - 1.0 * value;
-    add_premultiplied_row(row, multiplier, i); // nullify the element
-  }
+  if (Threads::worth((long) m() * n()))
+    Threads::parallel_for(0, m(), Threads::block_rows(n()), eliminate_rows<T>, &args);
+  else
+    eliminate_rows<T>(0, m(), &args);
 }
 
-void Tableau::canonicalize ()
+template <typename T>
+void BasicTableau<T>::canonicalize ()
 {
   for (int i = 0; i < m() - 1; i++) { /* only m - 1 basic variables
 				       (skip the reduced costs row) */
@@ -95,11 +338,57 @@ void Tableau::canonicalize ()
   }
 }
 
+template <typename T>
+BasisFactor *BasicTableau<T>::factorize_basis ()
+{
+  return factorize_basis(basis_indices);
+}
+
+template <typename T>
+BasisFactor *BasicTableau<T>::factorize_basis (int *columns)
+{
+  int rows = m() - 1; // skip the reduced costs row
+
+  int *col_start = (int *) malloc((rows + 1) * sizeof(*col_start));
+  int *row_index = (int *) malloc(rows * rows * sizeof(*row_index));
+  double *value = (double *) malloc(rows * rows * sizeof(*value));
+  int nnz = 0;
+
+  for (int k = 0; k < rows; k++) { // the k-th column is the one of the k-th basic variable
+    int j = columns[k];
+    col_start[k] = nnz;
+
+    for (int i = 0; i < rows; i++) {
+      if (at(i, j) == 0.0) continue;
+
+      row_index[nnz] = i;
+      value[nnz] = at(i, j);
+      nnz++;
+    }
+  }
+
+  col_start[rows] = nnz;
+
+  BasisFactor *factor = new BasisFactor(rows);
+
+  if (!factor->factorize(col_start, row_index, value)) {
+    delete factor;
+    factor = NULL;
+  }
+
+  free(col_start);
+  free(row_index);
+  free(value);
+
+  return factor;
+}
+
 /* other stuff... */
 
-void Tableau::print ()
+template <typename T>
+void BasicTableau<T>::print ()
 {
-  Matrix::print();
+  BasicMatrix<T>::print();
 
   for (int i = 0; i < m() - 1; i++) {
     printf("index[%d] = %d", i, basis_indices[i]);
@@ -108,10 +397,37 @@ void Tableau::print ()
     else puts(" (unset)");
   }
 
+  for (int j = 0; j < n() - 1; j++) { // only the bounded variables
+    if (lower_bounds[j] != 0) printf("lower[%d] = %g\n", j, lower_bounds[j]);
+
+    if (upper_bounds[j] == HUGE_VAL) continue;
+
+    printf("upper[%d] = %g", j, upper_bounds[j]);
+
+    if (complemented[j]) puts(" (complemented)");
+    else putchar('\n');
+  }
+
   putchar('\n');
 }
 
-Tableau *Tableau::clone ()
+template <typename T>
+BasicTableau<T> *BasicTableau<T>::clone ()
 {
-  return new Tableau(m(), n(), buffer, basis_indices);
+  BasicTableau *tab = new BasicTableau(m(), n(), NULL, basis_indices);
+
+  tab->copy_rows(buffer, _ld);
+
+  memcpy(tab->lower_bounds, lower_bounds, (n() - 1) * sizeof(*lower_bounds));
+  memcpy(tab->upper_bounds, upper_bounds, (n() - 1) * sizeof(*upper_bounds));
+  memcpy(tab->complemented, complemented, (n() - 1) * sizeof(*complemented));
+  memcpy(tab->basis_indices_set, basis_indices_set, (m() - 1) * sizeof(*basis_indices_set));
+
+  return tab;
 }
+
+/* the three scalar types (see BasicMatrix) */
+
+template class BasicTableau<float>;
+template class BasicTableau<double>;
+template class BasicTableau<long double>;
@@ -15,6 +15,7 @@
 #include <assert.h>
 
 #include "matrix.h"
+#include "factor.h"
 
 class TableauException {
  public: int code;
@@ -23,15 +24,33 @@ class TableauException {
 class InvalidFormException : public TableauException {};
 class UnlimitedException   : public TableauException {};
 class ImpossibleException  : public TableauException {};
+class SingularException    : public TableauException {};
 
-class Tableau : public Matrix {
+/*
+  Simplex tableau of T elements (see BasicMatrix): the bounds of the
+  variables are kept in double for every type, so a tableau can be
+  copied in another precision without changing them.
+*/
+
+template <typename T>
+class BasicTableau : public BasicMatrix<T> {
   
  public:
-  Tableau (int m, int n, double *buffer, int *basis_indices);
-  virtual ~Tableau ();
+  BasicTableau (int m, int n, T *buffer, int *basis_indices);
+  BasicTableau (int m, int n, T *buffer, int *basis_indices, int shared); /* see BasicMatrix */
+  virtual ~BasicTableau ();
 
   /* getters and setters */
 
+  /* the members of the base class depend on T, so the ones
+     used by the tableau are named here */
+
+  inline int m () { return this->_m; };
+  inline int n () { return this->_n; };
+
+  using BasicMatrix<T>::at;
+  using BasicMatrix<T>::row;
+
   inline int basis_at(int i) {           // get the column of the i-th basis variable
     assert( i >= 0 && i < m() - 1 );
     return basis_indices[i];
@@ -49,7 +68,57 @@ class Tableau : public Matrix {
     return basis_indices_set[i];
   }
 
-  /* delete row and columns */
+  /* bounds of the variables: the columns are the variables shifted to
+     a zero lower bound (see bound_column), so upper_at is the width of
+     the range of a variable, and lower_at its shift */
+
+  inline double upper_at(int j) {              // get the upper bound of the j-th variable
+    assert( j >= 0 && j < n() - 1 );
+    return upper_bounds[j];
+  }
+
+  inline double upper_at(int j, double value) { // set the upper bound (HUGE_VAL if none)
+    assert( j >= 0 && j < n() - 1 && value >= 0 );
+    return upper_bounds[j] = value;
+  }
+
+  inline double lower_at(int j) {              // get the lower bound of the j-th variable
+    assert( j >= 0 && j < n() - 1 );
+    return lower_bounds[j];
+  }
+
+  inline double lower_at(int j, double value) { // set the lower bound, without shifting
+    assert( j >= 0 && j < n() - 1 );           // the column (restoring a saved tableau)
+    return lower_bounds[j] = value;
+  }
+
+  inline int complemented_at(int j) {          // check if the column is complemented
+    assert( j >= 0 && j < n() - 1 );
+    return complemented[j];
+  }
+
+  inline int complemented_at(int j, int value) { // mark the column as complemented
+    assert( j >= 0 && j < n() - 1 );           // (restoring a saved tableau)
+    return complemented[j] = value;
+  }
+
+  void complement_column (int col); /* replace the variable with its upper bound minus
+				       the variable (x' = u - x), the bound must be finite */
+
+  void bound_column (int col, double lower, double upper); /* bound a variable, l <= x <= u:
+							      the column becomes x' = x - l,
+							      0 <= x' <= u - l (l finite) */
+
+  double value_at (int col); // value of a variable in the current solution
+
+  /* add/delete rows and columns: the rows and columns to delete are
+     marked in a mask (lazy deletion), and removed in a single pass */
+
+  void insert_columns (int col, int count); /* insert count zero columns before col,
+					       growing the buffer in place if possible */
+
+  void delete_rows    (int *mask); // delete the rows marked in the mask (m - 1 flags)
+  void delete_columns (int *mask); // delete the columns marked in the mask (n - 1 flags)
 
   void delete_row    (int row);
   void delete_column (int col);
@@ -59,10 +128,14 @@ class Tableau : public Matrix {
   void pivot (int row, int col); // pivot operation on the given element
   void canonicalize (); // put in canonical form using the basis indices
 
+  BasisFactor *factorize_basis (); /* factorize the columns of the basis variables
+				      (reduced costs row excluded), NULL if singular */
+  BasisFactor *factorize_basis (int *columns); // the given columns, one for every row
+
   /* other stuff... */
 
   virtual void print (); // pretty print the tableau
-  virtual Tableau *clone (); // create a copy
+  virtual BasicTableau *clone (); // create a copy
 
   /* unit tests */
   static void test ();
@@ -71,6 +144,15 @@ class Tableau : public Matrix {
   int *basis_indices;
   int *basis_indices_set;
 
+  double *lower_bounds;
+  double *upper_bounds;
+  int *complemented;
+
+  using BasicMatrix<T>::_ld;
+  using BasicMatrix<T>::buffer;
+  using BasicMatrix<T>::shared;
 };
 
+typedef BasicTableau<double> Tableau;
+
 #endif
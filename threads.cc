@@ -0,0 +1,292 @@
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+#include "threads.h"
+
+/* Settings */
+int Threads::count = 1;
+long Threads::threshold = 1 << 16;
+
+/* the pool */
+
+static std::vector<std::thread> workers;
+static std::mutex pool_mutex;            // protects the fields below
+static std::condition_variable wake_up;  // a new operation, or shutdown
+static std::condition_variable done;     // all the workers finished the operation
+static std::mutex busy;                  // held by the thread running a parallel operation
+
+static thread_local int inside = 0;     // the thread is running a parallel operation
+
+static int generation = 0;               // incremented at every operation
+static int running = 0;                  // workers still processing the operation
+static int stopping = 0;
+
+static struct {
+  void (*fn) (int, int, void *);
+  void *arg;
+  int end, block;
+  std::atomic<int> next;                 // first element of the next block to process
+} job;
+
+static void process_blocks ()
+{
+  int begin;
+
+  inside = 1;
+
+  while ((begin = job.next.fetch_add(job.block)) < job.end) {
+    int end = begin + job.block;
+    job.fn(begin, end < job.end ? end : job.end, job.arg);
+  }
+
+  inside = 0;
+}
+
+static void worker_loop ()
+{
+  int seen = 0;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(pool_mutex);
+      wake_up.wait(lock, [&] { return stopping || generation != seen; });
+
+      if (stopping) return;
+      seen = generation;
+    }
+
+    process_blocks();
+
+    {
+      std::lock_guard<std::mutex> lock(pool_mutex);
+      if (--running == 0) done.notify_one();
+    }
+  }
+}
+
+static void start_workers ()
+{
+  static int registered = 0;
+
+  if (!registered) { // the workers must be joined before the exit
+    atexit(Threads::shutdown);
+    registered = 1;
+  }
+
+  Threads::shutdown(); // the number of threads may have changed
+
+  stopping = 0;
+  for (int k = 0; k < Threads::count - 1; k++) // the calling thread works too
+    workers.push_back(std::thread(worker_loop));
+}
+
+void Threads::shutdown ()
+{
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    stopping = 1;
+  }
+
+  wake_up.notify_all();
+
+  for (size_t k = 0; k < workers.size(); k++)
+    workers[k].join();
+
+  workers.clear();
+}
+
+int Threads::worth (long elements)
+{
+  return count > 1 && elements >= threshold;
+}
+
+int Threads::block_rows (int row_length)
+{
+  int rows = (256 * 1024) / (sizeof(double) * (row_length > 0 ? row_length : 1));
+  return rows > 0 ? rows : 1;
+}
+
+void Threads::parallel_for (int begin, int end, int block,
+			    void (*fn) (int begin, int end, void *arg), void *arg)
+{
+  if (begin >= end) return;
+
+  // nested in a parallel operation, or the pool is busy: serial
+  if (count <= 1 || end - begin <= block || inside || !busy.try_lock()) {
+    fn(begin, end, arg);
+    return;
+  }
+
+  if ((int) workers.size() != count - 1)
+    start_workers();
+
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+
+    job.fn = fn;
+    job.arg = arg;
+    job.end = end;
+    job.block = block > 0 ? block : 1;
+    job.next = begin;
+
+    running = workers.size();
+    generation++;
+  }
+
+  wake_up.notify_all();
+
+  process_blocks();
+
+  {
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    done.wait(lock, [] { return running == 0; });
+  }
+
+  busy.unlock();
+}
+
+/* tasks with work stealing */
+
+struct task_range {
+  std::mutex lock;
+  int next, end;             // tasks not started yet
+  char padding[64];          // one cache line per range
+};
+
+struct task_job {
+  struct task_range *ranges;
+  int threads;
+  void (*fn) (int, void *);
+  void *arg;
+};
+
+/* take the next task of a range, -1 if empty */
+static int take_task (struct task_range *range)
+{
+  std::lock_guard<std::mutex> lock(range->lock);
+  return range->next < range->end ? range->next++ : -1;
+}
+
+/* move the second half of the tasks of another range into the empty one, 0 if none */
+static int steal_tasks (struct task_job *tj, int id)
+{
+  struct task_range *own = &tj->ranges[id];
+
+  for (int k = 1; k < tj->threads; k++) {
+    struct task_range *victim = &tj->ranges[(id + k) % tj->threads];
+    int begin, end;
+
+    {
+      std::lock_guard<std::mutex> lock(victim->lock);
+
+      int left = victim->end - victim->next;
+      if (left <= 0) continue;
+
+      begin = victim->next + left / 2; // the victim keeps the first half
+      end = victim->end;
+      victim->end = begin;
+    }
+
+    std::lock_guard<std::mutex> lock(own->lock);
+    own->next = begin;
+    own->end = end;
+    return 1;
+  }
+
+  return 0;
+}
+
+/* the worker ids in [begin, end): process the own tasks, then steal */
+static void run_tasks (int begin, int end, void *arg)
+{
+  struct task_job *tj = (struct task_job *) arg;
+
+  for (int id = begin; id < end; id++) {
+    int task;
+
+    do {
+      while ((task = take_task(&tj->ranges[id])) != -1)
+	tj->fn(task, tj->arg);
+    } while (steal_tasks(tj, id));
+  }
+}
+
+void Threads::parallel_tasks (int tasks, void (*fn) (int task, void *arg), void *arg)
+{
+  struct task_job tj;
+
+  tj.threads = count > 1 ? count : 1;
+  tj.ranges = new struct task_range[tj.threads];
+  tj.fn = fn;
+  tj.arg = arg;
+
+  for (int k = 0; k < tj.threads; k++) { // consecutive tasks to every thread
+    tj.ranges[k].next = (long) tasks * k / tj.threads;
+    tj.ranges[k].end = (long) tasks * (k + 1) / tj.threads;
+  }
+
+  parallel_for(0, tj.threads, 1, run_tasks, &tj);
+
+  delete[] tj.ranges;
+}
+
+/* Unit tests */
+
+static void square_task (int task, void *arg)
+{
+  long *values = (long *) arg;
+
+  if (task % 97 == 0) // uneven tasks
+    for (int k = 0; k < 10000; k++)
+      values[task] += k % 3;
+
+  values[task] += (long) task * task;
+}
+
+static void fill_squares (int begin, int end, void *arg)
+{
+  long *values = (long *) arg;
+
+  for (int i = begin; i < end; i++)
+    values[i] = (long) i * i;
+}
+
+void Threads::test ()
+{
+  const int n = 100000;
+  long *values = (long *) malloc(n * sizeof(*values));
+
+  int saved = count;
+
+  puts("\nThreads: sum of the squares of 0 ... 99999:");
+
+  for (count = 1; count <= 4; count *= 2) {
+    memset(values, 0, n * sizeof(*values));
+    parallel_for(0, n, 1000, fill_squares, values);
+
+    long sum = 0;
+    for (int i = 0; i < n; i++)
+      sum += values[i];
+
+    printf("%d threads: %ld\n", count, sum);
+  }
+
+  puts("\nThreads: sum of the squares of 0 ... 99999, as tasks (plus the uneven ones):");
+
+  for (count = 1; count <= 4; count *= 2) {
+    memset(values, 0, n * sizeof(*values));
+    parallel_tasks(n, square_task, values);
+
+    long sum = 0;
+    for (int i = 0; i < n; i++)
+      sum += values[i];
+
+    printf("%d threads: %ld\n", count, sum);
+  }
+
+  count = saved;
+  free(values);
+}
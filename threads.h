@@ -0,0 +1,58 @@
+/* 
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+  A small pool of worker threads, used to split independent
+  row operations in blocks, or to run independent tasks. The
+  workers are started the first time a parallel operation is
+  executed, and then wait for the next one.
+*/
+
+namespace Threads {
+
+  /* Settings */
+  extern int count;      // threads used by the parallel operations (1 means serial)
+  extern long threshold; // elements to process, below which the operations stay serial
+
+  /* Check if an operation on the given number of elements should run in parallel */
+  int worth (long elements);
+
+  /* Call fn on consecutive blocks of [begin, end), in parallel:
+     the calling thread processes blocks too. If the pool is already
+     busy (a parallel operation from another thread) fn is simply
+     called on the whole range. */
+  void parallel_for (int begin, int end, int block,
+		     void (*fn) (int begin, int end, void *arg), void *arg);
+
+  /* Call fn on every task of [0, tasks), in parallel: every thread
+     starts from its own range of consecutive tasks, and when it is
+     empty steals the second half of the tasks left to another thread
+     (so that tasks of very different sizes are balanced). Nested in
+     a parallel operation, the tasks are run serially. */
+  void parallel_tasks (int tasks, void (*fn) (int task, void *arg), void *arg);
+
+  /* Rows in a block of about 256KB, for rows of the given length */
+  int block_rows (int row_length);
+
+  /* Stop the workers */
+  void shutdown ();
+
+  /* Unit tests */
+  void test ();
+
+}
+
+#endif
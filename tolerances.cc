@@ -0,0 +1,31 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include "tolerances.h"
+
+/* Settings */
+double Tolerances::primal = 1e-9;
+double Tolerances::dual = 1e-9;
+double Tolerances::pivot = 1e-9;
+double Tolerances::zero = 1e-14;
+int Tolerances::harris = 1;
+
+/* Parse the tolerances given as primal,dual,pivot */
+int Tolerances::parse (const char *spec)
+{
+  double p, d, k;
+
+  if (sscanf(spec, "%lf,%lf,%lf", &p, &d, &k) != 3 || p < 0 || d < 0 || k <= 0)
+    return 0;
+
+  primal = p;
+  dual = d;
+  pivot = k;
+
+  return 1;
+}
@@ -0,0 +1,50 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef TOLERANCES_H
+#define TOLERANCES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+  Tolerances of the floating-point tests of the methods.
+
+  A variable is feasible if x >= - primal (and x <= u + primal),
+  a reduced cost is optimal (or dual feasible) if c >= - dual, an
+  element can be a pivot only if its absolute value is larger than
+  pivot, and the elements of the pivot column not larger than zero
+  are not eliminated (they become exact zeros).
+
+  With the Harris ratio test the primal simplex takes the largest
+  pivot among the ratios that are near-tied within the primal
+  tolerance, and the dual simplex the largest element of the row
+  among the breakpoints near-tied within the dual tolerance: the
+  variables of the other rows (and the reduced costs) can become
+  infeasible by at most the tolerance, and the pivots are stable.
+*/
+
+namespace Tolerances {
+
+  //public:
+
+  /* Settings */
+  extern double primal;  // feasibility of the variables
+  extern double dual;    // feasibility of the reduced costs (optimality)
+  extern double pivot;   // smallest pivot
+  extern double zero;    // smaller elements are zeros, in the pivots
+  extern int harris;     // Harris two-pass ratio test (default), or textbook
+
+  /* Parse the tolerances given as primal,dual,pivot, 0 if invalid */
+  int parse (const char *spec);
+
+}
+
+#endif
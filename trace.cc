@@ -0,0 +1,81 @@
+#include <stdarg.h>
+
+#include "trace.h"
+#include "tableau.h"
+
+/* Settings */
+int Trace::level = Trace::NONE;
+
+static Trace::callback_t trace_callback = NULL;
+static void *trace_arg = NULL;
+
+/* Set the callback receiving the events, NULL to print them */
+void Trace::set_callback (callback_t callback, void *arg)
+{
+  trace_callback = callback;
+  trace_arg = arg;
+}
+
+static void init_event (struct Trace::event *ev, int type, int level, const char *method)
+{
+  memset(ev, 0, sizeof(*ev));
+
+  ev->type = type;
+  ev->level = level;
+  ev->method = method;
+  ev->row = ev->column = -1;
+}
+
+void Trace::message (int level, const char *method, const char *format, ...)
+{
+  char buffer[1024];
+  va_list ap;
+
+  va_start(ap, format);
+  vsnprintf(buffer, sizeof(buffer), format, ap);
+  va_end(ap);
+
+  if (trace_callback) {
+    struct event ev;
+
+    init_event(&ev, MESSAGE, level, method);
+    ev.message = buffer;
+    trace_callback(&ev, trace_arg);
+  }
+
+  else printf("%s: %s\n", method, buffer);
+}
+
+void Trace::iteration (const char *method, int iteration, int row, int column, double cost)
+{
+  if (trace_callback) {
+    struct event ev;
+
+    init_event(&ev, ITERATION, ITERATIONS, method);
+    ev.iteration = iteration;
+    ev.row = row;
+    ev.column = column;
+    ev.cost = cost;
+    trace_callback(&ev, trace_arg);
+  }
+
+  else printf("%s: iteration %d, pivot i = %d, j = %d, cost %f\n",
+	      method, iteration, row, column, cost);
+}
+
+void Trace::tableau (const char *method, const char *title, Tableau *tab)
+{
+  if (trace_callback) {
+    struct event ev;
+
+    init_event(&ev, TABLEAU, TABLEAUX, method);
+    ev.message = title;
+    ev.tableau = tab;
+    trace_callback(&ev, trace_arg);
+  }
+
+  else {
+    printf("%s: %s:\n", method, title);
+    tab->print();
+  }
+}
@@ -0,0 +1,93 @@
+/* 
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+template <typename T> class BasicTableau;
+typedef BasicTableau<double> Tableau;
+
+/*
+  Leveled tracing of the methods.
+
+  The methods emit events (messages, iterations and tableau dumps)
+  through the TRACE_* macros below, that check the level before
+  evaluating their arguments: when an event is above the current
+  level it costs a comparison, and nothing at all if the program
+  is compiled with NO_TRACE. The events are printed on the standard
+  output, or passed to a callback, if one is set.
+*/
+
+namespace Trace {
+
+  enum {               // levels
+    NONE = 0,          // nothing: only the results are printed (default)
+    SUMMARY,           // the outcome of the methods and of their phases
+    ITERATIONS,        // a line for every iteration
+    TABLEAUX           // the whole tableau, at every step
+  };
+
+  enum {               // events
+    MESSAGE,
+    ITERATION,
+    TABLEAU
+  };
+
+  struct event {
+    int type;
+    int level;
+    const char *method;  // method emitting the event ("primal", "dual", ...)
+
+    const char *message; // MESSAGE and TABLEAU events (title of the tableau)
+
+    int iteration;       // ITERATION events
+    int row, column;     // pivot element
+    double cost;         // cost after the pivot
+
+    Tableau *tableau;    // TABLEAU events
+  };
+
+  typedef void (*callback_t) (const struct event *ev, void *arg);
+
+  /* Settings */
+  extern int level;
+
+  /* Set the callback receiving the events, NULL to print them */
+  void set_callback (callback_t callback, void *arg);
+
+  /* Emit the events (use the macros, to check the level first) */
+  void message   (int level, const char *method, const char *format, ...)
+    __attribute__ ((format (printf, 3, 4)));
+  void iteration (const char *method, int iteration, int row, int column, double cost);
+  void tableau   (const char *method, const char *title, Tableau *tab);
+
+}
+
+#ifdef NO_TRACE
+#define TRACE_ENABLED(lvl) 0
+#else
+#define TRACE_ENABLED(lvl) (__builtin_expect(Trace::level >= (lvl), 0))
+#endif
+
+#define TRACE_MESSAGE(lvl, ...)						\
+  do { if (TRACE_ENABLED(lvl)) Trace::message((lvl), __VA_ARGS__); } while (0)
+
+#define TRACE_ITERATION(method, count, row, column, cost)		\
+  do { if (TRACE_ENABLED(Trace::ITERATIONS))				\
+      Trace::iteration((method), (count), (row), (column), (cost)); } while (0)
+
+#define TRACE_TABLEAU(method, title, tab)				\
+  do { if (TRACE_ENABLED(Trace::TABLEAUX))				\
+      Trace::tableau((method), (title), (tab)); } while (0)
+
+#endif
@@ -0,0 +1,247 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#include <math.h>
+
+#include "warm.h"
+#include "parser.h"
+#include "simplex.h"
+#include "dual.h"
+#include "kernels.h"
+#include "trace.h"
+#include "tolerances.h"
+
+/* Create a model, with a copy of the problem */
+struct WarmStart::model *WarmStart::create (Tableau *tab, int method)
+{
+  struct model *md = (struct model *) malloc(sizeof(struct model));
+
+  md->original = tab->clone();
+  md->current = NULL;
+  md->method = method;
+  md->rhs_changed = md->cost_changed = 0;
+
+  return md;
+}
+
+/* Free a model */
+void WarmStart::delete_model (struct model *md)
+{
+  delete md->original;
+  delete md->current;
+  free(md);
+}
+
+/* Change an element of the right-hand side or of the costs */
+void WarmStart::set_rhs (struct model *md, int row, double value)
+{
+  assert( row >= 0 && row < md->original->m() - 1 );
+
+  md->original->at(row, md->original->n() - 1, value);
+  md->rhs_changed = 1;
+}
+
+void WarmStart::set_cost (struct model *md, int col, double value)
+{
+  assert( col >= 0 && col < md->original->n() - 1 );
+
+  md->original->at(md->original->m() - 1, col, value);
+  md->cost_changed = 1;
+}
+
+/* Recompute the variables column of the current tableau: B^-1 b */
+int WarmStart::update_rhs (struct model *md)
+{
+  Tableau *orig = md->original, *tab = md->current;
+  int m = orig->m(), n = orig->n();
+
+  // the columns of the current basis, in the original problem
+  int *basis = (int *) malloc((m - 1) * sizeof(*basis));
+
+  for (int i = 0; i < m - 1; i++)
+    basis[i] = tab->basis_at(i);
+
+  BasisFactor *factor = orig->factorize_basis(basis);
+  free(basis);
+
+  if (!factor) return 0;
+
+  double *x = (double *) malloc(m * sizeof(double));
+
+  orig->column(n - 1, x); // the last element (the cost) is not used by ftran
+  factor->ftran(x);       // x[i] is the basic variable of row i
+
+  for (int i = 0; i < m - 1; i++)
+    tab->at(i, n - 1, x[i]);
+
+  free(x);
+  delete factor;
+
+  return 1;
+}
+
+/* Recompute the reduced costs row of the current tableau: c - c_B T */
+void WarmStart::update_costs (struct model *md)
+{
+  Tableau *tab = md->current;
+  int m = tab->m(), n = tab->n();
+
+  double *costs = tab->row(m - 1);
+
+  memcpy(costs, md->original->row(m - 1), n * sizeof(double));
+
+  for (int i = 0; i < m - 1; i++) {
+    double c = costs[tab->basis_at(i)];
+    if (c != 0.0) Kernels::axpy(costs, tab->row(i), -c, n);
+  }
+}
+
+/* Check the primal feasibility of the current tableau */
+static int primal_feasible (Tableau *tab)
+{
+  for (int i = 0; i < tab->m() - 1; i++) {
+    double x = tab->at(i, tab->n() - 1);
+    if (x < - Tolerances::primal || x > tab->upper_at(tab->basis_at(i)) + Tolerances::primal)
+      return 0;
+  }
+
+  return 1;
+}
+
+/* Solve the problem from scratch */
+static double cold_solve (struct WarmStart::model *md)
+{
+  delete md->current;
+  md->current = md->original->clone();
+
+  TRACE_MESSAGE(Trace::SUMMARY, "warm-start", "solving from scratch");
+
+  switch (md->method) {
+  case SIMPLEX:
+    return PrimalSimplex::simplex(md->current);
+  case DUAL:
+    return DualSimplex::simplex(md->current);
+  default:
+    return PrimalSimplex::two_phase(md->current);
+  }
+}
+
+/* Re-optimize from the last optimal basis, if possible */
+static double warm_solve (struct WarmStart::model *md)
+{
+  Tableau *tab = md->current;
+
+  if (!tab || tab->m() != md->original->m()) // rows deleted by the two-phase method
+    return cold_solve(md);
+
+  for (int j = 0; j < tab->n() - 1; j++)
+    if (tab->complemented_at(j)) return cold_solve(md);
+
+  if (md->rhs_changed) {
+    if (!WarmStart::update_rhs(md)) return cold_solve(md);
+
+    /* the reduced costs of the previous costs are still optimal:
+       the basis is dual feasible */
+    if (!primal_feasible(tab)) {
+      TRACE_MESSAGE(Trace::SUMMARY, "warm-start", "re-optimizing with the dual simplex");
+      DualSimplex::simplex(tab);
+    }
+  }
+
+  /* the basis is primal feasible */
+  WarmStart::update_costs(md);
+
+  TRACE_MESSAGE(Trace::SUMMARY, "warm-start", "re-optimizing with the primal simplex");
+  return PrimalSimplex::simplex(tab);
+}
+
+/* Solve the problem, re-optimizing from the last optimal basis if possible */
+double WarmStart::solve (struct model *md)
+{
+  double cost;
+
+  try {
+    cost = warm_solve(md);
+  } catch (TableauException *ex) {
+    delete md->current; // not optimal: the next solve starts from scratch
+    md->current = NULL;
+    md->rhs_changed = md->cost_changed = 0;
+    throw;
+  }
+
+  md->rhs_changed = md->cost_changed = 0;
+
+  return cost;
+}
+
+/* Unit tests */
+
+static void count_iterations (const struct Trace::event *ev, void *arg)
+{
+  if (ev->type == Trace::ITERATION) (*(int *) arg)++;
+}
+
+/* solve, printing the cost and the iterations */
+static void solve_and_print (const char *title, struct WarmStart::model *md)
+{
+  int iterations = 0, saved_level = Trace::level;
+
+  Trace::level = Trace::ITERATIONS;
+  Trace::set_callback(count_iterations, &iterations);
+
+  try {
+    double cost = WarmStart::solve(md);
+    printf("\nWarm Start: %s: cost %f, %d iterations\n", title, cost, iterations);
+  } catch (TableauException *ex) {
+    printf("\nWarm Start: %s: no solution found\n", title);
+  }
+
+  Trace::set_callback(NULL, NULL);
+  Trace::level = saved_level;
+}
+
+void WarmStart::test ()
+{
+  double buffer[] = { 12,   8, 2, 0, /**/ 48,
+		       6,  -4, 0, 2, /**/ 12,
+		      /*--------------------*/
+		      -1,  -1, 0, 0, /**/  0 };
+
+  int indices[] = {2, 3};
+
+  Tableau *tab = new Tableau(3, 5, buffer, indices);
+  tab->canonicalize();
+
+  struct model *md = create(tab, SIMPLEX);
+
+  solve_and_print("first solve", md);
+
+  set_rhs(md, 0, 12); // 6 x1 + 4 x2 <= 12
+  solve_and_print("right-hand side changed", md);
+
+  set_cost(md, 1, -3);
+  solve_and_print("cost changed", md);
+
+  set_rhs(md, 1, -100); // 3 x1 - 2 x2 <= -100: impossible
+  solve_and_print("right-hand side changed", md);
+
+  set_rhs(md, 1, 6);
+  solve_and_print("right-hand side restored", md);
+
+  // the same problem, from scratch
+
+  tab->at(0, 4, 12);
+  tab->at(2, 1, -3);
+
+  struct model *cold = create(tab, SIMPLEX);
+  solve_and_print("same problem from scratch", cold);
+
+  delete_model(cold);
+  delete_model(md);
+  delete tab;
+}
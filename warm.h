@@ -0,0 +1,84 @@
+/*
+ * Simple symplex implementation.
+ * Written in summer 2014,
+ * after taking an operational rersearch course.
+ *
+ * Emanuele Acri - crossbower@gmail.com - 2014
+ */
+
+#ifndef WARM_START_H
+#define WARM_START_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tableau.h"
+
+/*
+  Re-optimization of a problem after changes to the right-hand
+  sides or to the costs, starting from the last optimal basis.
+
+  The model keeps the problem as given (A | b and the cost row c)
+  and the last optimal tableau T = B^-1 A. After a change:
+
+    right-hand sides: the variables column is B^-1 b, solving
+                      with a factorization of the basis columns
+                      of the problem. The reduced costs don't
+                      change: the basis stays dual feasible,
+                      and the dual simplex is used.
+
+    costs:            the reduced costs row is c - c_B T (corner
+                      included). The basis stays primal feasible,
+                      and the primal simplex is used.
+
+  When both change, the right-hand sides are re-optimized first
+  (with the previous costs), then the costs.
+
+  The problem is solved from scratch if rows were deleted by the
+  two-phase method, or columns complemented by the dual simplex,
+  or the basis is singular.
+*/
+
+namespace WarmStart {
+
+  //public:
+
+  struct model {
+    Tableau *original; // the problem, never pivoted
+    Tableau *current;  // last optimal tableau, NULL if none
+    int method;        // used to solve from scratch, see solver_method
+
+    int rhs_changed, cost_changed;
+  };
+
+  /* Create a model, with a copy of the problem */
+  struct model *create (Tableau *tab, int method);
+
+  /* Free a model */
+  void delete_model (struct model *md);
+
+  /* Change an element of the right-hand side or of the costs */
+  void set_rhs  (struct model *md, int row, double value);
+  void set_cost (struct model *md, int col, double value);
+
+  /* Solve the problem, re-optimizing from the last optimal basis if
+     possible, and return the cost. The optimal tableau is in
+     md->current. Throws a TableauException if there is no solution */
+  double solve (struct model *md);
+
+  /* Unit tests */
+  void test ();
+
+  //private:
+
+  /* Recompute the variables column of the current tableau, 0 if the basis is singular */
+  int update_rhs (struct model *md);
+
+  /* Recompute the reduced costs row of the current tableau */
+  void update_costs (struct model *md);
+
+}
+
+#endif